@@ -0,0 +1,17 @@
+# -------------------------------------------------
+# Compares CsvTokenizer with QString::split
+# -------------------------------------------------
+
+TEMPLATE=app
+CONFIG+=console release
+CONFIG-=app_bundle
+QT-=gui
+TARGET=csvtokenizerbench
+
+INCLUDEPATH+=../../src/tools
+
+HEADERS += \
+    ../../src/tools/csvtokenizer.h
+
+SOURCES += main.cpp \
+    ../../src/tools/csvtokenizer.cpp
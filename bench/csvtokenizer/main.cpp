@@ -0,0 +1,108 @@
+#include "csvtokenizer.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+
+/**
+ * Records of integers, reals and quoted strings, some holding separators.
+ */
+static QByteArray generate(qint64 size) {
+  QByteArray data;
+  data.reserve(size + 256);
+  for (int i=0; data.size() < size; i++) {
+    data += QByteArray::number(i) + ","
+        + QByteArray::number(i / 7.0, 'f', 3) + ","
+        + "\"name " + QByteArray::number(i) + "\","
+        + "\"street, " + QByteArray::number(i % 1000) + "\","
+        + "plain text field\n";
+  }
+  return data;
+}
+
+/**
+ * Decodes the data then splits lines and fields, ignoring the quotes : the
+ * fields holding separators are split too.
+ */
+static qint64 naive(const QByteArray &data) {
+  qint64 fields = 0;
+  QStringList lines = QString::fromUtf8(data).split('\n',
+                                                    QString::SkipEmptyParts);
+  foreach (QString line, lines) {
+    fields += line.split(',').size();
+  }
+  return fields;
+}
+
+/**
+ * @param values
+ *    decode each field, as the import does
+ */
+static qint64 tokenize(const QByteArray &data, int threads, bool values) {
+  CsvTokenizer tokenizer(',', '"', threads);
+  QVector<CsvTokenizer::Records> slices;
+  tokenizer.tokenize(data.constData(), data.size(), true, slices);
+
+  qint64 fields = 0;
+  foreach (const CsvTokenizer::Records &r, slices) {
+    fields += r.fields.size();
+    if (values) {
+      foreach (const CsvTokenizer::Field &f, r.fields) {
+        tokenizer.value(data.constData(), f);
+      }
+    }
+  }
+  return fields;
+}
+
+static void report(QTextStream &out, QString name, qint64 ms, qint64 size,
+                   qint64 fields) {
+  double mbs = ms > 0 ? size / 1048576.0 / (ms / 1000.0) : 0;
+  out << name.leftJustified(28) << ms << " ms, "
+      << QString::number(mbs, 'f', 0) << " MB/s, " << fields << " fields"
+      << endl;
+}
+
+/**
+ * Usage: csvtokenizerbench [megabytes]
+ */
+int main(int argc, char *argv[]) {
+  QCoreApplication a(argc, argv);
+  QTextStream out(stdout);
+
+  int megabytes = argc > 1 ? QString(argv[1]).toInt() : 64;
+  QByteArray data = generate((qint64) megabytes * 1024 * 1024);
+
+  const char *names[] = { "scalar", "SSE2", "AVX2" };
+  out << data.size() << " bytes, " << names[CsvTokenizer::instructions()]
+      << ", " << QThread::idealThreadCount() << " threads" << endl;
+
+  QElapsedTimer timer;
+  qint64 fields;
+
+  timer.start();
+  fields = naive(data);
+  qint64 split = timer.elapsed();
+  report(out, "QString::split", split, data.size(), fields);
+
+  timer.restart();
+  fields = tokenize(data, 1, false);
+  report(out, "CsvTokenizer, 1 thread", timer.elapsed(), data.size(), fields);
+
+  timer.restart();
+  fields = tokenize(data, -1, false);
+  report(out, "CsvTokenizer", timer.elapsed(), data.size(), fields);
+
+  timer.restart();
+  fields = tokenize(data, -1, true);
+  qint64 decoded = timer.elapsed();
+  report(out, "CsvTokenizer and values", decoded, data.size(), fields);
+
+  out << "speed-up with values: "
+      << QString::number((double) split / qMax((qint64) 1, decoded), 'f', 1)
+      << "x" << endl;
+
+  return 0;
+}
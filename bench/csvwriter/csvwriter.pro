@@ -0,0 +1,23 @@
+# -------------------------------------------------
+# Compares CsvWriter with the former per-cell writer
+# -------------------------------------------------
+
+TEMPLATE=app
+CONFIG+=console release
+CONFIG-=app_bundle
+QT+=sql widgets
+TARGET=csvwriterbench
+
+CSV=../../src/plugins/exportengines/csv
+INCLUDEPATH+=../../src ../../src/plugins $${CSV}
+
+HEADERS += \
+    $${CSV}/csvexportengine.h \
+    $${CSV}/csvwizardpage.h
+
+SOURCES += main.cpp \
+    $${CSV}/csvexportengine.cpp \
+    $${CSV}/csvwizardpage.cpp
+
+FORMS += \
+    $${CSV}/csvwizardpage.ui
@@ -0,0 +1,160 @@
+#include "csvexportengine.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QTextStream>
+
+/**
+ * A generated result : integers, reals and strings needing quotes.
+ */
+static QString selectStatement(int rows, int columns) {
+  QStringList fields;
+  for (int i=0; i<columns; i++) {
+    switch (i % 3) {
+    case 0:
+      fields << QString("i * %1").arg(i + 1);
+      break;
+    case 1:
+      fields << QString("i / %1.0").arg(i + 1);
+      break;
+    default:
+      fields << QString("'name, \"%1\" ' || i").arg(i);
+    }
+  }
+
+  return QString("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL "
+                 "SELECT i + 1 FROM n WHERE i < %1) SELECT %2 FROM n")
+      .arg(rows).arg(fields.join(", "));
+}
+
+/**
+ * The loop of the CSV engine before CsvWriter.
+ */
+static void writeOld(QIODevice *f, QSqlQuery &q, int columns) {
+  QString del = "\"";
+  QString sep = ",";
+  QString escape = del;
+  escape.prepend("\\");
+
+  while (q.next()) {
+    for (int x=0; x<columns; x++) {
+      QVariant v = q.value(x);
+      if (v.canConvert(QVariant::String)) {
+        QString data = v.toString().replace(del, escape);
+        f->write(data.prepend(del).append(del + sep).toLatin1());
+      }
+    }
+    f->write("\n");
+  }
+}
+
+static void writeNew(QIODevice *f, QSqlQuery &q) {
+  CsvWriter writer("\"", ",", true, CsvWriter::QuoteNeeded);
+  writer.begin(f, q.record());
+  while (q.next()) {
+    writer.writeRow(q);
+  }
+  writer.end();
+}
+
+static void readOnly(QSqlQuery &q, int columns) {
+  while (q.next()) {
+    for (int x=0; x<columns; x++) {
+      q.value(x);
+    }
+  }
+}
+
+enum Mode {
+  Read,
+  Old,
+  New
+};
+
+/**
+ * @return elapsed milliseconds, -1 on error
+ */
+static qint64 run(QSqlDatabase &db, QString select, int columns, Mode mode,
+                  qint64 *size) {
+  QTemporaryFile f;
+  if (!f.open()) {
+    return -1;
+  }
+
+  QSqlQuery q(db);
+  q.setForwardOnly(true);
+
+  QElapsedTimer timer;
+  timer.start();
+  if (!q.exec(select)) {
+    QTextStream(stderr) << q.lastError().text() << endl;
+    return -1;
+  }
+
+  switch (mode) {
+  case Read:
+    readOnly(q, columns);
+    break;
+  case Old:
+    writeOld(&f, q, columns);
+    break;
+  case New:
+    writeNew(&f, q);
+    break;
+  }
+  f.flush();
+
+  qint64 elapsed = timer.elapsed();
+  *size = f.size();
+  return elapsed;
+}
+
+/**
+ * Writes the same wide result set with the former CSV engine, converting and
+ * writing each cell on its own, and with CsvWriter.
+ *
+ * Usage: csvwriterbench [rows] [columns]
+ */
+int main(int argc, char *argv[]) {
+  QCoreApplication a(argc, argv);
+  QTextStream out(stdout);
+
+  int rows = argc > 1 ? QString(argv[1]).toInt() : 100000;
+  int columns = argc > 2 ? QString(argv[2]).toInt() : 50;
+
+  QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+  db.setDatabaseName(":memory:");
+  if (!db.open()) {
+    QTextStream(stderr) << db.lastError().text() << endl;
+    return 1;
+  }
+
+  QString select = selectStatement(rows, columns);
+  qint64 size;
+
+  qint64 read = run(db, select, columns, Read, &size);
+  qint64 old = run(db, select, columns, Old, &size);
+  qint64 oldSize = size;
+  qint64 buffered = run(db, select, columns, New, &size);
+  if (read < 0 || old < 0 || buffered < 0) {
+    return 1;
+  }
+
+  // the time spent reading the query is the same for both writers
+  qint64 oldWrite = qMax((qint64) 1, old - read);
+  qint64 newWrite = qMax((qint64) 1, buffered - read);
+
+  out << rows << " rows of " << columns << " columns" << endl;
+  out << "reading only:   " << read << " ms" << endl;
+  out << "per-cell write: " << old << " ms, " << oldSize << " bytes" << endl;
+  out << "CsvWriter:      " << buffered << " ms, " << size << " bytes" << endl;
+  out << "writing speed-up: " << QString::number((double) oldWrite / newWrite,
+                                                 'f', 1) << "x" << endl;
+
+  return 0;
+}
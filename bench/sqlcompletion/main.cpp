@@ -0,0 +1,120 @@
+#include "sqlcompletion.h"
+#include "sqlcontext.h"
+#include "sqllexer.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+
+static const char *words[] = {
+  "customer", "order", "invoice", "product", "line", "date", "amount",
+  "status", "name", "code", "address", "price", "quantity", "account",
+  "payment", "supplier"
+};
+
+static QString word(int i) {
+  return words[i % 16];
+}
+
+/**
+ * Tables of 100 columns, all the names being different.
+ */
+static SqlContext *generate(int names) {
+  QStringList tables;
+  QMultiMap<QString, QString> fields;
+  for (int t=0; t<names / 100; t++) {
+    QString table = QString("%1_%2_%3").arg(word(t)).arg(word(t / 16)).arg(t);
+    tables << table;
+    for (int c=0; c<100; c++) {
+      fields.insert(table, QString("%1_%2_%3").arg(word(c)).arg(word(c / 16))
+                    .arg(t * 100 + c));
+    }
+  }
+  return new SqlContext(tables, fields);
+}
+
+/**
+ * A statement of 201 lines, the cursor being on the middle one, as the editor
+ * tokenizes it around the cursor.
+ */
+static void parseScope(const SqlLexer &lexer, int runs) {
+  QStringList lines;
+  lines << "SELECT c.name_customer_1, o.amount_order_2";
+  for (int i=0; i<99; i++) {
+    lines << QString("     , c.code_customer_%1 + o.price_order_%1").arg(i);
+  }
+  lines << "FROM customer_customer_0 c";
+  for (int i=0; i<99; i++) {
+    lines << QString("JOIN order_customer_%1 o%1"
+                     " ON o%1.code_customer_%1 = c.code_customer_%1")
+             .arg(i + 1);
+  }
+  lines << "WHERE c.status_customer_7 = 'open';";
+
+  for (int r=0; r<runs; r++) {
+    QString text;
+    QVector<SqlToken> tokens;
+    QVector<SqlToken> line;
+    int state = SqlLexer::Normal;
+    foreach (QString l, lines) {
+      int offset = text.size();
+      state = lexer.tokenize(l, state, line);
+      foreach (SqlToken t, line) {
+        t.position += offset;
+        tokens << t;
+      }
+      text += l + '\n';
+    }
+
+    SqlScope scope;
+    scope.parse(text, tokens, text.size() / 2);
+  }
+}
+
+static void report(QTextStream &out, QString name, qint64 nsecs, int runs) {
+  out << name.leftJustified(28)
+      << QString::number(nsecs / 1000.0 / runs, 'f', 1) << " us" << endl;
+}
+
+/**
+ * Usage: sqlcompletionbench [names]
+ */
+int main(int argc, char *argv[]) {
+  QCoreApplication a(argc, argv);
+  QTextStream out(stdout);
+
+  int names = argc > 1 ? QString(argv[1]).toInt() : 100000;
+  const int runs = 1000;
+
+  QElapsedTimer timer;
+  timer.start();
+  SqlContext *context = generate(names);
+  out << names << " names, context built in " << timer.elapsed() << " ms"
+      << endl;
+
+  // as the editor does on each keystroke
+  QStringList prefixes;
+  prefixes << "c" << "cu" << "cust" << "customer_order_" << "cstnm"
+           << "ordamt" << "pymntsts" << "zz";
+  foreach (QString p, prefixes) {
+    timer.restart();
+    int count = 0;
+    for (int r=0; r<runs; r++) {
+      count = context->completion().complete(p, 100).size();
+    }
+    report(out, QString("complete(\"%1\"), %2").arg(p).arg(count),
+           timer.nsecsElapsed(), runs);
+  }
+
+  QStringList keywords;
+  keywords << "AND" << "AS" << "FROM" << "JOIN" << "ON" << "SELECT"
+           << "WHERE";
+  SqlLexer lexer(keywords, QStringList(), QStringList());
+  timer.restart();
+  parseScope(lexer, runs);
+  report(out, "scope of 201 lines", timer.nsecsElapsed(), runs);
+
+  delete context;
+  return 0;
+}
@@ -0,0 +1,21 @@
+# -------------------------------------------------
+# Completion and scope of a 100k names schema
+# -------------------------------------------------
+
+TEMPLATE=app
+CONFIG+=console release
+CONFIG-=app_bundle
+QT-=gui
+TARGET=sqlcompletionbench
+
+INCLUDEPATH+=../../src/tools
+
+HEADERS += \
+    ../../src/tools/sqlcompletion.h \
+    ../../src/tools/sqlcontext.h \
+    ../../src/tools/sqllexer.h
+
+SOURCES += main.cpp \
+    ../../src/tools/sqlcompletion.cpp \
+    ../../src/tools/sqlcontext.cpp \
+    ../../src/tools/sqllexer.cpp
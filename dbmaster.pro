@@ -5,5 +5,5 @@
 cache()
 
 TEMPLATE=subdirs
-SUBDIRS=src
+SUBDIRS=src bench
 TRANSLATIONS += tr/fr.po
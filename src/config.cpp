@@ -14,6 +14,11 @@ QMap<QString,QTextCharFormat> Config::shFormat;
 QStringList     Config::shGroupList;
 int             Config::editorTabSize   = 4;
 bool Config::editorTabUseSpaces = false;
+int             Config::poolIdleTimeout = 300000;
+int             Config::poolMaxSize     = 8;
+int             Config::poolMinSize     = 1;
+int             Config::queryMaxPerConnection = 4;
+int             Config::queryMaxRunning = 8;
 
 void Config::init() {
   shGroupList << "sql_basics" << "sql_functions" << "sql_types" << "strings"
@@ -29,6 +34,12 @@ void Config::loadDefaults() {
   Config::editorFont = QFont("Monospace", 10);
   Config::editorSemantic = true;
 
+  Config::poolIdleTimeout = 300000;
+  Config::poolMaxSize = 8;
+  Config::poolMinSize = 1;
+  Config::queryMaxPerConnection = 4;
+  Config::queryMaxRunning = 8;
+
   Config::shColor.clear();
   Config::shColor["sql_basics"] = Qt::black;
   Config::shColor["sql_functions"] = QColor("#644a9b");
@@ -78,6 +89,23 @@ void Config::reload() {
   editorSemantic    = s.value("semantic").toBool();
   s.endGroup();
 
+  /*
+   * Connection pool, see ConnectionPool
+   */
+  s.beginGroup("pool");
+  poolIdleTimeout   = s.value("idle_timeout", 300000).toInt();
+  poolMaxSize       = s.value("max_size", 8).toInt();
+  poolMinSize       = s.value("min_size", 1).toInt();
+  s.endGroup();
+
+  /*
+   * Query scheduler, see QueryScheduler
+   */
+  s.beginGroup("scheduler");
+  queryMaxPerConnection = s.value("max_per_connection", 4).toInt();
+  queryMaxRunning   = s.value("max_running", 8).toInt();
+  s.endGroup();
+
   /*
    * Syntax highlighting properties
    */
@@ -117,6 +145,17 @@ void Config::save() {
   s.setValue("semantic", editorSemantic);
   s.endGroup();
 
+  s.beginGroup("pool");
+  s.setValue("idle_timeout", poolIdleTimeout);
+  s.setValue("max_size", poolMaxSize);
+  s.setValue("min_size", poolMinSize);
+  s.endGroup();
+
+  s.beginGroup("scheduler");
+  s.setValue("max_per_connection", queryMaxPerConnection);
+  s.setValue("max_running", queryMaxRunning);
+  s.endGroup();
+
   // Write syntax highlighting preferences
   s.beginWriteArray("highlighting", shGroupList.size());
 
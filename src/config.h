@@ -29,6 +29,11 @@ public:
   static QStringList      shGroupList;
   static int              editorTabSize;
   static bool editorTabUseSpaces;
+  static int              poolIdleTimeout;
+  static int              poolMaxSize;
+  static int              poolMinSize;
+  static int              queryMaxPerConnection;
+  static int              queryMaxRunning;
 };
 
 #endif // CONFIG_H
@@ -0,0 +1,478 @@
+#include "catalogmodel.h"
+
+#include "../iconmanager.h"
+
+CatalogModel::CatalogModel(QObject *parent)
+  : QAbstractItemModel(parent) {
+  garbageLinks = 0;
+
+  // root, parent of the connections
+  allocNode(-1, 0, DisplayNode, "", false);
+  nodes[0].flags = Fetched;
+}
+
+/**
+ * Reserves a block of links at the end of the array.
+ *
+ * @return position of the block
+ */
+int CatalogModel::allocLinks(int count) {
+  int first = links.size();
+  links.resize(first + count);
+  return first;
+}
+
+int CatalogModel::allocNode(int parent, int row, NodeType type, QString name,
+                            bool primaryKey) {
+  Node n;
+  n.parent = parent;
+  n.row = row;
+  n.firstChild = 0;
+  n.childCount = 0;
+  n.name = intern(name);
+  n.type = type;
+  n.flags = primaryKey ? PrimaryKey : 0;
+
+  if (!freeNodes.isEmpty()) {
+    int id = freeNodes.takeLast();
+    nodes[id] = n;
+    return id;
+  }
+
+  nodes << n;
+  return nodes.size() - 1;
+}
+
+QModelIndex CatalogModel::appendConnection(QString title, QIcon driverIcon) {
+  QModelIndex index = insertNode(QModelIndex(), rowCount(), ConnectionNode,
+                                 title);
+  driverIcons[id(index)] = driverIcon;
+  return index;
+}
+
+bool CatalogModel::canFetchMore(const QModelIndex &parent) const {
+  if (parent.column() > 0) {
+    return false;
+  }
+
+  int i = id(parent);
+  return isLazy(i) && !(nodes[i].flags & (Fetched | Fetching));
+}
+
+/**
+ * Removes all the children of a node at once.
+ */
+void CatalogModel::clear(const QModelIndex &parent) {
+  int i = id(parent);
+  if (nodes[i].childCount == 0) {
+    return;
+  }
+
+  beginRemoveRows(parent, 0, nodes[i].childCount - 1);
+  freeChildren(i);
+  endRemoveRows();
+
+  compactLinks();
+}
+
+int CatalogModel::columnCount(const QModelIndex &parent) const {
+  return 2;
+}
+
+/**
+ * Rewrites the links array once most of it is made of abandoned blocks.
+ * Node ids are unchanged.
+ */
+void CatalogModel::compactLinks() {
+  if (garbageLinks < 4096 || garbageLinks < links.size() / 2) {
+    return;
+  }
+
+  QVector<int> compact;
+  compact.reserve(links.size() - garbageLinks);
+
+  QVector<int> stack;
+  stack << 0;
+  while (!stack.isEmpty()) {
+    Node &n = nodes[stack.takeLast()];
+    int first = compact.size();
+    for (int i=0; i<n.childCount; i++) {
+      compact << links[n.firstChild + i];
+      stack << links[n.firstChild + i];
+    }
+    n.firstChild = first;
+  }
+
+  links = compact;
+  garbageLinks = 0;
+}
+
+QVariant CatalogModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid()) {
+    return QVariant();
+  }
+
+  int i = id(index);
+  const Node &n = nodes[i];
+
+  if (index.column() == 1) {
+    if (role == Qt::DecorationRole) {
+      return driverIcons.value(i);
+    }
+    return QVariant();
+  }
+
+  switch (role) {
+  case Qt::DisplayRole:
+  case Qt::EditRole:
+    return strings[n.name];
+
+  case Qt::DecorationRole:
+    if (icons.contains(i)) {
+      return icons[i];
+    }
+
+    switch (n.type) {
+    case ColumnNode:
+      return IconManager::get(n.flags & PrimaryKey ? "column_key" : "column");
+    case ColumnsFolder:
+      return IconManager::get("folder_columns");
+    case LoadingNode:
+      return IconManager::get("view-refresh");
+    case SchemaNode:
+      return IconManager::get("schema");
+    case SchemasFolder:
+      return IconManager::get("folder_schemas");
+    case SysTableNode:
+    case TableNode:
+      return IconManager::get("table");
+    case TablesFolder:
+      return IconManager::get("folder_tables");
+    case ViewNode:
+      return IconManager::get("table_lightning");
+    case ViewsFolder:
+      return IconManager::get("folder_views");
+    default:
+      return QVariant();
+    }
+
+  case Qt::ToolTipRole:
+    if (toolTips.contains(i)) {
+      return toolTips[i];
+    }
+
+    switch (n.type) {
+    case SchemaNode:
+      return strings[n.name];
+    case SysTableNode:
+    case TableNode:
+    case ViewNode:
+      return qualifiedName(i);
+    default:
+      return QVariant();
+    }
+
+  case Qt::UserRole:
+    if (n.type <= ViewNode) {
+      return (int) n.type;
+    }
+    return QVariant();
+
+  default:
+    return QVariant();
+  }
+}
+
+/**
+ * Shows a loading node and asks the owner for the children.
+ */
+void CatalogModel::fetchMore(const QModelIndex &parent) {
+  if (!canFetchMore(parent)) {
+    return;
+  }
+
+  setLoading(parent);
+  emit fetchRequested(parent);
+}
+
+Qt::ItemFlags CatalogModel::flags(const QModelIndex &index) const {
+  if (!index.isValid()) {
+    return Qt::NoItemFlags;
+  }
+
+  if (index.column() == 1 || nodes[id(index)].type == LoadingNode) {
+    return Qt::ItemIsEnabled;
+  }
+
+  return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+/**
+ * Releases the descendants of a node. Their links become garbage.
+ */
+void CatalogModel::freeChildren(int id) {
+  for (int i=0; i<nodes[id].childCount; i++) {
+    int child = links[nodes[id].firstChild + i];
+    freeChildren(child);
+    freeNodes << child;
+    driverIcons.remove(child);
+    icons.remove(child);
+    toolTips.remove(child);
+  }
+
+  garbageLinks += nodes[id].childCount;
+  nodes[id].childCount = 0;
+  nodes[id].firstChild = 0;
+}
+
+bool CatalogModel::hasChildren(const QModelIndex &parent) const {
+  if (parent.column() > 0) {
+    return false;
+  }
+
+  int i = id(parent);
+  if (isLazy(i) && !(nodes[i].flags & Fetched)) {
+    return true;
+  }
+
+  return nodes[i].childCount > 0;
+}
+
+QVariant CatalogModel::headerData(int section, Qt::Orientation orientation,
+                                  int role) const {
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole
+      && section == 0) {
+    return tr("Database");
+  }
+
+  return QVariant();
+}
+
+int CatalogModel::id(const QModelIndex &index) const {
+  return index.isValid() ? (int) index.internalId() : 0;
+}
+
+QModelIndex CatalogModel::index(int row, int column,
+                                const QModelIndex &parent) const {
+  if (row < 0 || column < 0 || column >= 2 || parent.column() > 0) {
+    return QModelIndex();
+  }
+
+  const Node &p = nodes[id(parent)];
+  if (row >= p.childCount) {
+    return QModelIndex();
+  }
+
+  return createIndex(row, column, links[p.firstChild + row]);
+}
+
+/**
+ * Inserts a single node, e.g. a table created since the last load.
+ */
+QModelIndex CatalogModel::insertNode(const QModelIndex &parent, int row,
+                                     NodeType type, QString name,
+                                     bool primaryKey) {
+  int p = id(parent);
+  int count = nodes[p].childCount;
+  row = qBound(0, row, count);
+
+  beginInsertRows(parent, row, row);
+
+  int child = allocNode(p, row, type, name, primaryKey);
+
+  // the block grows : it is copied at the end
+  int old = nodes[p].firstChild;
+  int first = allocLinks(count + 1);
+  for (int i=0; i<row; i++) {
+    links[first + i] = links[old + i];
+  }
+  links[first + row] = child;
+  for (int i=row; i<count; i++) {
+    links[first + i + 1] = links[old + i];
+    nodes[links[old + i]].row = i + 1;
+  }
+
+  garbageLinks += count;
+  nodes[p].firstChild = first;
+  nodes[p].childCount = count + 1;
+
+  endInsertRows();
+
+  compactLinks();
+
+  return createIndex(row, 0, child);
+}
+
+int CatalogModel::intern(QString s) {
+  int i = stringIds.value(s, -1);
+  if (i < 0) {
+    i = strings.size();
+    strings << s;
+    stringIds[s] = i;
+  }
+  return i;
+}
+
+/**
+ * Nodes whose children are loaded on demand.
+ */
+bool CatalogModel::isLazy(int id) const {
+  switch (nodes[id].type) {
+  case SchemaNode:
+  case SysTableNode:
+  case TableNode:
+  case ViewNode:
+    return true;
+  default:
+    return false;
+  }
+}
+
+QModelIndex CatalogModel::parent(const QModelIndex &index) const {
+  if (!index.isValid()) {
+    return QModelIndex();
+  }
+
+  int p = nodes[id(index)].parent;
+  if (p <= 0) {
+    return QModelIndex();
+  }
+
+  return createIndex(nodes[p].row, 0, p);
+}
+
+/**
+ * Name of a table prefixed with its schema, if any.
+ */
+QString CatalogModel::qualifiedName(int id) const {
+  for (int p = nodes[id].parent; p > 0; p = nodes[p].parent) {
+    if (nodes[p].type == SchemaNode) {
+      return strings[nodes[p].name] + "." + strings[nodes[id].name];
+    }
+  }
+
+  return strings[nodes[id].name];
+}
+
+void CatalogModel::removeNode(const QModelIndex &index) {
+  int i = id(index);
+  if (i == 0) {
+    return;
+  }
+
+  int p = nodes[i].parent;
+  int row = nodes[i].row;
+
+  beginRemoveRows(index.parent(), row, row);
+
+  freeChildren(i);
+  freeNodes << i;
+  driverIcons.remove(i);
+  icons.remove(i);
+  toolTips.remove(i);
+
+  Node &n = nodes[p];
+  for (int r=row; r<n.childCount - 1; r++) {
+    links[n.firstChild + r] = links[n.firstChild + r + 1];
+    nodes[links[n.firstChild + r]].row = r;
+  }
+  n.childCount--;
+  garbageLinks++;
+
+  endRemoveRows();
+
+  compactLinks();
+}
+
+int CatalogModel::rowCount(const QModelIndex &parent) const {
+  if (parent.column() > 0) {
+    return 0;
+  }
+
+  return nodes[id(parent)].childCount;
+}
+
+/**
+ * Replaces the children of a node. Entries must come after their parent
+ * entry. The node is marked as loaded.
+ */
+void CatalogModel::setChildren(const QModelIndex &parent,
+                               const QList<Entry> &entries) {
+  clear(parent);
+
+  int p = id(parent);
+  nodes[p].flags = (nodes[p].flags | Fetched) & ~Fetching;
+
+  QVector<int> childCounts(entries.size(), 0);
+  int top = 0;
+  foreach (Entry e, entries) {
+    if (e.parent < 0) {
+      top++;
+    } else {
+      childCounts[e.parent]++;
+    }
+  }
+
+  if (top == 0) {
+    return;
+  }
+
+  beginInsertRows(parent, 0, top - 1);
+
+  nodes[p].firstChild = allocLinks(top);
+  nodes[p].childCount = top;
+
+  QVector<int> ids(entries.size());
+  int topRow = 0;
+  for (int i=0; i<entries.size(); i++) {
+    const Entry &e = entries[i];
+    int parentId = e.parent < 0 ? p : ids[e.parent];
+
+    int row;
+    if (e.parent < 0) {
+      row = topRow++;
+    } else {
+      if (nodes[parentId].childCount == 0) {
+        nodes[parentId].firstChild = allocLinks(childCounts[e.parent]);
+        nodes[parentId].flags |= Fetched;
+      }
+      row = nodes[parentId].childCount++;
+    }
+
+    ids[i] = allocNode(parentId, row, e.type, e.name, e.primaryKey);
+    links[nodes[parentId].firstChild + row] = ids[i];
+  }
+
+  endInsertRows();
+}
+
+void CatalogModel::setIcon(const QModelIndex &index, QIcon icon) {
+  icons[id(index)] = icon;
+  emit dataChanged(index, index);
+}
+
+/**
+ * Replaces the children of a node by a loading node.
+ */
+void CatalogModel::setLoading(const QModelIndex &parent) {
+  clear(parent);
+
+  int p = id(parent);
+  nodes[p].flags = (nodes[p].flags | Fetching) & ~Fetched;
+
+  insertNode(parent, 0, LoadingNode, tr("Loading..."));
+}
+
+void CatalogModel::setName(const QModelIndex &index, QString name) {
+  nodes[id(index)].name = intern(name);
+  emit dataChanged(index, index);
+}
+
+void CatalogModel::setToolTip(const QModelIndex &index, QString toolTip) {
+  toolTips[id(index)] = toolTip;
+  emit dataChanged(index, index);
+}
+
+CatalogModel::NodeType CatalogModel::type(const QModelIndex &index) const {
+  return (NodeType) nodes[id(index)].type;
+}
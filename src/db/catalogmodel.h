@@ -0,0 +1,126 @@
+#ifndef CATALOGMODEL_H
+#define CATALOGMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QIcon>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+/**
+ * Tree of the connections and their catalog (schemas, tables, columns).
+ *
+ * Nodes are kept in one array and never move : a node's id is its position,
+ * used as the internal id of its indexes. Each node links to its parent by
+ * id, and its children are a contiguous range of ids in a shared links array,
+ * so that row() and index() are constant time. Names are interned, icons and
+ * tooltips are computed from the node type.
+ *
+ * Schemas, tables and views load their children on demand : fetchMore() shows
+ * a "Loading..." node and emits fetchRequested(), the owner then calls
+ * setChildren().
+ */
+class CatalogModel : public QAbstractItemModel {
+Q_OBJECT
+public:
+  /**
+   * The first values are those returned for Qt::UserRole, see
+   * DbManager::ItemTypes. The others return nothing.
+   */
+  enum NodeType {
+    ConnectionNode,
+    DisplayNode,
+    ColumnNode,
+    SchemaNode,
+    SysTableNode,
+    TableNode,
+    ViewNode,
+    ColumnsFolder,
+    LoadingNode,
+    SchemasFolder,
+    TablesFolder,
+    ViewsFolder
+  };
+
+  /**
+   * A node to create with setChildren().
+   */
+  struct Entry {
+    /** Position of the parent entry in the list, -1 for the given parent. */
+    int parent;
+    NodeType type;
+    QString name;
+    bool primaryKey;
+  };
+
+  explicit CatalogModel(QObject *parent = 0);
+
+  QModelIndex appendConnection(QString title, QIcon driverIcon);
+  void clear(const QModelIndex &parent);
+  QModelIndex insertNode(const QModelIndex &parent, int row, NodeType type,
+                         QString name, bool primaryKey = false);
+  void removeNode(const QModelIndex &index);
+  void setChildren(const QModelIndex &parent, const QList<Entry> &entries);
+  void setIcon(const QModelIndex &index, QIcon icon);
+  void setLoading(const QModelIndex &parent);
+  void setName(const QModelIndex &index, QString name);
+  void setToolTip(const QModelIndex &index, QString toolTip);
+  NodeType type(const QModelIndex &index) const;
+
+  // QAbstractItemModel
+  bool canFetchMore(const QModelIndex &parent) const;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  void fetchMore(const QModelIndex &parent);
+  Qt::ItemFlags flags(const QModelIndex &index) const;
+  bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const;
+  QModelIndex index(int row, int column,
+                    const QModelIndex &parent = QModelIndex()) const;
+  QModelIndex parent(const QModelIndex &index) const;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+
+signals:
+  void fetchRequested(const QModelIndex &index);
+
+private:
+  enum NodeFlag {
+    PrimaryKey  = 0x01,
+    Fetched     = 0x02,
+    Fetching    = 0x04
+  };
+
+  struct Node {
+    int parent;
+    int row;
+    int firstChild;
+    int childCount;
+    int name;
+    quint8 type;
+    quint8 flags;
+  };
+
+  int allocLinks(int count);
+  int allocNode(int parent, int row, NodeType type, QString name,
+                bool primaryKey);
+  void compactLinks();
+  void freeChildren(int id);
+  int id(const QModelIndex &index) const;
+  int intern(QString s);
+  bool isLazy(int id) const;
+  QString qualifiedName(int id) const;
+
+  QHash<int, QIcon> driverIcons;
+  QVector<int> freeNodes;
+  int garbageLinks;
+  QHash<int, QIcon> icons;
+  QVector<int> links;
+  QVector<Node> nodes;
+  QVector<QString> strings;
+  QHash<QString, int> stringIds;
+  QHash<int, QString> toolTips;
+};
+
+#endif // CATALOGMODEL_H
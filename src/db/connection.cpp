@@ -7,12 +7,15 @@ Connection::Connection(QSqlDatabase *db, QString alias, QObject *parent)
   : QObject(parent) {
   m_alias = alias;
   m_db = db;
+  m_pool = new ConnectionPool(db, this);
+  m_statementTimeout = 0;
 
   connect(this, SIGNAL(closed()), this, SIGNAL(changed()));
   connect(this, SIGNAL(opened()), this, SIGNAL(changed()));
 }
 
 void Connection::close() {
+  m_pool->clear();
   m_db->close();
 
   Logger::instance->log(tr("Disconnected from %1").arg(m_alias));
@@ -54,6 +57,25 @@ QSqlDatabase* Connection::db() {
   return m_db;
 }
 
+/**
+ * Worker connections, for the queries run outside of the GUI thread.
+ */
+ConnectionPool* Connection::pool() {
+  return m_pool;
+}
+
 void Connection::setAlias(QString alias) {
   m_alias = alias;
 }
+
+void Connection::setStatementTimeout(int msecs) {
+  m_statementTimeout = qMax(0, msecs);
+}
+
+/**
+ * Longest run allowed to the queries of the editor, in milliseconds. 0 if
+ * there is no limit.
+ */
+int Connection::statementTimeout() {
+  return m_statementTimeout;
+}
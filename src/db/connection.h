@@ -1,6 +1,8 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include "connectionpool.h"
+
 #include <QObject>
 #include <QSqlDatabase>
 
@@ -11,8 +13,11 @@ public:
 
   QString alias();
   QSqlDatabase* db();
+  ConnectionPool* pool();
+  int statementTimeout();
 
   void setAlias(QString alias);
+  void setStatementTimeout(int msecs);
 
 public slots:
   void close();
@@ -27,6 +32,8 @@ signals:
 private:
   QString m_alias;
   QSqlDatabase* m_db;
+  ConnectionPool* m_pool;
+  int m_statementTimeout;
 
 };
 
@@ -0,0 +1,307 @@
+#include "connectionpool.h"
+
+#include "../config.h"
+
+#include <QMutexLocker>
+#include <QSqlQuery>
+#include <QStringList>
+
+QAtomicInt ConnectionPool::connectionCount;
+
+ConnectionPool::ConnectionPool(QSqlDatabase *db, QObject *parent)
+  : QObject(parent) {
+  this->db = db;
+  generation = 0;
+  m_idleTimeout = Config::poolIdleTimeout;
+  m_maxSize = qMax(1, Config::poolMaxSize);
+  m_minSize = qMax(0, Config::poolMinSize);
+
+  evictTimer = new QTimer(this);
+  evictTimer->setInterval(EvictInterval);
+  connect(evictTimer, SIGNAL(timeout()), this, SLOT(evictIdle()));
+  evictTimer->start();
+}
+
+/**
+ * Closes the idle connections. Those still checked out are left to their
+ * users.
+ */
+ConnectionPool::~ConnectionPool() {
+  clear();
+}
+
+/**
+ * Gives a connection back to the pool. The handle is reset : queries using it
+ * must have been destroyed before.
+ */
+void ConnectionPool::checkin(QSqlDatabase &connection) {
+  QString name = connection.connectionName();
+  connection = QSqlDatabase();
+
+  QStringList stale;
+  {
+    QMutexLocker locker(&mutex);
+    for (int i=0; i<pooled.size(); i++) {
+      if (pooled[i].name == name) {
+        // opened before clear(), or the pool was shrunk meanwhile
+        if (pooled[i].generation != generation || pooled.size() > m_maxSize) {
+          stale << name;
+          pooled.removeAt(i);
+        } else {
+          pooled[i].busy = false;
+          pooled[i].lastUsed.restart();
+        }
+        break;
+      }
+    }
+    released.wakeAll();
+  }
+
+  foreach (QString s, stale) {
+    QSqlDatabase::removeDatabase(s);
+  }
+}
+
+/**
+ * Returns an open connection for the calling thread.
+ *
+ * @param error
+ *    set if no connection could be opened
+ * @param timeout
+ *    how long to wait for a connection when the pool is full, in milliseconds.
+ *    Negative to wait forever.
+ *
+ * @return an invalid handle on error
+ */
+QSqlDatabase ConnectionPool::checkout(QSqlError *error, int timeout) {
+  QThread *thread = QThread::currentThread();
+  QElapsedTimer waited;
+  waited.start();
+
+  mutex.lock();
+  forever {
+    // an idle connection already opened by this thread
+    for (int i=0; i<pooled.size(); i++) {
+      Pooled &p = pooled[i];
+      if (!p.busy && p.thread == thread && p.generation != generation) {
+        // opened before clear()
+        QString name = pooled.takeAt(i).name;
+        mutex.unlock();
+        QSqlDatabase::removeDatabase(name);
+        mutex.lock();
+        i = -1;
+        continue;
+      }
+
+      if (!p.busy && p.thread == thread) {
+        p.busy = true;
+        QString name = p.name;
+        bool check = p.lastUsed.elapsed() >= HealthCheckDelay;
+        mutex.unlock();
+
+        QSqlDatabase connection = QSqlDatabase::database(name, false);
+        if (!check || isAlive(connection)) {
+          return connection;
+        }
+
+        // dropped by the server : one attempt to reconnect
+        connection.close();
+        if (connection.open()) {
+          return connection;
+        }
+
+        if (error) {
+          *error = connection.lastError();
+        }
+        connection = QSqlDatabase();
+        remove(QStringList() << name);
+        return QSqlDatabase();
+      }
+    }
+
+    if (pooled.size() < m_maxSize) {
+      Pooled p;
+      p.name = QString("pool-%1").arg(connectionCount.fetchAndAddOrdered(1));
+      p.thread = thread;
+      p.busy = true;
+      p.generation = generation;
+      p.lastUsed.start();
+      pooled << p;
+      mutex.unlock();
+
+      QSqlDatabase connection = QSqlDatabase::cloneDatabase(*db, p.name);
+      if (connection.open()) {
+        return connection;
+      }
+
+      if (error) {
+        *error = connection.lastError();
+      }
+      connection = QSqlDatabase();
+      remove(QStringList() << p.name);
+      return QSqlDatabase();
+    }
+
+    // the pool is full : an idle connection of a finished thread makes room
+    int idle = -1;
+    for (int i=0; i<pooled.size() && idle < 0; i++) {
+      if (!pooled[i].busy && isClosable(pooled[i])) {
+        idle = i;
+      }
+    }
+
+    if (idle >= 0) {
+      QString name = pooled.takeAt(idle).name;
+      mutex.unlock();
+      QSqlDatabase::removeDatabase(name);
+      mutex.lock();
+      continue;
+    }
+
+    // the thread of an idle connection may also end meanwhile
+    if (timeout < 0) {
+      released.wait(&mutex, ThreadCheckInterval);
+      continue;
+    }
+
+    int left = timeout - (int) waited.elapsed();
+    if (left > 0) {
+      released.wait(&mutex, qMin(left, (int) ThreadCheckInterval));
+    } else {
+      mutex.unlock();
+      if (error) {
+        *error = QSqlError(tr("All the %1 connections to the database are in use")
+                           .arg(m_maxSize), "", QSqlError::ConnectionError);
+      }
+      return QSqlDatabase();
+    }
+  }
+}
+
+/**
+ * Closes the idle connections. Those checked out are closed when they are
+ * given back, those of a running thread when it checks out again or ends.
+ * Called when the connection is closed.
+ */
+void ConnectionPool::clear() {
+  QStringList names;
+  {
+    QMutexLocker locker(&mutex);
+    generation++;
+    for (int i=pooled.size() - 1; i>=0; i--) {
+      if (!pooled[i].busy && isClosable(pooled[i])) {
+        names << pooled.takeAt(i).name;
+      }
+    }
+  }
+
+  foreach (QString s, names) {
+    QSqlDatabase::removeDatabase(s);
+  }
+}
+
+/**
+ * Closes the connections left idle for longer than the idle timeout, keeping
+ * at least minSize() of them, and those whose thread no longer exists. Those
+ * of a running thread are left to it.
+ */
+void ConnectionPool::evictIdle() {
+  QStringList names;
+  {
+    QMutexLocker locker(&mutex);
+    for (int i=pooled.size() - 1; i>=0; i--) {
+      const Pooled &p = pooled[i];
+      if (p.busy || !isClosable(p)) {
+        continue;
+      }
+
+      if (p.thread.isNull() || p.thread->isFinished()
+          || p.generation != generation
+          || (p.lastUsed.elapsed() >= m_idleTimeout
+              && pooled.size() > m_minSize)) {
+        names << pooled.takeAt(i).name;
+      }
+    }
+  }
+
+  foreach (QString s, names) {
+    QSqlDatabase::removeDatabase(s);
+  }
+}
+
+bool ConnectionPool::isAlive(QSqlDatabase &connection) {
+  if (!connection.isOpen()) {
+    return false;
+  }
+
+  QSqlQuery q(connection);
+  return q.exec(pingQuery());
+}
+
+/**
+ * Whether the calling thread may close the connection : it opened it, or the
+ * thread which did has finished. Called with the mutex locked.
+ */
+bool ConnectionPool::isClosable(const Pooled &pooled) {
+  return pooled.thread.isNull() || pooled.thread == QThread::currentThread()
+      || pooled.thread->isFinished();
+}
+
+/**
+ * Cheapest statement accepted by the DBMS.
+ */
+QString ConnectionPool::pingQuery() {
+  QString driver = db->driverName();
+  if (driver.startsWith("QOCI")) {
+    return "SELECT 1 FROM DUAL";
+  } else if (driver == "QDB2") {
+    return "SELECT 1 FROM SYSIBM.SYSDUMMY1";
+  } else if (driver == "QIBASE") {
+    return "SELECT 1 FROM RDB$DATABASE";
+  }
+
+  return "SELECT 1";
+}
+
+/**
+ * Forgets connections, checked out or not, and closes them.
+ */
+void ConnectionPool::remove(QStringList names) {
+  {
+    QMutexLocker locker(&mutex);
+    for (int i=pooled.size() - 1; i>=0; i--) {
+      if (names.contains(pooled[i].name)) {
+        pooled.removeAt(i);
+      }
+    }
+    released.wakeAll();
+  }
+
+  foreach (QString s, names) {
+    QSqlDatabase::removeDatabase(s);
+  }
+}
+
+void ConnectionPool::setIdleTimeout(int msecs) {
+  QMutexLocker locker(&mutex);
+  m_idleTimeout = msecs;
+}
+
+void ConnectionPool::setMaxSize(int size) {
+  QMutexLocker locker(&mutex);
+  m_maxSize = qMax(1, size);
+  released.wakeAll();
+}
+
+void ConnectionPool::setMinSize(int size) {
+  QMutexLocker locker(&mutex);
+  m_minSize = qMax(0, size);
+}
+
+/**
+ * Number of connections, idle or checked out.
+ */
+int ConnectionPool::size() {
+  QMutexLocker locker(&mutex);
+  return pooled.size();
+}
@@ -0,0 +1,84 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QWaitCondition>
+
+/**
+ * Worker connections of a Connection, cloned from its handle on demand.
+ *
+ * A pooled connection is opened by the thread that checks it out and is only
+ * given back to that thread, as Qt requires. It is used by one caller at a
+ * time : checkout() returns an idle connection of the calling thread, opens a
+ * new one while the pool is under its maximum size, or waits for another to
+ * be checked in.
+ *
+ * Connections idle for more than the idle timeout are closed, down to the
+ * minimum size. Those idle for a while are checked with a trivial query before
+ * being handed out again. As Qt requires, a connection is only closed by its
+ * own thread or once that thread has finished.
+ */
+class ConnectionPool : public QObject {
+Q_OBJECT
+public:
+  ConnectionPool(QSqlDatabase *db, QObject *parent = 0);
+  ~ConnectionPool();
+
+  QSqlDatabase checkout(QSqlError *error = NULL,
+                        int timeout = CheckoutTimeout);
+  void checkin(QSqlDatabase &connection);
+  void clear();
+  int idleTimeout() { return m_idleTimeout; };
+  int maxSize() { return m_maxSize; };
+  int minSize() { return m_minSize; };
+  void setIdleTimeout(int msecs);
+  void setMaxSize(int size);
+  void setMinSize(int size);
+  int size();
+
+  static const int CheckoutTimeout = 30000;
+  static const int EvictInterval = 60000;
+  static const int HealthCheckDelay = 30000;
+  static const int ThreadCheckInterval = 1000;
+
+public slots:
+  void evictIdle();
+
+private:
+  struct Pooled {
+    QString name;
+    QPointer<QThread> thread;
+    bool busy;
+    int generation;
+    QElapsedTimer lastUsed;
+  };
+
+  bool isAlive(QSqlDatabase &connection);
+  bool isClosable(const Pooled &pooled);
+  QString pingQuery();
+  void remove(QStringList names);
+
+  QSqlDatabase *db;
+  QTimer *evictTimer;
+  int generation;
+  int m_idleTimeout;
+  int m_maxSize;
+  int m_minSize;
+  QMutex mutex;
+  QList<Pooled> pooled;
+  QWaitCondition released;
+
+  static QAtomicInt connectionCount;
+};
+
+#endif // CONNECTIONPOOL_H
@@ -0,0 +1,229 @@
+#include "contextservice.h"
+
+#include "../dbmanager.h"
+#include "metadatacache.h"
+
+#include <QSqlRecord>
+#include <QThreadPool>
+
+ContextService* ContextService::instance;
+QAtomicInt ContextService::connectionCount;
+
+/**
+ * Loads the context of a connection, and sends it to the service.
+ */
+class ContextLoad : public QRunnable {
+public:
+  ContextLoad(QSqlDatabase *db, SqlWrapper *wrapper) {
+    this->db = *db;
+    this->wrapper = wrapper;
+    connection = ContextService::key(db);
+  }
+
+  void run() {
+    QStringList tables;
+    QMultiMap<QString, QString> fields;
+
+    {
+      MetadataCache cache(connection);
+      QList<SqlSchema> schemas;
+      if (!cache.schemas(schemas)) {
+        SqlSchema s;
+        s.defaultSchema = true;
+        schemas << s;
+      }
+
+      foreach (SqlSchema s, schemas) {
+        QList<SqlTable> cached;
+        if (cache.tables(s.name, cached)) {
+          add(s, cached, tables, fields);
+        }
+      }
+    }
+
+    if (!tables.isEmpty()) {
+      send(QSharedPointer<const SqlContext>(new SqlContext(tables, fields)),
+           true);
+      tables.clear();
+      fields.clear();
+    }
+
+    // the connection can't be shared with the GUI thread
+    QString name = QString("context-%1")
+        .arg(ContextService::connectionCount.fetchAndAddOrdered(1));
+    bool opened;
+    {
+      QSqlDatabase clone = QSqlDatabase::cloneDatabase(db, name);
+      opened = clone.open();
+      if (opened) {
+        load(clone, tables, fields);
+      }
+      clone.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+
+    // the cached context is kept when the catalog can't be read
+    QSharedPointer<const SqlContext> context;
+    if (opened) {
+      context = QSharedPointer<const SqlContext>(new SqlContext(tables,
+                                                                fields));
+    }
+    send(context, false);
+  }
+
+private:
+  void add(SqlSchema schema, QList<SqlTable> list, QStringList &tables,
+           QMultiMap<QString, QString> &fields) {
+    foreach (SqlTable t, list) {
+      QString name = schema.defaultSchema || schema.name.isEmpty()
+          ? t.name : schema.name + "." + t.name;
+      tables << name;
+      foreach (SqlColumn c, t.columns) {
+        fields.insert(name, c.name);
+      }
+    }
+  }
+
+  void load(QSqlDatabase &clone, QStringList &tables,
+            QMultiMap<QString, QString> &fields) {
+    SqlWrapper *cloneWrapper = wrapper ? wrapper->newInstance(&clone) : NULL;
+
+    if (!cloneWrapper) {
+      foreach (QString t, clone.tables()) {
+        tables << t;
+        QSqlRecord r = clone.record(t);
+        for (int i=0; i<r.count(); i++) {
+          fields.insert(t, r.fieldName(i));
+        }
+      }
+      return;
+    }
+
+    // the columns of a whole schema at once
+    if (cloneWrapper->features().testFlag(SqlWrapper::Schemas)) {
+      foreach (SqlSchema s, cloneWrapper->schemas()) {
+        add(s, cloneWrapper->tables(s.name, QStringList()), tables, fields);
+      }
+    } else {
+      SqlSchema s;
+      s.defaultSchema = true;
+      add(s, cloneWrapper->tables("", QStringList()), tables, fields);
+    }
+
+    delete cloneWrapper;
+  }
+
+  void send(QSharedPointer<const SqlContext> context, bool partial) {
+    QMetaObject::invokeMethod(ContextService::instance, "contextLoaded",
+                              Qt::QueuedConnection,
+                              Q_ARG(QString, connection),
+                              Q_ARG(QSharedPointer<const SqlContext>, context),
+                              Q_ARG(bool, partial));
+  }
+
+  QString connection;
+  QSqlDatabase db;
+  SqlWrapper *wrapper;
+};
+
+ContextService::ContextService(QObject *parent)
+  : QObject(parent) {
+  qRegisterMetaType<QSharedPointer<const SqlContext> >(
+        "QSharedPointer<const SqlContext>");
+}
+
+/**
+ * The last context loaded for the connection, null if none is loaded yet : it
+ * will be sent through contextChanged().
+ */
+QSharedPointer<const SqlContext> ContextService::context(QSqlDatabase *db) {
+  QString k = key(db);
+  if (!entries.contains(k)) {
+    Entry e;
+    e.loading = false;
+    e.stale = false;
+    entries.insert(k, e);
+  }
+
+  Entry &e = entries[k];
+  if (!e.context && !e.loading) {
+    load(db, e);
+  }
+  return e.context;
+}
+
+/**
+ * @param context
+ *    null if the catalog couldn't be read
+ * @param partial
+ *    read from the cache, the catalog will follow
+ */
+void ContextService::contextLoaded(QString connection,
+                                   QSharedPointer<const SqlContext> context,
+                                   bool partial) {
+  if (!entries.contains(connection)) {
+    return;
+  }
+
+  Entry &e = entries[connection];
+  if (context) {
+    e.context = context;
+    emit contextChanged(connection);
+  }
+
+  if (partial) {
+    return;
+  }
+
+  e.loading = false;
+  if (e.stale) {
+    e.stale = false;
+    // the connection may have been closed meanwhile
+    foreach (Connection *c, DbManager::instance->connections()) {
+      if (key(c->db()) == connection) {
+        load(c->db(), e);
+        break;
+      }
+    }
+  }
+}
+
+void ContextService::init() {
+  instance = new ContextService();
+}
+
+/**
+ * Identifies the connection, as for the MetadataCache : connections to the
+ * same database share their context.
+ */
+QString ContextService::key(QSqlDatabase *db) {
+  return MetadataCache::key(db);
+}
+
+void ContextService::load(QSqlDatabase *db, Entry &entry) {
+  if (!db->isOpen()) {
+    return;
+  }
+
+  entry.loading = true;
+  QThreadPool::globalInstance()->start(
+        new ContextLoad(db, DbManager::instance->wrapper(db)));
+}
+
+/**
+ * Loads the context again, e.g. once the structure of the database changed.
+ */
+void ContextService::reload(QSqlDatabase *db) {
+  QString k = key(db);
+  if (!entries.contains(k)) {
+    context(db);
+    return;
+  }
+
+  Entry &e = entries[k];
+  if (e.loading) {
+    e.stale = true;
+  } else {
+    load(db, e);
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef CONTEXTSERVICE_H
+#define CONTEXTSERVICE_H
+
+#include "../plugins/sqlwrapper.h"
+#include "../tools/sqlcontext.h"
+
+#include <QAtomicInt>
+#include <QMap>
+#include <QMetaType>
+#include <QObject>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+
+/**
+ * Tables and columns of each connection, for the highlighting and the
+ * completion of the editors.
+ *
+ * The context of a connection is loaded once on the global QThreadPool and
+ * shared by all its editors : they never wait for the catalog. It is first
+ * read from the MetadataCache, then from the catalog with
+ * SqlWrapper::tables(), which reads the columns of a whole schema at once.
+ * Each version is published through contextChanged().
+ */
+class ContextService : public QObject {
+Q_OBJECT
+public:
+  ContextService(QObject *parent = 0);
+
+  QSharedPointer<const SqlContext> context(QSqlDatabase *db);
+  void reload(QSqlDatabase *db);
+
+  static void init();
+  static QString key(QSqlDatabase *db);
+  static ContextService *instance;
+
+signals:
+  /**
+   * A new context of the connection is available.
+   *
+   * @param connection
+   *    see key()
+   */
+  void contextChanged(QString connection);
+
+private slots:
+  void contextLoaded(QString connection,
+                     QSharedPointer<const SqlContext> context, bool partial);
+
+private:
+  struct Entry {
+    QSharedPointer<const SqlContext> context;
+    bool loading;
+    /** Reloaded while it was loading. */
+    bool stale;
+  };
+
+  void load(QSqlDatabase *db, Entry &entry);
+
+  QMap<QString, Entry> entries;
+
+  static QAtomicInt connectionCount;
+
+  friend class ContextLoad;
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<const SqlContext>)
+
+#endif // CONTEXTSERVICE_H
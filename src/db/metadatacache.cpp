@@ -0,0 +1,394 @@
+#include "metadatacache.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QVariant>
+
+QAtomicInt MetadataCache::connectionCount;
+
+static QDataStream &operator<<(QDataStream &out, const SqlColumn &c) {
+  out << c.name << c.primaryKey << c.type.name << c.permitsNull
+      << c.defaultValue << c.comment;
+  return out;
+}
+
+static QDataStream &operator>>(QDataStream &in, SqlColumn &c) {
+  in >> c.name >> c.primaryKey >> c.type.name >> c.permitsNull
+     >> c.defaultValue >> c.comment;
+  c.type.hasSize = false;
+  c.type.size = 0;
+  return in;
+}
+
+static QDataStream &operator<<(QDataStream &out, const SqlTable &t) {
+  out << t.name << (qint32) t.columnCount << t.owner << (qint32) t.type
+      << t.comment << t.columns;
+  return out;
+}
+
+static QDataStream &operator>>(QDataStream &in, SqlTable &t) {
+  qint32 columnCount, type;
+  in >> t.name >> columnCount >> t.owner >> type >> t.comment >> t.columns;
+  t.columnCount = columnCount;
+  t.type = (TableType) type;
+  return in;
+}
+
+static QByteArray serialize(const SqlTable &t) {
+  QByteArray data;
+  QDataStream out(&data, QIODevice::WriteOnly);
+  out << t;
+  return data;
+}
+
+/**
+ * @param connection
+ *    key of the connection, see key()
+ */
+MetadataCache::MetadataCache(QString connection) {
+  this->connection = connection;
+
+  name = QString("metadata-cache-%1")
+      .arg(connectionCount.fetchAndAddOrdered(1));
+  db = QSqlDatabase::addDatabase("QSQLITE", name);
+  db.setDatabaseName(path());
+  // other connections may be writing their own metadata
+  db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+
+  if (!db.open()) {
+    qDebug() << db.lastError().text();
+    return;
+  }
+
+  QStringList sql;
+  sql << "CREATE TABLE IF NOT EXISTS schemas ("
+         "connection TEXT PRIMARY KEY, data BLOB)";
+  sql << "CREATE TABLE IF NOT EXISTS tablesets ("
+         "connection TEXT, schema TEXT, version TEXT, "
+         "PRIMARY KEY (connection, schema))";
+  sql << "CREATE TABLE IF NOT EXISTS tables ("
+         "connection TEXT, schema TEXT, name TEXT, version TEXT, data BLOB, "
+         "PRIMARY KEY (connection, schema, name))";
+
+  QSqlQuery query(db);
+  foreach (QString s, sql) {
+    if (!query.exec(s)) {
+      qDebug() << query.lastError().text();
+      db.close();
+      return;
+    }
+  }
+}
+
+MetadataCache::~MetadataCache() {
+  db.close();
+  db = QSqlDatabase();
+  QSqlDatabase::removeDatabase(name);
+}
+
+/**
+ * Catalog version stored with the tables of a schema.
+ */
+QString MetadataCache::catalogVersion(QString schema) {
+  if (!isOpen()) {
+    return "";
+  }
+
+  QSqlQuery query(db);
+  query.prepare("SELECT version FROM tablesets "
+                "WHERE connection = ? AND schema = ?");
+  query.addBindValue(connection);
+  query.addBindValue(schema);
+  if (!query.exec() || !query.next()) {
+    return "";
+  }
+
+  return query.value(0).toString();
+}
+
+/**
+ * Key of a connection in the cache.
+ */
+QString MetadataCache::key(QSqlDatabase *db) {
+  return QString("%1|%2|%3|%4|%5")
+      .arg(db->driverName())
+      .arg(db->hostName())
+      .arg(db->port())
+      .arg(db->userName())
+      .arg(db->databaseName());
+}
+
+QString MetadataCache::path() {
+  QString dir = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+  QDir().mkpath(dir);
+  return dir + "/metadata.sqlite";
+}
+
+/**
+ * @return false if the schemas of this connection are not in the cache
+ */
+bool MetadataCache::schemas(QList<SqlSchema> &schemas) {
+  if (!isOpen()) {
+    return false;
+  }
+
+  QSqlQuery query(db);
+  query.prepare("SELECT data FROM schemas WHERE connection = ?");
+  query.addBindValue(connection);
+  if (!query.exec() || !query.next()) {
+    return false;
+  }
+
+  QByteArray data = query.value(0).toByteArray();
+  QDataStream in(&data, QIODevice::ReadOnly);
+  qint32 count;
+  in >> count;
+  for (int i=0; i<count && in.status() == QDataStream::Ok; i++) {
+    SqlSchema s;
+    in >> s.name >> s.defaultSchema >> s.owner;
+    schemas << s;
+  }
+
+  return in.status() == QDataStream::Ok;
+}
+
+/**
+ * Stores the schemas, without their tables : those are stored by setTables().
+ *
+ * @return true if the schemas differ from the ones in the cache
+ */
+bool MetadataCache::setSchemas(const QList<SqlSchema> &schemas) {
+  QByteArray data;
+  QDataStream out(&data, QIODevice::WriteOnly);
+  out << (qint32) schemas.size();
+  foreach (SqlSchema s, schemas) {
+    out << s.name << s.defaultSchema << s.owner;
+  }
+
+  if (!isOpen()) {
+    return true;
+  }
+
+  QSqlQuery query(db);
+  query.prepare("SELECT data FROM schemas WHERE connection = ?");
+  query.addBindValue(connection);
+  if (query.exec() && query.next() && query.value(0).toByteArray() == data) {
+    return false;
+  }
+
+  query.prepare("INSERT OR REPLACE INTO schemas (connection, data) "
+                "VALUES (?, ?)");
+  query.addBindValue(connection);
+  query.addBindValue(data);
+  if (!query.exec()) {
+    qDebug() << query.lastError().text();
+  }
+
+  return true;
+}
+
+/**
+ * Replaces all the tables of a schema.
+ *
+ * @return true if the tables differ from the ones in the cache
+ */
+bool MetadataCache::setTables(QString schema, const QList<SqlTable> &tables,
+                              const QMap<QString, QString> &versions,
+                              QString catalogVersion) {
+  if (!isOpen()) {
+    return true;
+  }
+
+  QList<SqlTable> cached;
+  bool changed = !this->tables(schema, cached)
+      || cached.size() != tables.size();
+  for (int i=0; !changed && i<tables.size(); i++) {
+    changed = serialize(cached[i]) != serialize(tables[i]);
+  }
+
+  if (!changed && catalogVersion == this->catalogVersion(schema)
+      && versions == tableVersions(schema)) {
+    return false;
+  }
+
+  db.transaction();
+
+  QSqlQuery query(db);
+  query.prepare("DELETE FROM tables WHERE connection = ? AND schema = ?");
+  query.addBindValue(connection);
+  query.addBindValue(schema);
+  query.exec();
+
+  query.prepare("INSERT OR REPLACE INTO tablesets "
+                "(connection, schema, version) VALUES (?, ?, ?)");
+  query.addBindValue(connection);
+  query.addBindValue(schema);
+  query.addBindValue(catalogVersion);
+  query.exec();
+
+  if (!storeTables(schema, tables, versions)) {
+    db.rollback();
+    return changed;
+  }
+
+  db.commit();
+  return changed;
+}
+
+bool MetadataCache::storeTables(QString schema, const QList<SqlTable> &tables,
+                                const QMap<QString, QString> &versions) {
+  QSqlQuery query(db);
+  query.prepare("INSERT OR REPLACE INTO tables "
+                "(connection, schema, name, version, data) "
+                "VALUES (?, ?, ?, ?, ?)");
+
+  foreach (SqlTable t, tables) {
+    query.addBindValue(connection);
+    query.addBindValue(schema);
+    query.addBindValue(t.name);
+    query.addBindValue(versions.value(t.name));
+    query.addBindValue(serialize(t));
+    if (!query.exec()) {
+      qDebug() << query.lastError().text();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @return false if the table is not in the cache
+ */
+bool MetadataCache::table(QString schema, QString name, SqlTable &table) {
+  if (!isOpen()) {
+    return false;
+  }
+
+  QSqlQuery query(db);
+  query.prepare("SELECT data FROM tables "
+                "WHERE connection = ? AND schema = ? AND name = ?");
+  query.addBindValue(connection);
+  query.addBindValue(schema);
+  query.addBindValue(name);
+  if (!query.exec() || !query.next()) {
+    return false;
+  }
+
+  QByteArray data = query.value(0).toByteArray();
+  QDataStream in(&data, QIODevice::ReadOnly);
+  in >> table;
+  return in.status() == QDataStream::Ok;
+}
+
+/**
+ * @param schema
+ *    empty if the DBMS has no schemas
+ *
+ * @return false if the tables of the schema are not in the cache
+ */
+bool MetadataCache::tables(QString schema, QList<SqlTable> &tables) {
+  if (!isOpen()) {
+    return false;
+  }
+
+  QSqlQuery query(db);
+  query.prepare("SELECT COUNT(*) FROM tablesets "
+                "WHERE connection = ? AND schema = ?");
+  query.addBindValue(connection);
+  query.addBindValue(schema);
+  if (!query.exec() || !query.next() || query.value(0).toInt() == 0) {
+    return false;
+  }
+
+  query.setForwardOnly(true);
+  query.prepare("SELECT data FROM tables "
+                "WHERE connection = ? AND schema = ? ORDER BY name");
+  query.addBindValue(connection);
+  query.addBindValue(schema);
+  if (!query.exec()) {
+    qDebug() << query.lastError().text();
+    return false;
+  }
+
+  while (query.next()) {
+    QByteArray data = query.value(0).toByteArray();
+    QDataStream in(&data, QIODevice::ReadOnly);
+    SqlTable t;
+    in >> t;
+    if (in.status() != QDataStream::Ok) {
+      tables.clear();
+      return false;
+    }
+    tables << t;
+  }
+
+  return true;
+}
+
+QMap<QString, QString> MetadataCache::tableVersions(QString schema) {
+  QMap<QString, QString> versions;
+
+  if (!isOpen()) {
+    return versions;
+  }
+
+  QSqlQuery query(db);
+  query.setForwardOnly(true);
+  query.prepare("SELECT name, version FROM tables "
+                "WHERE connection = ? AND schema = ?");
+  query.addBindValue(connection);
+  query.addBindValue(schema);
+  if (!query.exec()) {
+    qDebug() << query.lastError().text();
+    return versions;
+  }
+
+  while (query.next()) {
+    versions[query.value(0).toString()] = query.value(1).toString();
+  }
+
+  return versions;
+}
+
+/**
+ * Replaces some tables of a schema and removes others, the rest is kept.
+ */
+void MetadataCache::updateTables(QString schema, const QList<SqlTable> &tables,
+                                 const QMap<QString, QString> &versions,
+                                 QStringList removed, QString catalogVersion) {
+  if (!isOpen()) {
+    return;
+  }
+
+  db.transaction();
+
+  QSqlQuery query(db);
+  query.prepare("DELETE FROM tables "
+                "WHERE connection = ? AND schema = ? AND name = ?");
+  foreach (QString name, removed) {
+    query.addBindValue(connection);
+    query.addBindValue(schema);
+    query.addBindValue(name);
+    query.exec();
+  }
+
+  query.prepare("INSERT OR REPLACE INTO tablesets "
+                "(connection, schema, version) VALUES (?, ?, ?)");
+  query.addBindValue(connection);
+  query.addBindValue(schema);
+  query.addBindValue(catalogVersion);
+  query.exec();
+
+  if (!storeTables(schema, tables, versions)) {
+    db.rollback();
+    return;
+  }
+
+  db.commit();
+}
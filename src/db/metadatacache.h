@@ -0,0 +1,58 @@
+#ifndef METADATACACHE_H
+#define METADATACACHE_H
+
+#include "../db_enum.h"
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMap>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+
+/**
+ * Local copy of the metadata of the connections, kept in a SQLite file in the
+ * application data directory so that the tree can be shown before the
+ * catalog has been read again.
+ *
+ * Tables are stored one by one with the version given by
+ * SqlWrapper::tableVersions() : only the tables whose version changed need to
+ * be fetched again.
+ *
+ * An instance opens its own connection to the file and must only be used from
+ * the thread that created it.
+ */
+class MetadataCache {
+public:
+  MetadataCache(QString connection);
+  ~MetadataCache();
+
+  QString catalogVersion(QString schema);
+  bool isOpen() { return db.isOpen(); };
+  bool schemas(QList<SqlSchema> &schemas);
+  bool setSchemas(const QList<SqlSchema> &schemas);
+  bool setTables(QString schema, const QList<SqlTable> &tables,
+                 const QMap<QString, QString> &versions,
+                 QString catalogVersion);
+  bool table(QString schema, QString name, SqlTable &table);
+  bool tables(QString schema, QList<SqlTable> &tables);
+  QMap<QString, QString> tableVersions(QString schema);
+  void updateTables(QString schema, const QList<SqlTable> &tables,
+                    const QMap<QString, QString> &versions,
+                    QStringList removed, QString catalogVersion);
+
+  static QString key(QSqlDatabase *db);
+  static QString path();
+
+private:
+  bool storeTables(QString schema, const QList<SqlTable> &tables,
+                   const QMap<QString, QString> &versions);
+
+  QString connection;
+  QSqlDatabase db;
+  QString name;
+
+  static QAtomicInt connectionCount;
+};
+
+#endif // METADATACACHE_H
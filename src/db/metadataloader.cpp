@@ -0,0 +1,317 @@
+#include "metadataloader.h"
+
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlRecord>
+#include <QStringList>
+
+QAtomicInt MetadataLoader::connectionCount;
+
+/**
+ * @param wrapper
+ *    wrapper of the connection, only used to create another instance bound to
+ *    the clone. May be NULL.
+ */
+MetadataLoader::MetadataLoader(QSqlDatabase *db, SqlWrapper *wrapper,
+                               QObject *parent)
+  : QThread(parent) {
+  this->db = *db;
+  this->wrapper = wrapper;
+
+  cacheKey = MetadataCache::key(db);
+  hasSchemas = wrapper && wrapper->features().testFlag(SqlWrapper::Schemas);
+  lastId = 0;
+  stopping = false;
+
+  qRegisterMetaType<MetadataLoader::Result>("MetadataLoader::Result");
+
+  connect(this, SIGNAL(finished()), this, SLOT(deleteLater()));
+}
+
+/**
+ * The result of the request will not be sent. A request already running is
+ * not interrupted, its result is dropped.
+ */
+void MetadataLoader::cancel(int id) {
+  QMutexLocker locker(&mutex);
+  canceled << id;
+}
+
+/**
+ * Queues a request.
+ *
+ * @param name
+ *    schema name for Tables, table name for Columns
+ * @param schema
+ *    schema of the table for Columns
+ *
+ * @return the id given back in the result
+ */
+int MetadataLoader::load(Kind kind, QString name, QString schema) {
+  Request r;
+  r.id = ++lastId;
+  r.kind = kind;
+  r.name = name;
+  r.schema = schema;
+
+  QMutexLocker locker(&mutex);
+  queue.enqueue(r);
+  wakeUp.wakeOne();
+
+  return r.id;
+}
+
+/**
+ * Reads the tables of a schema, from the cache when their version did not
+ * change.
+ *
+ * @param cached
+ *    the tables were read from the cache and sent
+ * @param upToDate
+ *    set to true if they are still valid
+ */
+QList<SqlTable> MetadataLoader::loadTables(QString schema,
+                                           SqlWrapper *cloneWrapper,
+                                           MetadataCache &cache, bool cached,
+                                           bool *upToDate) {
+  *upToDate = false;
+
+  // without cache, the columns are only read when a table is expanded
+  if (!cache.isOpen()) {
+    return cloneWrapper->tableList(schema);
+  }
+
+  QString catalogVersion = cloneWrapper->catalogVersion();
+  if (cached && !catalogVersion.isEmpty()
+      && catalogVersion == cache.catalogVersion(schema)) {
+    *upToDate = true;
+    return QList<SqlTable>();
+  }
+
+  QMap<QString, QString> versions = cloneWrapper->tableVersions(schema);
+
+  // first load, or no versions : everything is read again
+  if (!cached || versions.isEmpty()) {
+    QList<SqlTable> tables = cloneWrapper->tables(schema, QStringList());
+    *upToDate = !cache.setTables(schema, tables, versions, catalogVersion)
+        && cached;
+    return tables;
+  }
+
+  QMap<QString, QString> cachedVersions = cache.tableVersions(schema);
+
+  QStringList changed;
+  foreach (QString name, versions.keys()) {
+    if (!cachedVersions.contains(name)
+        || cachedVersions.value(name) != versions.value(name)) {
+      changed << name;
+    }
+  }
+
+  QStringList removed;
+  foreach (QString name, cachedVersions.keys()) {
+    if (!versions.contains(name)) {
+      removed << name;
+    }
+  }
+
+  QList<SqlTable> tables;
+  if (!changed.isEmpty()) {
+    tables = cloneWrapper->tables(schema, changed);
+  }
+
+  cache.updateTables(schema, tables, versions, removed, catalogVersion);
+
+  if (changed.isEmpty() && removed.isEmpty()) {
+    *upToDate = true;
+    return QList<SqlTable>();
+  }
+
+  tables.clear();
+  cache.tables(schema, tables);
+  return tables;
+}
+
+/**
+ * Reads the columns of a table, from the cache when the table is there : it
+ * is checked each time the tables of its schema are loaded.
+ */
+QList<SqlColumn> MetadataLoader::loadColumns(QString schema, QString table,
+                                             QSqlDatabase &clone,
+                                             SqlWrapper *cloneWrapper,
+                                             MetadataCache &cache) {
+  QList<SqlColumn> columns;
+
+  SqlTable t;
+  if (cache.table(schema, table, t)) {
+    return t.columns;
+  }
+
+  if (cloneWrapper) {
+    QList<SqlTable> tables = cloneWrapper->tables(schema,
+                                                  QStringList() << table);
+    if (!tables.isEmpty()) {
+      columns = tables[0].columns;
+    }
+    return columns;
+  }
+
+  QSqlRecord r = clone.record(table);
+  for (int i=0; i<r.count(); i++) {
+    SqlColumn c;
+    c.name = r.fieldName(i);
+    c.permitsNull = true;
+    c.primaryKey = false;
+    columns << c;
+  }
+
+  return columns;
+}
+
+MetadataLoader::Result MetadataLoader::process(const Request &request,
+                                               QSqlDatabase &clone,
+                                               SqlWrapper *cloneWrapper,
+                                               MetadataCache &cache,
+                                               bool cached) {
+  Result result;
+  result.id = request.id;
+  result.kind = request.kind;
+  result.ok = true;
+  result.partial = false;
+  result.upToDate = false;
+
+  if (!clone.isOpen() && !clone.open()) {
+    result.ok = false;
+    result.errorString = clone.lastError().text();
+    return result;
+  }
+
+  switch (request.kind) {
+  case Catalog:
+    if (hasSchemas) {
+      result.schemas = cloneWrapper->schemas();
+      result.upToDate = !cache.setSchemas(result.schemas) && cached;
+    } else if (cloneWrapper) {
+      result.tables = loadTables("", cloneWrapper, cache, cached,
+                                 &result.upToDate);
+    } else {
+      foreach (QString s, clone.tables(QSql::Tables)) {
+        SqlTable t;
+        t.name = s;
+        t.type = Table;
+        result.tables << t;
+      }
+
+      foreach (QString s, clone.tables(QSql::Views)) {
+        SqlTable t;
+        t.name = s;
+        t.type = ViewTable;
+        result.tables << t;
+      }
+    }
+    break;
+
+  case Tables:
+    if (cloneWrapper) {
+      result.tables = loadTables(request.name, cloneWrapper, cache, cached,
+                                 &result.upToDate);
+    }
+    break;
+
+  case Columns:
+    result.columns = loadColumns(request.schema, request.name, clone,
+                                 cloneWrapper, cache);
+    break;
+  }
+
+  return result;
+}
+
+/**
+ * Reads the result of a request from the cache.
+ *
+ * @return false if the cache has nothing for this request
+ */
+bool MetadataLoader::readCache(const Request &request, MetadataCache &cache,
+                               Result &result) {
+  result.id = request.id;
+  result.kind = request.kind;
+  result.ok = true;
+  result.partial = true;
+  result.upToDate = false;
+
+  switch (request.kind) {
+  case Catalog:
+    if (hasSchemas) {
+      return cache.schemas(result.schemas);
+    }
+    return wrapper && cache.tables("", result.tables);
+
+  case Tables:
+    return wrapper && cache.tables(request.name, result.tables);
+
+  default:
+    return false;
+  }
+}
+
+void MetadataLoader::run() {
+  // the connection can't be shared with the GUI thread
+  QString name = QString("metadata-%1")
+      .arg(connectionCount.fetchAndAddOrdered(1));
+
+  {
+    QSqlDatabase clone = QSqlDatabase::cloneDatabase(db, name);
+    SqlWrapper *cloneWrapper = wrapper ? wrapper->newInstance(&clone) : NULL;
+    MetadataCache cache(cacheKey);
+
+    forever {
+      mutex.lock();
+      while (queue.isEmpty() && !stopping) {
+        wakeUp.wait(&mutex);
+      }
+      if (stopping) {
+        mutex.unlock();
+        break;
+      }
+      Request r = queue.dequeue();
+      bool skip = canceled.remove(r.id);
+      mutex.unlock();
+
+      if (skip) {
+        continue;
+      }
+
+      Result result;
+      bool cached = readCache(r, cache, result);
+      if (cached) {
+        emit loaded(result);
+      }
+
+      result = process(r, clone, cloneWrapper, cache, cached);
+
+      mutex.lock();
+      skip = canceled.remove(r.id) || stopping;
+      mutex.unlock();
+
+      if (!skip) {
+        emit loaded(result);
+      }
+    }
+
+    delete cloneWrapper;
+    clone.close();
+  }
+  QSqlDatabase::removeDatabase(name);
+}
+
+/**
+ * Asks the thread to stop once the running request is done. The loader
+ * deletes itself when the thread is finished.
+ */
+void MetadataLoader::stop() {
+  QMutexLocker locker(&mutex);
+  stopping = true;
+  queue.clear();
+  wakeUp.wakeAll();
+}
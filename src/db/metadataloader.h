@@ -0,0 +1,100 @@
+#ifndef METADATALOADER_H
+#define METADATALOADER_H
+
+#include "../db_enum.h"
+#include "../plugins/sqlwrapper.h"
+#include "metadatacache.h"
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMetaType>
+#include <QMutex>
+#include <QQueue>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QThread>
+#include <QWaitCondition>
+
+/**
+ * Loads the metadata of a connection (schemas, tables, columns) on its own
+ * thread, so that the GUI never waits for the catalog queries.
+ *
+ * The thread works on a clone of the connection, opened on the first request
+ * and kept until stop(). Requests are run one at a time, in order, and their
+ * results are sent back through loaded().
+ *
+ * Schemas and tables are first read from the MetadataCache and sent as a
+ * partial result, then checked against the catalog : only the tables whose
+ * version changed are fetched again.
+ */
+class MetadataLoader : public QThread {
+Q_OBJECT
+public:
+  enum Kind {
+    Catalog,  // schemas, or tables when the wrapper has no schemas
+    Tables,   // tables of a schema
+    Columns   // columns of a table
+  };
+
+  struct Result {
+    int id;
+    Kind kind;
+    bool ok;
+    /** Read from the cache, the checked result will follow. */
+    bool partial;
+    /** The cached result sent before is still valid, nothing else is set. */
+    bool upToDate;
+    QString errorString;
+    QList<SqlSchema> schemas;
+    QList<SqlTable> tables;
+    QList<SqlColumn> columns;
+  };
+
+  MetadataLoader(QSqlDatabase *db, SqlWrapper *wrapper, QObject *parent = 0);
+
+  void cancel(int id);
+  int load(Kind kind, QString name = "", QString schema = "");
+  void stop();
+
+signals:
+  void loaded(MetadataLoader::Result result);
+
+protected:
+  void run();
+
+private:
+  struct Request {
+    int id;
+    Kind kind;
+    QString name;
+    QString schema;
+  };
+
+  QList<SqlColumn> loadColumns(QString schema, QString table,
+                               QSqlDatabase &clone, SqlWrapper *cloneWrapper,
+                               MetadataCache &cache);
+  QList<SqlTable> loadTables(QString schema, SqlWrapper *cloneWrapper,
+                             MetadataCache &cache, bool cached,
+                             bool *upToDate);
+  Result process(const Request &request, QSqlDatabase &clone,
+                 SqlWrapper *cloneWrapper, MetadataCache &cache, bool cached);
+  bool readCache(const Request &request, MetadataCache &cache,
+                 Result &result);
+
+  QString cacheKey;
+  QSet<int> canceled;
+  QSqlDatabase db;
+  bool hasSchemas;
+  int lastId;
+  QMutex mutex;
+  QQueue<Request> queue;
+  bool stopping;
+  QWaitCondition wakeUp;
+  SqlWrapper *wrapper;
+
+  static QAtomicInt connectionCount;
+};
+
+Q_DECLARE_METATYPE(MetadataLoader::Result)
+
+#endif // METADATALOADER_H
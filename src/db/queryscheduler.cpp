@@ -0,0 +1,482 @@
+#include "queryscheduler.h"
+
+#include "../config.h"
+#include "../dbmanager.h"
+
+QueryScheduler* QueryScheduler::instance;
+
+QueryScheduler::QueryScheduler(QObject *parent)
+  : QAbstractTableModel(parent) {
+  lastId = 0;
+  running = 0;
+  m_maxPerConnection = qMax(1, Config::queryMaxPerConnection);
+  m_maxRunning = qMax(1, Config::queryMaxRunning);
+  workers.setMaxThreadCount(m_maxRunning);
+
+  refreshTimer = new QTimer(this);
+  refreshTimer->setInterval(RefreshInterval);
+  connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refreshElapsed()));
+}
+
+int QueryScheduler::add(Task task) {
+  task.id = ++lastId;
+  task.state = Pending;
+  task.holdsSlot = false;
+  task.waited.start();
+  task.waitedTime = 0;
+  task.elapsedTime = 0;
+
+  beginInsertRows(QModelIndex(), tasks.size(), tasks.size());
+  tasks << task;
+  endInsertRows();
+
+  trimFinished();
+  schedule();
+
+  if (!refreshTimer->isActive()) {
+    refreshTimer->start();
+  }
+
+  emit queueChanged();
+
+  return task.id;
+}
+
+int QueryScheduler::addJob(QObject *job, QRunnable *runnable, QSqlDatabase db,
+                           QString description, Priority priority) {
+  connect(job, SIGNAL(finished(bool)), this, SLOT(onJobFinished(bool)));
+
+  Task t;
+  t.connection = db.connectionName();
+  t.title = DbManager::dbTitle(&db);
+  t.description = description;
+  t.priority = priority;
+  t.job = job;
+  t.runnable = runnable;
+
+  return add(t);
+}
+
+/**
+ * Drops a pending task, interrupts a running one.
+ */
+void QueryScheduler::cancel(int id) {
+  int r = row(id);
+  if (r < 0) {
+    return;
+  }
+
+  Task &t = tasks[r];
+  if (t.state == Running) {
+    if (t.provider) {
+      t.provider->stop();
+    }
+    cancelJob(t);
+    return;
+  }
+
+  if (t.state != Pending) {
+    return;
+  }
+
+  if (t.provider) {
+    t.provider->cancel();
+  }
+
+  // the job must still run to report its end, it stops at once
+  if (t.job) {
+    cancelJob(t);
+    workers.start(t.runnable);
+  }
+
+  finish(r, Canceled);
+}
+
+bool QueryScheduler::canStart(const Task &task) {
+  int free = m_maxRunning - running;
+  if (free <= 0 || (task.priority == Background && free <= 1
+                    && m_maxRunning > 1)) {
+    return false;
+  }
+
+  return connectionLoad.value(task.connection) < m_maxPerConnection;
+}
+
+void QueryScheduler::cancelJob(Task &task) {
+  if (task.job) {
+    QMetaObject::invokeMethod(task.job, "cancel", Qt::DirectConnection);
+  }
+}
+
+/**
+ * Removes the finished tasks from the queue view.
+ */
+void QueryScheduler::clearFinished() {
+  for (int r=tasks.size() - 1; r>=0; r--) {
+    if (tasks[r].state > Running && !tasks[r].holdsSlot) {
+      beginRemoveRows(QModelIndex(), r, r);
+      tasks.removeAt(r);
+      endRemoveRows();
+    }
+  }
+}
+
+int QueryScheduler::columnCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant QueryScheduler::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= tasks.size()) {
+    return QVariant();
+  }
+
+  const Task &t = tasks[index.row()];
+
+  if (role == Qt::ToolTipRole) {
+    if (index.column() == StateColumn && !t.errorString.isEmpty()) {
+      return t.errorString;
+    }
+    if (index.column() == QueryColumn) {
+      return t.description;
+    }
+    return QVariant();
+  }
+
+  if (role == Qt::TextAlignmentRole && index.column() >= WaitedColumn) {
+    return (int) (Qt::AlignRight | Qt::AlignVCenter);
+  }
+
+  if (role != Qt::DisplayRole) {
+    return QVariant();
+  }
+
+  qint64 waited = t.state == Pending ? t.waited.elapsed() : t.waitedTime;
+  qint64 elapsed = t.state == Running ? t.elapsed.elapsed() : t.elapsedTime;
+
+  switch (index.column()) {
+  case StateColumn:
+    switch (t.state) {
+    case Pending:   return tr("Pending");
+    case Running:   return tr("Running");
+    case Finished:  return tr("Finished");
+    case Failed:    return tr("Failed");
+    case Canceled:  return tr("Canceled");
+    }
+    break;
+
+  case PriorityColumn:
+    switch (t.priority) {
+    case Interactive: return tr("Interactive");
+    case Normal:      return tr("Normal");
+    case Background:  return tr("Background");
+    }
+    break;
+
+  case ConnectionColumn:
+    return t.title;
+
+  case QueryColumn:
+    return t.description.simplified();
+
+  case WaitedColumn:
+    return tr("%1 s").arg(waited / 1000.0, 0, 'f', 1);
+
+  case ElapsedColumn:
+    if (t.state == Pending) {
+      return QVariant();
+    }
+    return tr("%1 s").arg(elapsed / 1000.0, 0, 'f', 1);
+  }
+
+  return QVariant();
+}
+
+void QueryScheduler::finish(int row, State state) {
+  Task &t = tasks[row];
+  if (t.state == Pending) {
+    t.waitedTime = t.waited.elapsed();
+  } else if (t.state == Running) {
+    t.elapsedTime = t.elapsed.elapsed();
+  }
+
+  // a failure is reported before the end of the thread
+  if (t.state != Failed || state == Failed) {
+    t.state = state;
+  }
+
+  if (t.holdsSlot) {
+    t.holdsSlot = false;
+    running--;
+    connectionLoad[t.connection]--;
+  }
+
+  emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+
+  schedule();
+
+  emit queueChanged();
+}
+
+QVariant QueryScheduler::headerData(int section, Qt::Orientation orientation,
+                                    int role) const {
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+    return QVariant();
+  }
+
+  switch (section) {
+  case StateColumn:       return tr("State");
+  case PriorityColumn:    return tr("Priority");
+  case ConnectionColumn:  return tr("Connection");
+  case QueryColumn:       return tr("Query");
+  case WaitedColumn:      return tr("Waited");
+  case ElapsedColumn:     return tr("Elapsed");
+  default:                return QVariant();
+  }
+}
+
+void QueryScheduler::init() {
+  instance = new QueryScheduler();
+}
+
+void QueryScheduler::onJobFinished(bool ok) {
+  for (int r=0; r<tasks.size(); r++) {
+    if (tasks[r].job == sender() && tasks[r].state <= Running) {
+      finish(r, ok ? Finished : Failed);
+      return;
+    }
+  }
+}
+
+void QueryScheduler::onProviderComplete() {
+  for (int r=0; r<tasks.size(); r++) {
+    Task &t = tasks[r];
+    if (t.provider == sender() && t.state == Running) {
+      t.elapsedTime = t.elapsed.elapsed();
+      return;
+    }
+  }
+}
+
+void QueryScheduler::onProviderError() {
+  for (int r=0; r<tasks.size(); r++) {
+    Task &t = tasks[r];
+    if (t.provider == sender() && t.state == Running) {
+      t.errorString = t.provider->lastError().text();
+      t.state = Failed;
+      t.elapsedTime = t.elapsed.elapsed();
+      emit dataChanged(index(r, 0), index(r, ColumnCount - 1));
+      return;
+    }
+  }
+}
+
+/**
+ * The thread of a provider is done. The signal is queued : the provider may
+ * already have been started again, its task is then left running.
+ */
+void QueryScheduler::onProviderFinished() {
+  for (int r=0; r<tasks.size(); r++) {
+    Task &t = tasks[r];
+    if (t.provider == sender() && t.holdsSlot && !t.provider->isRunning()) {
+      finish(r, Finished);
+    }
+  }
+}
+
+/**
+ * Updates the elapsed times shown in the view.
+ */
+void QueryScheduler::refreshElapsed() {
+  int first = -1;
+  int last = -1;
+  for (int r=0; r<tasks.size(); r++) {
+    if (tasks[r].state <= Running) {
+      if (first < 0) {
+        first = r;
+      }
+      last = r;
+    }
+  }
+
+  if (first < 0) {
+    refreshTimer->stop();
+    return;
+  }
+
+  emit dataChanged(index(first, WaitedColumn), index(last, ElapsedColumn));
+}
+
+int QueryScheduler::pendingCount() {
+  int count = 0;
+  foreach (Task t, tasks) {
+    if (t.state == Pending) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+int QueryScheduler::row(int id) const {
+  for (int r=0; r<tasks.size(); r++) {
+    if (tasks[r].id == id) {
+      return r;
+    }
+  }
+
+  return -1;
+}
+
+int QueryScheduler::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : tasks.size();
+}
+
+/**
+ * Starts the pending tasks allowed by the limits, by priority.
+ */
+void QueryScheduler::schedule() {
+  forever {
+    int next = -1;
+    for (int r=0; r<tasks.size(); r++) {
+      const Task &t = tasks[r];
+      if (t.state != Pending || !canStart(t)) {
+        continue;
+      }
+      if (next < 0 || t.priority < tasks[next].priority) {
+        next = r;
+      }
+    }
+
+    if (next < 0) {
+      return;
+    }
+
+    start(next);
+  }
+}
+
+void QueryScheduler::setMaxPerConnection(int count) {
+  m_maxPerConnection = qMax(1, count);
+  schedule();
+}
+
+void QueryScheduler::setMaxRunning(int count) {
+  m_maxRunning = qMax(1, count);
+  workers.setMaxThreadCount(m_maxRunning);
+  schedule();
+}
+
+void QueryScheduler::start(int row) {
+  Task &t = tasks[row];
+  t.state = Running;
+  t.holdsSlot = true;
+  t.waitedTime = t.waited.elapsed();
+  t.elapsed.start();
+  running++;
+  connectionLoad[t.connection]++;
+
+  if (t.provider) {
+    t.provider->start();
+  } else if (t.job) {
+    workers.start(t.runnable);
+  } else {
+    // deleted while pending
+    finish(row, Canceled);
+    return;
+  }
+
+  emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+}
+
+/**
+ * Queues the run of a data provider, in place of the provider's start().
+ * A run of the same provider still pending is replaced.
+ *
+ * @param description
+ *    shown in the queue view, usually the query
+ *
+ * @return id of the task
+ */
+int QueryScheduler::submit(DataProvider *provider, QString description,
+                           Priority priority) {
+  for (int r=0; r<tasks.size(); r++) {
+    Task &t = tasks[r];
+    if (t.provider != provider) {
+      continue;
+    }
+
+    if (t.state == Pending) {
+      finish(r, Canceled);
+    } else if (t.holdsSlot && !provider->isRunning()) {
+      // stopped and waited for by its owner, finished() is still queued
+      finish(r, Finished);
+    }
+  }
+
+  connect(provider, SIGNAL(complete()), this, SLOT(onProviderComplete()),
+          Qt::UniqueConnection);
+  connect(provider, SIGNAL(error()), this, SLOT(onProviderError()),
+          Qt::UniqueConnection);
+  connect(provider, SIGNAL(finished()), this, SLOT(onProviderFinished()),
+          Qt::UniqueConnection);
+
+  QSqlDatabase db = provider->database();
+
+  Task t;
+  t.connection = db.connectionName();
+  t.title = DbManager::dbTitle(&db);
+  t.description = description;
+  t.priority = priority;
+  t.provider = provider;
+  t.runnable = NULL;
+
+  return add(t);
+}
+
+/**
+ * Queues an export job, in place of QThreadPool::start().
+ *
+ * @param db
+ *    connection the job reads from
+ */
+int QueryScheduler::submit(ExportJob *job, QSqlDatabase db,
+                           QString description, Priority priority) {
+  return addJob(job, job, db, description, priority);
+}
+
+/**
+ * Queues an import job, in place of QThreadPool::start().
+ *
+ * @param db
+ *    connection the job writes to
+ */
+int QueryScheduler::submit(ImportJob *job, QSqlDatabase db,
+                           QString description, Priority priority) {
+  return addJob(job, job, db, description, priority);
+}
+
+/**
+ * Id of the task shown at a row of the view.
+ */
+int QueryScheduler::taskId(int row) {
+  if (row < 0 || row >= tasks.size()) {
+    return -1;
+  }
+
+  return tasks[row].id;
+}
+
+/**
+ * Forgets the oldest finished tasks beyond MaxFinished.
+ */
+void QueryScheduler::trimFinished() {
+  int finished = 0;
+  for (int r=tasks.size() - 1; r>=0; r--) {
+    if (tasks[r].state > Running && !tasks[r].holdsSlot
+        && ++finished > MaxFinished) {
+      beginRemoveRows(QModelIndex(), r, r);
+      tasks.removeAt(r);
+      endRemoveRows();
+    }
+  }
+}
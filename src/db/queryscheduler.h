@@ -0,0 +1,149 @@
+#ifndef QUERYSCHEDULER_H
+#define QUERYSCHEDULER_H
+
+#include "../plugins/exportjob.h"
+#include "../plugins/importjob.h"
+#include "../resultview/dataprovider.h"
+
+#include <QAbstractTableModel>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QPointer>
+#include <QSqlDatabase>
+#include <QThreadPool>
+#include <QTimer>
+
+/**
+ * Runs the queries of the whole application : data providers of the tabs,
+ * export and import jobs.
+ *
+ * At most maxRunning() tasks run at once, and at most maxPerConnection() on
+ * the same connection. Pending tasks are started by priority, then in order
+ * of submission. Background tasks never take the last free slot, so that an
+ * interactive query never waits behind exports.
+ *
+ * Data providers run on their own thread, jobs on the scheduler's
+ * thread pool. A slot is released once the provider's thread is finished,
+ * i.e. once its connection is back in the pool.
+ *
+ * The scheduler is also the model of the queue view : one row per task,
+ * pending, running or finished.
+ */
+class QueryScheduler : public QAbstractTableModel {
+Q_OBJECT
+public:
+  enum Priority {
+    Interactive,
+    Normal,
+    Background
+  };
+
+  enum State {
+    Pending,
+    Running,
+    Finished,
+    Failed,
+    Canceled
+  };
+
+  enum Column {
+    StateColumn,
+    PriorityColumn,
+    ConnectionColumn,
+    QueryColumn,
+    WaitedColumn,
+    ElapsedColumn,
+    ColumnCount
+  };
+
+  QueryScheduler(QObject *parent = 0);
+
+  int maxPerConnection() { return m_maxPerConnection; };
+  int maxRunning() { return m_maxRunning; };
+  void setMaxPerConnection(int count);
+  void setMaxRunning(int count);
+  int pendingCount();
+  int runningCount() { return running; };
+  int submit(DataProvider *provider, QString description,
+             Priority priority = Interactive);
+  int submit(ExportJob *job, QSqlDatabase db, QString description,
+             Priority priority = Background);
+  int submit(ImportJob *job, QSqlDatabase db, QString description,
+             Priority priority = Background);
+  int taskId(int row);
+
+  // QAbstractItemModel
+  int columnCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+
+  static void init();
+  static QueryScheduler *instance;
+
+  static const int MaxFinished = 100;
+  static const int RefreshInterval = 1000;
+
+signals:
+  /**
+   * A task was queued, started or finished.
+   */
+  void queueChanged();
+
+public slots:
+  void cancel(int id);
+  void clearFinished();
+
+private:
+  struct Task {
+    int id;
+    /** Connection name, the per-connection limit applies to it. */
+    QString connection;
+    QString description;
+    QString title;
+    Priority priority;
+    State state;
+    QPointer<DataProvider> provider;
+    /** Export or import job, with a cancel() slot. */
+    QPointer<QObject> job;
+    QRunnable *runnable;
+    QString errorString;
+    /** Counts against the limits. */
+    bool holdsSlot;
+    QElapsedTimer waited;
+    QElapsedTimer elapsed;
+    qint64 waitedTime;
+    qint64 elapsedTime;
+  };
+
+  int add(Task task);
+  int addJob(QObject *job, QRunnable *runnable, QSqlDatabase db,
+             QString description, Priority priority);
+  bool canStart(const Task &task);
+  void cancelJob(Task &task);
+  void finish(int row, State state);
+  int row(int id) const;
+  void schedule();
+  void start(int row);
+  void trimFinished();
+
+  QMap<QString, int> connectionLoad;
+  int lastId;
+  int m_maxPerConnection;
+  int m_maxRunning;
+  QTimer *refreshTimer;
+  int running;
+  QList<Task> tasks;
+  QThreadPool workers;
+
+private slots:
+  void onJobFinished(bool ok);
+  void onProviderComplete();
+  void onProviderError();
+  void onProviderFinished();
+  void refreshElapsed();
+};
+
+#endif // QUERYSCHEDULER_H
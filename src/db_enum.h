@@ -4,6 +4,7 @@
 #include "plugins/sqlwrapper.h"
 
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 
 enum ColumnFamily {
@@ -47,6 +48,21 @@ struct SqlTable {
   QString comment;
 };
 
+/**
+ * A delimited text file to load into a table, see SqlWrapper::bulkLoad().
+ * Names are already escaped for the driver.
+ */
+struct SqlBulkLoad {
+  QString path;
+  QString table;
+  /** Target of each field of the file, empty if the field is skipped. */
+  QStringList columns;
+  QChar separator;
+  /** Null if the fields are never quoted. */
+  QChar quote;
+  bool header;
+};
+
 struct SqlSchema {
   bool defaultSchema;
   QString name;
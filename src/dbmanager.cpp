@@ -1,5 +1,6 @@
 #include "dbmanager.h"
 #include "db_enum.h"
+#include "db/contextservice.h"
 #include "iconmanager.h"
 #include "tools/logger.h"
 #include "mainwindow.h"
@@ -16,7 +17,7 @@ DbManager::DbManager()
   closingAll = false;
   nconn = 0;
   m_driverModel = new QStandardItemModel(this);
-  m_model = new QStandardItemModel(this);
+  m_model = new CatalogModel(this);
 
   lastUsedDbIndex = 0;
 
@@ -82,21 +83,10 @@ int DbManager::addDatabase(QString driver, QString host, QString user,
     title = alias;
   }
 
-  dbMap[newDb] = new QStandardItem(title);
-  dbMap[newDb]->setEditable(false);
-
-  dbMap[newDb]->setData(DbManager::DbItem, Qt::UserRole);
-  dbMap[newDb]->setIcon(IconManager::get("database_connect"));
-  dbMap[newDb]->setToolTip(dbToolTip(newDb));
-
-  QList<QStandardItem*> uiItemList;
-  // name
-  uiItemList << dbMap[newDb];
-  // icon (= DBMS icon)
-  uiItemList << new QStandardItem(driverIcon[driver], "");
-  uiItemList[1]->setSelectable(false);
-
-  m_model->appendRow(uiItemList);
+  // the DBMS icon is shown in the second column
+  dbMap[newDb] = m_model->appendConnection(title, driverIcon[driver]);
+  m_model->setIcon(dbMap[newDb], IconManager::get("database_connect"));
+  m_model->setToolTip(dbMap[newDb], dbToolTip(newDb));
 
   SqlWrapper *wrapper = NULL;
   if (wrapperName.length() > 0) {
@@ -116,24 +106,49 @@ int DbManager::addDatabase(QString driver, QString host, QString user,
   return m_connections.size() - 1;
 }
 
-QStandardItem* DbManager::columnsItem(QList<SqlColumn> columns) {
-  QStandardItem *cItem =
-      new QStandardItem(IconManager::get("folder_columns"),
-                        tr("Columns (%1)")
-                        .arg(columns.size()));
+/**
+ * Appends a "Columns" folder and its columns.
+ */
+void DbManager::appendColumns(QList<CatalogModel::Entry> &entries,
+                              QList<SqlColumn> columns) {
+  int folder = entries.size();
+  entries << entry(-1, CatalogModel::ColumnsFolder,
+                   tr("Columns (%1)").arg(columns.size()));
 
   foreach (SqlColumn c, columns) {
-    QStandardItem *i = new QStandardItem();
-    i->setText(c.name);
-    if (c.primaryKey) {
-      i->setIcon(IconManager::get("column_key"));
-    } else {
-      i->setIcon(IconManager::get("column"));
+    entries << entry(folder, CatalogModel::ColumnNode, c.name, c.primaryKey);
+  }
+}
+
+/**
+ * Appends a "Tables" or "Views" folder and the tables of this type.
+ */
+void DbManager::appendTables(QList<CatalogModel::Entry> &entries,
+                             QList<SqlTable> tables, TableType type) {
+  int count = 0;
+  foreach (SqlTable t, tables) {
+    if (t.type == type) {
+      count++;
     }
-    cItem->appendRow(i);
   }
 
-  return cItem;
+  int folder = entries.size();
+  if (type == ViewTable) {
+    entries << entry(-1, CatalogModel::ViewsFolder,
+                     tr("Views (%1)").arg(count));
+  } else {
+    entries << entry(-1, CatalogModel::TablesFolder,
+                     tr("Tables (%1)").arg(count));
+  }
+
+  // columns are loaded when the table is expanded
+  foreach (SqlTable t, tables) {
+    if (t.type == type) {
+      entries << entry(folder, type == ViewTable
+                       ? CatalogModel::ViewNode : CatalogModel::TableNode,
+                       t.name);
+    }
+  }
 }
 
 QString DbManager::dbTitle(QSqlDatabase *db) {
@@ -211,6 +226,16 @@ QStandardItemModel *DbManager::driverModel() {
   return m_driverModel;
 }
 
+CatalogModel::Entry DbManager::entry(int parent, CatalogModel::NodeType type,
+                                     QString name, bool primaryKey) {
+  CatalogModel::Entry e;
+  e.parent = parent;
+  e.type = type;
+  e.name = name;
+  e.primaryKey = primaryKey;
+  return e;
+}
+
 QString DbManager::genConnectionName() {
   nconn++;
   return QString::number(nconn);
@@ -244,6 +269,113 @@ QString DbManager::lastError() {
   return lastErr;
 }
 
+/**
+ * Loads metadata for an item of the tree. A load still pending for the same
+ * item is canceled.
+ */
+void DbManager::load(QModelIndex index, MetadataLoader::Kind kind,
+                     QString name, QString schema) {
+  MetadataLoader *loader = loaders.value(parentDb(index), NULL);
+  if (!loader) {
+    return;
+  }
+
+  foreach (int id, pendingLoads.keys()) {
+    if (pendingLoads[id].index == index) {
+      pendingLoads[id].loader->cancel(id);
+      pendingLoads.remove(id);
+    }
+  }
+
+  PendingLoad pending;
+  pending.loader = loader;
+  pending.index = index;
+  pendingLoads[loader->load(kind, name, schema)] = pending;
+}
+
+/**
+ * Queues the load of the children of a schema, a table or a view.
+ */
+void DbManager::loadIndex(const QModelIndex &index) {
+  switch (m_model->type(index)) {
+  case CatalogModel::SchemaNode:
+    load(index, MetadataLoader::Tables, index.data().toString());
+    break;
+
+  case CatalogModel::TableNode:
+  case CatalogModel::ViewNode:
+    load(index, MetadataLoader::Columns, index.data().toString(),
+         parentSchema(index));
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+ * Fills the tree with the metadata loaded in background. A result read from
+ * the cache is shown at once and replaced if the catalog changed since.
+ */
+void DbManager::onMetadataLoaded(MetadataLoader::Result result) {
+  MetadataLoader *loader = (MetadataLoader*) sender();
+  if (!pendingLoads.contains(result.id)
+      || pendingLoads[result.id].loader != loader) {
+    return;
+  }
+
+  // a partial result is followed by the checked one
+  QPersistentModelIndex index = result.partial
+      ? pendingLoads.value(result.id).index
+      : pendingLoads.take(result.id).index;
+  if (!index.isValid() || result.upToDate) {
+    return;
+  }
+
+  QSqlDatabase *db = parentDb(index);
+
+  if (result.kind == MetadataLoader::Catalog) {
+    m_model->setIcon(index, IconManager::get("database"));
+  }
+
+  QList<CatalogModel::Entry> entries;
+
+  if (!result.ok) {
+    Logger::instance->logError(tr("Unable to load the structure of %1: %2")
+                               .arg(dbTitle(db))
+                               .arg(result.errorString));
+    m_model->setChildren(index, entries);
+    return;
+  }
+
+  SqlWrapper *wrapper = dbWrappers.value(db, NULL);
+
+  switch (result.kind) {
+  case MetadataLoader::Catalog:
+    if (wrapper && wrapper->features().testFlag(SqlWrapper::Schemas)) {
+      entries << entry(-1, CatalogModel::SchemasFolder,
+                       tr("Schemas (%1)").arg(result.schemas.size()));
+      foreach (SqlSchema s, result.schemas) {
+        entries << entry(0, CatalogModel::SchemaNode, s.name);
+      }
+    } else {
+      appendTables(entries, result.tables, Table);
+      appendTables(entries, result.tables, ViewTable);
+    }
+    break;
+
+  case MetadataLoader::Tables:
+    appendTables(entries, result.tables, Table);
+    break;
+
+  case MetadataLoader::Columns:
+    appendColumns(entries, result.columns);
+    break;
+  }
+
+  m_model->setChildren(index, entries);
+}
+
 void DbManager::openList() {
   QSettings s;
 
@@ -258,11 +390,28 @@ void DbManager::openList() {
     pswd = s.value("password", QVariant(QString::null)).toString();
     alias = s.value("alias", "").toString();
     wrapper = s.value("wrapper", "").toString();
-    addDatabase(driver, host, user, pswd, name, alias, wrapper, false);
+    int index = addDatabase(driver, host, user, pswd, name, alias, wrapper,
+                            false);
+    m_connections[index]->setStatementTimeout(
+          s.value("statement_timeout", 0).toInt());
   }
   s.endArray();
 }
 
+/**
+ * Name of the schema holding an item, empty if the connection has no schemas.
+ */
+QString DbManager::parentSchema(QModelIndex index) {
+  while (index != QModelIndex()) {
+    if (index.data(Qt::UserRole) == DbManager::SchemaItem) {
+      return index.data().toString();
+    }
+    index = index.parent();
+  }
+
+  return "";
+}
+
 QSqlDatabase *DbManager::parentDb(QModelIndex index) {
   while (index != QModelIndex()) {
     if (index.data(Qt::UserRole) == DbManager::DbItem) {
@@ -280,41 +429,21 @@ void DbManager::refreshModel() {
   }
 }
 
+/**
+ * Loads again the children of an item.
+ */
 void DbManager::refreshModelIndex(QModelIndex index) {
-  if (!index.data(Qt::UserRole).canConvert(QVariant::Int)) {
-    return;
-  }
-
-  QStandardItem *it = m_model->itemFromIndex(index);
-  if (!it) {
-    return;
-  }
-
-  SqlWrapper *wrapper = dbWrappers.value(parentDb(index), NULL);
-  if (!wrapper) {
-    return;
-  }
-
-  QList<QStandardItem*> toAppend;
-  switch (index.data(Qt::UserRole).toInt()) {
-  case DbManager::SchemaItem:
-    toAppend << tablesItem(wrapper->tables(index.data().toString()),
-                           index.data().toString());
-    break;
-
-  case DbManager::TableItem:
-    toAppend << columnsItem(wrapper->columns(index.data().toString()));
+  switch (m_model->type(index)) {
+  case CatalogModel::SchemaNode:
+  case CatalogModel::TableNode:
+  case CatalogModel::ViewNode:
+    m_model->setLoading(index);
+    loadIndex(index);
     break;
 
   default:
     break;
   }
-
-  while (it->rowCount() > 0) {
-    it->removeRow(0);
-  }
-
-  it->appendRows(toAppend);
 }
 
 void DbManager::refreshModelItem() {
@@ -326,6 +455,9 @@ void DbManager::refreshModelItem(Connection *connection) {
 }
 
 /**
+ * Reloads the tree of a connection. The metadata are loaded in background,
+ * see onMetadataLoaded().
+ *
  * @bug check indexes
  */
 void DbManager::refreshModelItem(QSqlDatabase *db) {
@@ -333,68 +465,28 @@ void DbManager::refreshModelItem(QSqlDatabase *db) {
     return;
   }
 
-  QStandardItem *item = dbMap[db];
-  item->setIcon(IconManager::get("database_refresh"));
-  item->setToolTip(dbToolTip(db));
-
-  QStandardItem *schemaItem = NULL;
+  QModelIndex index = dbMap[db];
+  m_model->setToolTip(index, dbToolTip(db));
 
-  QModelIndex index = m_model->indexFromItem(item);
   if (db->isOpen()) {
-    while (m_model->rowCount(index) > 0) {
-      m_model->removeRow(0, index);
-    }
-
-    SqlWrapper *wrapper = dbWrappers.value(db, NULL);
-
-    if (wrapper) {
-      if (wrapper->features().testFlag(SqlWrapper::Schemas)) {
-        QList<SqlSchema> schemas = wrapper->schemas();
-
-        schemaItem = new QStandardItem(tr("Schemas (%1)")
-                                       .arg(schemas.size()));
-        schemaItem->setIcon(IconManager::get("folder_schemas"));
-
-        foreach (SqlSchema s, schemas) {
-          schemaItem->appendRow(this->schemaItem(s));
-        }
-
-        item->appendRow(schemaItem);
-      } else {
-        QList<SqlTable> tables = wrapper->tables();
-
-        item->appendRow(tablesItem(tables));
-        item->appendRow(viewsItem(tables));
-      }
-    } else {
-      QList<SqlTable> tables;
-      foreach (QString s, db->tables(QSql::Tables)) {
-        SqlTable t;
-        t.name = s;
-        t.type = Table;
-        tables << t;
-      }
-
-      item->appendRow(tablesItem(tables));
-
-      QList<SqlTable> views;
-      foreach (QString s, db->tables(QSql::Views)) {
-        SqlTable t;
-        t.name = s;
-        t.type = ViewTable;
-        views << t;
-      }
-
-      item->appendRow(viewsItem(views));
+    m_model->setIcon(index, IconManager::get("database_refresh"));
+    m_model->setLoading(index);
+
+    if (!loaders.contains(db)) {
+      MetadataLoader *loader = new MetadataLoader(db,
+                                                  dbWrappers.value(db, NULL));
+      connect(loader, SIGNAL(loaded(MetadataLoader::Result)),
+              this, SLOT(onMetadataLoaded(MetadataLoader::Result)));
+      loaders[db] = loader;
+      loader->start();
     }
 
-    item->setIcon(IconManager::get("database"));
-
+    load(index, MetadataLoader::Catalog);
+    ContextService::instance->reload(db);
   } else {
-    item->setIcon(IconManager::get("database_connect"));
-    while (m_model->rowCount(index) > 0) {
-      m_model->removeRow(0, index);
-    }
+    stopLoader(db);
+    m_model->clear(index);
+    m_model->setIcon(index, IconManager::get("database_connect"));
   }
 }
 
@@ -412,7 +504,7 @@ void DbManager::removeDatabase(Connection *connection) {
   }
 
   connection->close();
-  m_model->removeRow(m_connections.indexOf(connection));
+  m_model->removeNode(dbMap[db]);
   dbMap.remove(db);
   m_connections.removeAll(connection);
   saveList();
@@ -435,10 +527,11 @@ void DbManager::saveList() {
       s.setValue("password", db->password());
     }
     s.setValue("database", db->databaseName());
-    s.setValue("alias", dbMap[db]->text());
+    s.setValue("alias", dbMap[db].data().toString());
     if (dbWrappers.contains(db) && dbWrappers[db]) {
       s.setValue("wrapper", dbWrappers[db]->plid());
     }
+    s.setValue("statement_timeout", c->statementTimeout());
   }
   s.endArray();
   s.sync();
@@ -454,23 +547,10 @@ SqlSchema DbManager::schema(QSqlDatabase *db, QString schemaName) {
   return schema;
 }
 
-QStandardItem* DbManager::schemaItem(SqlSchema schema) {
-  QStandardItem *sitem = new QStandardItem(schema.name);
-  sitem->setIcon(IconManager::get("schema"));
-  sitem->setData(schema.name, Qt::ToolTipRole);
-  sitem->setData(DbManager::SchemaItem, Qt::UserRole);
-
-  QString prefix;
-  if (!schema.defaultSchema) {
-    prefix = schema.name;
-  }
-
-  sitem->appendRow(new QStandardItem(IconManager::get("view-refresh"), ""));
-
-  return sitem;
-}
 
 void DbManager::setupConnections() {
+  connect(m_model, SIGNAL(fetchRequested(QModelIndex)),
+          this, SLOT(loadIndex(QModelIndex)));
 }
 
 void DbManager::setupModels() {
@@ -518,8 +598,29 @@ void DbManager::setupModels() {
   }
 
   m_driverModel->sort(0);
+}
+
+/**
+ * Stops the metadata loader of a connection and forgets its pending loads.
+ */
+void DbManager::stopLoader(QSqlDatabase *db) {
+  MetadataLoader *loader = loaders.take(db);
+  if (!loader) {
+    return;
+  }
+
+  foreach (int id, pendingLoads.keys()) {
+    if (pendingLoads[id].loader == loader) {
+      pendingLoads.remove(id);
+    }
+  }
+
+  disconnect(loader, 0, this, 0);
+  loader->stop();
 
-  m_model->setHorizontalHeaderItem(0, new QStandardItem(tr("Database")));
+  if (closingAll) {
+    loader->wait();
+  }
 }
 
 SqlTable DbManager::table(QSqlDatabase *db, QString tbl) {
@@ -541,62 +642,10 @@ SqlTable DbManager::table(QSqlDatabase *db, QString tbl) {
   return table;
 }
 
-QStandardItem *DbManager::tablesItem(QList<SqlTable> tables,
-                                            QString schema) {
-  QStandardItem *tablesItem = new QStandardItem();
-  tablesItem->setIcon(IconManager::get("folder_tables"));
-
-  foreach (SqlTable table, tables) {
-    if (table.type == Table) {
-      QStandardItem *i = new QStandardItem(IconManager::get("table"),
-                                           table.name);
-      i->setData(DbManager::TableItem, Qt::UserRole);
-      if (schema.length() == 0) {
-        i->setData(table.name, Qt::ToolTipRole);
-      } else {
-        i->setData(QString(schema + "." + table.name), Qt::ToolTipRole);
-      }
-//      i->appendRow(new QStandardItem(IconManager::get("view-refresh"), ""));
-      if (table.columns.size() > 0) {
-        i->appendRow(columnsItem(table.columns));
-      }
-      tablesItem->appendRow(i);
-    }
-  }
-
-  tablesItem->setText(tr("Tables (%1)")
-                      .arg(tablesItem->rowCount()));
-
-  return tablesItem;
-}
-
-QStandardItem *DbManager::viewsItem(QList<SqlTable> tables,
-                                           QString schema) {
-  QStandardItem *viewsItem = new QStandardItem();
 
-  viewsItem->setIcon(IconManager::get("folder_views"));
-
-  foreach (SqlTable table, tables) {
-    if (table.type == ViewTable) {
-      QStandardItem *i = new QStandardItem(IconManager::get("table_lightning"),
-                                           table.name);
-      i->setData(DbManager::ViewItem, Qt::UserRole);
-      if (schema.length() == 0) {
-        i->setData(table.name, Qt::ToolTipRole);
-      } else {
-        i->setData(QString(schema + "." + table.name), Qt::ToolTipRole);
-      }
-      viewsItem->appendRow(i);
-    }
-  }
-
-  viewsItem->setText(tr("Views (%1)").arg(viewsItem->rowCount()));
-
-  return viewsItem;
-}
 
 void DbManager::update(Connection *connection, QString alias) {
-  dbMap[connection->db()]->setText(alias);
+  m_model->setName(dbMap[connection->db()], alias);
   refreshModelItem(connection);
 
   saveList();
@@ -610,10 +659,30 @@ void DbManager::updateLastDbIndex() {
  * Getters & setters
  */
 
+/**
+ * The connection owning a handle, NULL if there is none.
+ */
+Connection* DbManager::connection(QSqlDatabase *db) {
+  foreach (Connection *c, m_connections) {
+    if (c->db() == db) {
+      return c;
+    }
+  }
+
+  return NULL;
+}
+
 QList<Connection*> DbManager::connections() {
   return m_connections;
 }
 
-QStandardItemModel* DbManager::model() {
+CatalogModel* DbManager::model() {
   return m_model;
 }
+
+/**
+ * The wrapper of a connection, NULL if its DBMS has none.
+ */
+SqlWrapper* DbManager::wrapper(QSqlDatabase *db) {
+  return dbWrappers.value(db, NULL);
+}
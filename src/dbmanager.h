@@ -1,10 +1,13 @@
 #ifndef DBMANAGER_H
 #define DBMANAGER_H
 
+#include "db/catalogmodel.h"
 #include "db/connection.h"
+#include "db/metadataloader.h"
 #include "plugins/sqlwrapper.h"
 
 #include <QList>
+#include <QPersistentModelIndex>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QStack>
@@ -21,13 +24,13 @@ class DbManager : public QObject {
 Q_OBJECT
 public:
   enum ItemTypes {
-    DbItem,
-    DisplayItem,
-    FieldItem,
-    SchemaItem,
-    SysTableItem,
-    TableItem,
-    ViewItem
+    DbItem        = CatalogModel::ConnectionNode,
+    DisplayItem   = CatalogModel::DisplayNode,
+    FieldItem     = CatalogModel::ColumnNode,
+    SchemaItem    = CatalogModel::SchemaNode,
+    SysTableItem  = CatalogModel::SysTableNode,
+    TableItem     = CatalogModel::TableNode,
+    ViewItem      = CatalogModel::ViewNode
   };
 
   DbManager();
@@ -41,12 +44,13 @@ public:
                                       QString alias, QString wrapperName,
                                       bool save =true);
   void                    closeAll();
+  Connection*             connection(QSqlDatabase *db);
   QList<Connection*> connections();
   QStandardItemModel     *driverModel();
   QString                 genConnectionName();
   QStringList             getDbNames(bool);
   QString                 lastError();
-  QStandardItemModel*     model();
+  CatalogModel*           model();
   void                    openList();
   void                    removeDatabase(int);
   void removeDatabase(Connection* connection);
@@ -54,6 +58,7 @@ public:
   SqlSchema               schema(QSqlDatabase *db, QString schemaName);
   SqlTable                table(QSqlDatabase *db, QString tbl);
   void                    update(Connection* connection, QString alias);
+  SqlWrapper*             wrapper(QSqlDatabase *db);
 
   int lastUsedDbIndex;
 
@@ -68,16 +73,26 @@ public slots:
   void refreshModelItem(Connection* connection);
 
 private:
-  QStandardItem*          columnsItem(QList<SqlColumn> columns);
+  struct PendingLoad {
+    MetadataLoader *loader;
+    QPersistentModelIndex index;
+  };
+
+  void                    appendColumns(QList<CatalogModel::Entry> &entries,
+                                        QList<SqlColumn> columns);
+  void                    appendTables(QList<CatalogModel::Entry> &entries,
+                                       QList<SqlTable> tables,
+                                       TableType type);
   QString                 dbToolTip(QSqlDatabase *db);
+  CatalogModel::Entry     entry(int parent, CatalogModel::NodeType type,
+                                QString name, bool primaryKey =false);
+  void                    load(QModelIndex index, MetadataLoader::Kind kind,
+                               QString name ="", QString schema ="");
   QSqlDatabase*           parentDb(QModelIndex index);
+  QString                 parentSchema(QModelIndex index);
   void                    setupConnections();
   void                    setupModels();
-  QStandardItem*          schemaItem(SqlSchema schema);
-  QStandardItem*          tablesItem(QList<SqlTable> tables,
-                                     QString schema ="");
-  QStandardItem*          viewsItem(QList<SqlTable> tables,
-                                    QString schema ="");
+  void                    stopLoader(QSqlDatabase *db);
 
   QMap<QString, QString>  driverAlias;
   QMap<QString, QIcon>    driverIcon;
@@ -85,16 +100,20 @@ private:
   bool                    closingAll;
   QList<Connection*> m_connections;
   QStandardItemModel     *m_driverModel;
-  QMap<QSqlDatabase*, QStandardItem*> dbMap;
+  QMap<QSqlDatabase*, QPersistentModelIndex> dbMap;
   QMap<QSqlDatabase*, SqlWrapper*> dbWrappers;
-  QStandardItemModel     *m_model;
+  QMap<QSqlDatabase*, MetadataLoader*> loaders;
+  CatalogModel           *m_model;
   int                     nconn;
   QString                 lastErr;
+  QMap<int, PendingLoad>  pendingLoads;
 
   QStack<QSqlDatabase*>   closeStack;
   QStack<QSqlDatabase*>   openStack;
 
 private slots:
+  void loadIndex(const QModelIndex &index);
+  void onMetadataLoaded(MetadataLoader::Result result);
   void refreshModelItem();
   void updateLastDbIndex();
 
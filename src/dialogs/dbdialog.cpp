@@ -32,6 +32,7 @@ void DbDialog::apply() {
   db->setPassword(passEdit->text());
   db->setDatabaseName(dbEdit->text());
   connection->setAlias(aliasEdit->text());
+  connection->setStatementTimeout(timeoutSpinBox->value() * 1000);
 
   DbManager::instance->update(connection, aliasEdit->text());
 }
@@ -79,6 +80,7 @@ void DbDialog::reload() {
     dbTypeComboBox->setCurrentDriver(db->driverName());
     dbEdit->setText(db->databaseName());
     aliasEdit->setText(connection->alias());
+    timeoutSpinBox->setValue(connection->statementTimeout() / 1000);
   }
 
   dbBrowseButton->setVisible(false);
@@ -1,4 +1,6 @@
 #include "config.h"
+#include "db/contextservice.h"
+#include "db/queryscheduler.h"
 #include "dbmanager.h"
 #include "iconmanager.h"
 #include "mainwindow.h"
@@ -65,8 +67,11 @@ int main(int argc, char *argv[]) {
   splash.showMessage(QObject::tr("Initialization..."), Qt::AlignBottom);
 
   IconManager::init();
-  DbManager::init();
+  // the connection pools and the scheduler read their limits from the config
   Config::init();
+  ContextService::init();
+  DbManager::init();
+  QueryScheduler::init();
   QueryTextEdit::reloadCompleter();
 
   MainWindow *w = new MainWindow();
@@ -2,6 +2,7 @@
 #include "ui_mainwindow.h"
 
 #include "config.h"
+#include "db/queryscheduler.h"
 #include "dbmanager.h"
 #include "iconmanager.h"
 
@@ -13,6 +14,7 @@
 #include "tabwidget/tablewidget.h"
 #include "tools/logger.h"
 #include "widgets/dbtreeview.h"
+#include "widgets/queryqueueview.h"
 
 #include <QDesktopServices>
 #include <QFileDialog>
@@ -600,6 +602,15 @@ void MainWindow::setupDocks(QSettings *s) {
 
   QToolButton* logButton = setupLogButton(logAct);
   QMainWindow::statusBar()->addWidget(logButton);
+
+  // Queries dock
+  queueDock = new QDockWidget(tr("Queries"), this);
+  queueDock->setObjectName("queueDock");
+  queueDock->setWidget(new QueryQueueView(queueDock));
+  addDockWidget(Qt::BottomDockWidgetArea, queueDock);
+  tabifyDockWidget(logDock, queueDock);
+  queueDock->setVisible(false);
+  menuPanels->addAction(queueDock->toggleViewAction());
 }
 
 void MainWindow::setupIcons() {
@@ -636,6 +647,9 @@ QToolButton* MainWindow::setupLogButton(QAction *logAct) {
 void MainWindow::setupQueriesStatusLabel() {
   queriesStatusLabel = new QLabel("", this);
   QMainWindow::statusBar()->addPermanentWidget(queriesStatusLabel);
+
+  connect(QueryScheduler::instance, SIGNAL(queueChanged()),
+          this, SLOT(updateQueriesStatus()));
 }
 
 void MainWindow::setupRecentFiles(QSettings *s) {
@@ -735,6 +749,20 @@ void MainWindow::setIndentationSpaces(bool enabled) {
   emit indentationChanged();
 }
 
+/**
+ * Shows the number of running and pending queries in the status bar.
+ */
+void MainWindow::updateQueriesStatus() {
+  int running = QueryScheduler::instance->runningCount();
+  int pending = QueryScheduler::instance->pendingCount();
+  if (running == 0 && pending == 0) {
+    queriesStatusLabel->clear();
+  } else {
+    queriesStatusLabel->setText(tr("%1 running, %2 pending")
+                                .arg(running).arg(pending));
+  }
+}
+
 void MainWindow::upperCase() {
   if (currentTab() != 0) {
     currentTab()->upperCase();
@@ -68,6 +68,7 @@ private:
   QString             lastPath;
   SearchDialog       *searchDialog;
   QLabel             *queriesStatusLabel;
+  QDockWidget        *queueDock;
   QList<QAction*>     recentActions;
   QStringList         recentFiles;
 
@@ -95,6 +96,7 @@ private slots:
   void setIndentationSpaces(bool enabled);
   void undo();
   void updateDbActions();
+  void updateQueriesStatus();
   void upperCase();
 };
 
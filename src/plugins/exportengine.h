@@ -5,9 +5,38 @@
 
 #include <QAbstractItemModel>
 #include <QApplication>
-#include <QFile>
+#include <QIODevice>
+#include <QSqlQuery>
+#include <QSqlRecord>
 #include <QWizard>
 
+/**
+ * Writes the rows of one export. A writer is created for each export and is
+ * used from a worker thread : it must not touch the wizard nor any widget.
+ */
+class ExportWriter {
+public:
+  virtual ~ExportWriter() {};
+
+  /**
+   * Starts the output, e.g. writes the header. The header must be written to
+   * the device before returning.
+   */
+  virtual void begin(QIODevice *out, const QSqlRecord &columns) =0;
+  /**
+   * Writes a row already read, e.g. held by a result view.
+   */
+  virtual void writeRecord(const QSqlRecord &record) =0;
+  /**
+   * Writes the current row of the query.
+   */
+  virtual void writeRow(const QSqlQuery &query) =0;
+  /**
+   * Flushes the pending data and ends the output.
+   */
+  virtual void end() =0;
+};
+
 class ExportEngine : public Plugin {
 public:
   /**
@@ -20,9 +49,15 @@ public:
   virtual QString extension() =0;
   virtual QString displayIconCode() { return ""; };
   /**
-   * Traitement de l'export : fonction threadée.
+   * Indique si les fichiers d'un export partitionné peuvent être mis bout à
+   * bout, en sautant l'en-tête de chaque partie.
+   */
+  virtual bool canConcatenate() { return false; };
+  /**
+   * Créé un writer avec les options choisies dans l'assistant. Appelée depuis
+   * le thread graphique, l'export lui-même est threadé.
    */
-  virtual void process(QFile *f) =0;
+  virtual ExportWriter *createWriter() =0;
 
   virtual void setModel(QAbstractItemModel *m) =0;
   virtual void setWizard(QWizard *w) =0;
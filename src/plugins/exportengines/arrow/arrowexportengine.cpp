@@ -0,0 +1,553 @@
+#include "arrowexportengine.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QMap>
+#include <QSharedPointer>
+#include <QSqlField>
+#include <QStringList>
+#include <QtEndian>
+
+#include <cstring>
+
+/*
+ * Minimal flatbuffers encoder, enough for the Arrow metadata (Schema.fbs,
+ * Message.fbs and File.fbs). Objects are written front to back : a table is
+ * preceded by its vtable and followed by its children, so every uoffset
+ * points forward.
+ */
+struct FbObject;
+typedef QSharedPointer<FbObject> FbRef;
+
+struct FbObject {
+  enum Kind {
+    Bytes,
+    Table,
+    TableVector
+  };
+
+  Kind kind;
+
+  // Table
+  QMap<int, QByteArray> scalars;
+  QMap<int, FbRef> children;
+
+  // Bytes : strings and vectors of structs
+  int alignment;
+  QByteArray bytes;
+  int count;
+  bool terminated;
+
+  // TableVector
+  QList<FbRef> items;
+};
+
+// Arrow enums
+static const short MetadataV5 = 4;
+static const uchar HeaderSchema = 1;
+static const uchar HeaderRecordBatch = 3;
+static const uchar TypeInt = 2;
+static const uchar TypeFloatingPoint = 3;
+static const uchar TypeBinary = 4;
+static const uchar TypeUtf8 = 5;
+static const uchar TypeBool = 6;
+static const uchar TypeDate = 8;
+static const uchar TypeTimestamp = 10;
+static const short PrecisionDouble = 2;
+static const short DateUnitDay = 0;
+static const short TimeUnitMillisecond = 1;
+
+static const QByteArray magic("ARROW1", 6);
+
+template <typename T>
+static void appendLE(QByteArray &buf, T value) {
+  uchar data[sizeof(T)];
+  qToLittleEndian(value, data);
+  buf.append((const char*) data, sizeof(T));
+}
+
+template <typename T>
+static void putLE(QByteArray &buf, int pos, T value) {
+  qToLittleEndian(value, (uchar*) buf.data() + pos);
+}
+
+static void pad(QByteArray &buf, int alignment) {
+  while (buf.size() % alignment != 0) {
+    buf.append('\0');
+  }
+}
+
+static FbRef fbTable() {
+  FbRef t(new FbObject());
+  t->kind = FbObject::Table;
+  return t;
+}
+
+template <typename T>
+static void fbScalar(FbRef table, int slot, T value) {
+  QByteArray bytes;
+  appendLE(bytes, value);
+  table->scalars[slot] = bytes;
+}
+
+static FbRef fbString(QString s) {
+  FbRef o(new FbObject());
+  o->kind = FbObject::Bytes;
+  o->alignment = 1;
+  o->bytes = s.toUtf8();
+  o->count = o->bytes.size();
+  o->terminated = true;
+  return o;
+}
+
+static FbRef fbStructs(QByteArray bytes, int count, int alignment) {
+  FbRef o(new FbObject());
+  o->kind = FbObject::Bytes;
+  o->alignment = alignment;
+  o->bytes = bytes;
+  o->count = count;
+  o->terminated = false;
+  return o;
+}
+
+static FbRef fbTables(QList<FbRef> items) {
+  FbRef o(new FbObject());
+  o->kind = FbObject::TableVector;
+  o->items = items;
+  return o;
+}
+
+/**
+ * Writes an object at the end of buf.
+ *
+ * @return the position uoffsets must point to
+ */
+static int fbWrite(QByteArray &buf, const FbRef &o) {
+  if (o->kind == FbObject::Bytes) {
+    // the elements following the length must be aligned
+    pad(buf, 4);
+    if (o->alignment > 4 && (buf.size() + 4) % o->alignment != 0) {
+      buf.append(QByteArray(4, '\0'));
+    }
+
+    int pos = buf.size();
+    appendLE<quint32>(buf, o->count);
+    buf.append(o->bytes);
+    if (o->terminated) {
+      buf.append('\0');
+    }
+    return pos;
+  }
+
+  if (o->kind == FbObject::TableVector) {
+    pad(buf, 4);
+    int pos = buf.size();
+    appendLE<quint32>(buf, o->items.size());
+    buf.append(QByteArray(4 * o->items.size(), '\0'));
+
+    for (int i=0; i<o->items.size(); i++) {
+      int field = pos + 4 + 4 * i;
+      putLE<quint32>(buf, field, fbWrite(buf, o->items[i]) - field);
+    }
+    return pos;
+  }
+
+  // table layout : the biggest fields first, after the vtable soffset
+  QMap<int, int> sizes;
+  int maxSlot = -1;
+  foreach (int slot, o->scalars.keys()) {
+    sizes[slot] = o->scalars[slot].size();
+    maxSlot = qMax(maxSlot, slot);
+  }
+  foreach (int slot, o->children.keys()) {
+    sizes[slot] = 4;
+    maxSlot = qMax(maxSlot, slot);
+  }
+
+  QMap<int, int> offsets;
+  int tableSize = 4;
+  for (int size = 8; size > 0; size /= 2) {
+    foreach (int slot, sizes.keys()) {
+      if (sizes[slot] == size) {
+        // the table itself is aligned on 8 bytes
+        tableSize = (tableSize + size - 1) / size * size;
+        offsets[slot] = tableSize;
+        tableSize += size;
+      }
+    }
+  }
+
+  pad(buf, 2);
+  int vtablePos = buf.size();
+  appendLE<quint16>(buf, 4 + 2 * (maxSlot + 1));
+  appendLE<quint16>(buf, tableSize);
+  for (int slot=0; slot<=maxSlot; slot++) {
+    appendLE<quint16>(buf, offsets.value(slot, 0));
+  }
+
+  pad(buf, 8);
+  int pos = buf.size();
+  buf.append(QByteArray(tableSize, '\0'));
+  putLE<qint32>(buf, pos, pos - vtablePos);
+
+  foreach (int slot, o->scalars.keys()) {
+    const QByteArray &bytes = o->scalars[slot];
+    memcpy(buf.data() + pos + offsets[slot], bytes.constData(), bytes.size());
+  }
+
+  foreach (int slot, o->children.keys()) {
+    int field = pos + offsets[slot];
+    putLE<quint32>(buf, field, fbWrite(buf, o->children[slot]) - field);
+  }
+
+  return pos;
+}
+
+static QByteArray fbFinish(const FbRef &root) {
+  QByteArray buf(4, '\0');
+  putLE<quint32>(buf, 0, fbWrite(buf, root));
+  pad(buf, 8);
+  return buf;
+}
+
+static FbRef arrowField(QString name, ArrowWriter::ColumnType type) {
+  FbRef t = fbTable();
+  uchar typeType;
+
+  switch (type) {
+  case ArrowWriter::BinaryColumn:
+    typeType = TypeBinary;
+    break;
+
+  case ArrowWriter::BoolColumn:
+    typeType = TypeBool;
+    break;
+
+  case ArrowWriter::DateColumn:
+    typeType = TypeDate;
+    fbScalar<qint16>(t, 0, DateUnitDay);
+    break;
+
+  case ArrowWriter::DoubleColumn:
+    typeType = TypeFloatingPoint;
+    fbScalar<qint16>(t, 0, PrecisionDouble);
+    break;
+
+  case ArrowWriter::Int64Column:
+    typeType = TypeInt;
+    fbScalar<qint32>(t, 0, 64);
+    fbScalar<quint8>(t, 1, 1);
+    break;
+
+  case ArrowWriter::TimestampColumn:
+    typeType = TypeTimestamp;
+    fbScalar<qint16>(t, 0, TimeUnitMillisecond);
+    break;
+
+  default:
+    typeType = TypeUtf8;
+  }
+
+  FbRef field = fbTable();
+  field->children[0] = fbString(name);
+  fbScalar<quint8>(field, 1, 1);
+  fbScalar<quint8>(field, 2, typeType);
+  field->children[3] = t;
+  field->children[5] = fbTables(QList<FbRef>());
+  return field;
+}
+
+static FbRef arrowSchema(QStringList names,
+                         QList<ArrowWriter::ColumnType> types) {
+  QList<FbRef> fields;
+  for (int i=0; i<names.size(); i++) {
+    fields << arrowField(names[i], types[i]);
+  }
+
+  FbRef schema = fbTable();
+  fbScalar<qint16>(schema, 0, 0);
+  schema->children[1] = fbTables(fields);
+  return schema;
+}
+
+static FbRef arrowMessage(uchar headerType, FbRef header, qint64 bodyLength) {
+  FbRef message = fbTable();
+  fbScalar<qint16>(message, 0, MetadataV5);
+  fbScalar<quint8>(message, 1, headerType);
+  message->children[2] = header;
+  fbScalar<qint64>(message, 3, bodyLength);
+  return message;
+}
+
+static void setBit(QByteArray &bits, int i, bool value) {
+  if (bits.size() <= i / 8) {
+    bits.append('\0');
+  }
+  if (value) {
+    bits.data()[i / 8] |= (1 << (i % 8));
+  }
+}
+
+ArrowWriter::ArrowWriter() {
+  out = NULL;
+  pos = 0;
+  rows = 0;
+}
+
+void ArrowWriter::begin(QIODevice *out, const QSqlRecord &record) {
+  this->out = out;
+
+  QStringList names;
+  QList<ColumnType> types;
+
+  columns.resize(record.count());
+  for (int i=0; i<record.count(); i++) {
+    Column &c = columns[i];
+    c.name = record.fieldName(i);
+
+    switch (record.field(i).type()) {
+    case QVariant::Bool:
+      c.type = BoolColumn;
+      break;
+
+    case QVariant::ByteArray:
+      c.type = BinaryColumn;
+      break;
+
+    case QVariant::Date:
+      c.type = DateColumn;
+      break;
+
+    case QVariant::DateTime:
+      c.type = TimestampColumn;
+      break;
+
+    case QVariant::Double:
+      c.type = DoubleColumn;
+      break;
+
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+      c.type = Int64Column;
+      break;
+
+    default:
+      c.type = Utf8Column;
+    }
+
+    names << c.name;
+    types << c.type;
+  }
+
+  clearBatch();
+
+  QByteArray header = magic;
+  header.append(QByteArray(2, '\0'));
+  out->write(header);
+  pos = header.size();
+
+  writeMessage(fbFinish(arrowMessage(HeaderSchema,
+                                     arrowSchema(names, types), 0)),
+               QByteArray());
+}
+
+void ArrowWriter::clearBatch() {
+  for (int i=0; i<columns.size(); i++) {
+    Column &c = columns[i];
+    c.nullCount = 0;
+    c.validity.resize(0);
+    c.values.resize(0);
+    c.offsets.resize(0);
+    if (c.type == BinaryColumn || c.type == Utf8Column) {
+      appendLE<qint32>(c.offsets, 0);
+    }
+  }
+  rows = 0;
+}
+
+void ArrowWriter::end() {
+  flushBatch();
+
+  // end-of-stream marker
+  QByteArray eos;
+  appendLE<quint32>(eos, 0xFFFFFFFF);
+  appendLE<qint32>(eos, 0);
+  out->write(eos);
+  pos += eos.size();
+
+  QStringList names;
+  QList<ColumnType> types;
+  foreach (Column c, columns) {
+    names << c.name;
+    types << c.type;
+  }
+
+  QByteArray blockBytes;
+  foreach (Block b, blocks) {
+    appendLE<qint64>(blockBytes, b.offset);
+    appendLE<qint32>(blockBytes, b.metadataLength);
+    appendLE<qint32>(blockBytes, 0);
+    appendLE<qint64>(blockBytes, b.bodyLength);
+  }
+
+  FbRef footer = fbTable();
+  fbScalar<qint16>(footer, 0, MetadataV5);
+  footer->children[1] = arrowSchema(names, types);
+  footer->children[2] = fbStructs(QByteArray(), 0, 8);
+  footer->children[3] = fbStructs(blockBytes, blocks.size(), 8);
+
+  QByteArray tail = fbFinish(footer);
+  appendLE<qint32>(tail, tail.size());
+  tail.append(magic);
+  out->write(tail);
+  pos += tail.size();
+}
+
+/**
+ * Writes the buffered rows as a record batch. Each buffer is padded to 8
+ * bytes inside the body.
+ */
+void ArrowWriter::flushBatch() {
+  if (rows == 0) {
+    return;
+  }
+
+  QByteArray body;
+  QByteArray nodes;
+  QByteArray buffers;
+  int bufferCount = 0;
+
+  foreach (Column c, columns) {
+    appendLE<qint64>(nodes, rows);
+    appendLE<qint64>(nodes, c.nullCount);
+
+    QList<QByteArray> parts;
+    parts << c.validity;
+    if (c.type == BinaryColumn || c.type == Utf8Column) {
+      parts << c.offsets;
+    }
+    parts << c.values;
+
+    foreach (QByteArray part, parts) {
+      appendLE<qint64>(buffers, body.size());
+      appendLE<qint64>(buffers, part.size());
+      body.append(part);
+      pad(body, 8);
+      bufferCount++;
+    }
+  }
+
+  FbRef batch = fbTable();
+  fbScalar<qint64>(batch, 0, rows);
+  batch->children[1] = fbStructs(nodes, columns.size(), 8);
+  batch->children[2] = fbStructs(buffers, bufferCount, 8);
+
+  QByteArray metadata = fbFinish(arrowMessage(HeaderRecordBatch, batch,
+                                             body.size()));
+
+  // record batches are referenced by the footer
+  Block b;
+  b.offset = pos;
+  b.metadataLength = 8 + metadata.size();
+  b.bodyLength = body.size();
+  blocks << b;
+
+  writeMessage(metadata, body);
+  clearBatch();
+}
+
+/**
+ * Writes an encapsulated message : continuation marker, metadata size,
+ * metadata then body.
+ */
+void ArrowWriter::writeMessage(const QByteArray &metadata,
+                               const QByteArray &body) {
+  QByteArray prefix;
+  appendLE<quint32>(prefix, 0xFFFFFFFF);
+  appendLE<qint32>(prefix, metadata.size());
+
+  out->write(prefix);
+  out->write(metadata);
+  out->write(body);
+  pos += prefix.size() + metadata.size() + body.size();
+}
+
+/**
+ * Writes the current row of a query, or a record holding the values.
+ */
+template <class Row>
+void ArrowWriter::write(const Row &row) {
+  for (int i=0; i<columns.size(); i++) {
+    Column &c = columns[i];
+    QVariant value = row.value(i);
+    bool valid = !value.isNull();
+
+    setBit(c.validity, rows, valid);
+    if (!valid) {
+      c.nullCount++;
+    }
+
+    switch (c.type) {
+    case BinaryColumn:
+    case Utf8Column:
+      if (valid) {
+        c.values.append(c.type == BinaryColumn ? value.toByteArray()
+                                               : value.toString().toUtf8());
+      }
+      appendLE<qint32>(c.offsets, c.values.size());
+      break;
+
+    case BoolColumn:
+      setBit(c.values, rows, valid && value.toBool());
+      break;
+
+    case DateColumn:
+      appendLE<qint32>(c.values,
+                       valid ? QDate(1970, 1, 1).daysTo(value.toDate()) : 0);
+      break;
+
+    case DoubleColumn: {
+      double d = valid ? value.toDouble() : 0;
+      quint64 bits;
+      memcpy(&bits, &d, sizeof(bits));
+      appendLE<quint64>(c.values, bits);
+      break;
+    }
+
+    case Int64Column:
+      appendLE<qint64>(c.values, valid ? value.toLongLong() : 0);
+      break;
+
+    case TimestampColumn: {
+      // wall clock time, without time zone
+      QDateTime dt = value.toDateTime();
+      dt = QDateTime(dt.date(), dt.time(), Qt::UTC);
+      appendLE<qint64>(c.values, valid ? dt.toMSecsSinceEpoch() : 0);
+      break;
+    }
+    }
+  }
+
+  rows++;
+  if (rows >= BatchSize) {
+    flushBatch();
+  }
+}
+
+void ArrowWriter::writeRecord(const QSqlRecord &record) {
+  write(record);
+}
+
+void ArrowWriter::writeRow(const QSqlQuery &query) {
+  write(query);
+}
+
+ArrowExportEngine::ArrowExportEngine() {
+  m_wizardPage = NULL;
+}
+
+ExportWriter *ArrowExportEngine::createWriter() {
+  return new ArrowWriter();
+}
@@ -0,0 +1,94 @@
+#ifndef ARROWEXPORTENGINE_H
+#define ARROWEXPORTENGINE_H
+
+#include "../../exportengine.h"
+
+#include <QApplication>
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QVector>
+
+/**
+ * Writes an Arrow IPC file (Feather V2), readable by pyarrow.feather or
+ * pandas.read_feather.
+ *
+ * Rows are buffered column by column and written as record batches of
+ * BatchSize rows. Integers, floats, booleans, dates and timestamps are stored
+ * in their binary form, other values as UTF-8 strings.
+ */
+class ArrowWriter : public ExportWriter {
+public:
+  enum ColumnType {
+    BinaryColumn,
+    BoolColumn,
+    DateColumn,
+    DoubleColumn,
+    Int64Column,
+    TimestampColumn,
+    Utf8Column
+  };
+
+  ArrowWriter();
+
+  void begin(QIODevice *out, const QSqlRecord &columns);
+  void end();
+  void writeRecord(const QSqlRecord &record);
+  void writeRow(const QSqlQuery &query);
+
+  static const int BatchSize = 64 * 1024;
+
+private:
+  template <class Row> void write(const Row &row);
+
+  struct Column {
+    QString name;
+    ColumnType type;
+    int nullCount;
+    QByteArray offsets;
+    QByteArray validity;
+    QByteArray values;
+  };
+
+  struct Block {
+    qint64 offset;
+    int metadataLength;
+    qint64 bodyLength;
+  };
+
+  void clearBatch();
+  void flushBatch();
+  void writeMessage(const QByteArray &metadata, const QByteArray &body);
+
+  QList<Block> blocks;
+  QVector<Column> columns;
+  QIODevice *out;
+  qint64 pos;
+  int rows;
+};
+
+class ArrowExportEngine : public QObject, public ExportEngine {
+Q_OBJECT
+Q_INTERFACES(ExportEngine)
+public:
+  ArrowExportEngine();
+
+  // Fonctions de Plugin
+  QString plid() { return "DBM.ARROW.EXPORTENGINE"; };
+  QString title() { return tr("Arrow export engine"); };
+  QString vendor() { return "DbMaster"; };
+  QString version() { return QApplication::applicationVersion(); };
+
+  // Fonctions de ExportEngine
+  QString displayName() { return tr("Arrow / Feather"); };
+  QString extension() { return "arrow"; };
+  ExportWriter *createWriter();
+
+  void setModel(QAbstractItemModel *m) { model = m; };
+  void setWizard(QWizard *w) { wizard = w; };
+  QWizardPage *wizardPage() { return m_wizardPage; };
+
+protected:
+};
+
+#endif // ARROWEXPORTENGINE_H
@@ -6,51 +6,130 @@
 #include <QDebug>
 #include <QVariant>
 
-CsvExportEngine::CsvExportEngine() {
-  m_wizardPage = new CsvWizardPage();
+/**
+ * @param delimiter
+ *    quote character, only its first character is used. Empty disables
+ *    quoting.
+ */
+CsvWriter::CsvWriter(QString delimiter, QString separator, bool header,
+                     Quoting quoting) {
+  this->delimiter = delimiter.isEmpty() ? QChar() : delimiter.at(0);
+  this->separator = separator;
+  this->header = header;
+  this->quoting = delimiter.isEmpty() ? QuoteNone : quoting;
+
+  columnCount = 0;
+  out = NULL;
 }
 
-void CsvExportEngine::process(QFile *f) {
+/**
+ * Appends a field, doubling the delimiters it contains.
+ */
+void CsvWriter::appendField(const QString &value) {
+  if (quoting == QuoteNone
+      || (quoting == QuoteNeeded && !needsQuotes(value))) {
+    buffer.append(value);
+    return;
+  }
 
-  QString del = wizard->field("csvdelimiter").toString();
-  QString sep = wizard->field("csvseparator").toString();
+  buffer.append(delimiter);
+  const QChar *c = value.constData();
+  const QChar *last = c + value.size();
+  for (; c != last; c++) {
+    buffer.append(*c);
+    if (*c == delimiter) {
+      buffer.append(delimiter);
+    }
+  }
+  buffer.append(delimiter);
+}
 
-  emit progress(-1);
+void CsvWriter::begin(QIODevice *out, const QSqlRecord &columns) {
+  this->out = out;
+  columnCount = columns.count();
+
+  buffer.reserve(BufferSize + 4096);
 
   // columns name (= header)
-  if(wizard->field("csvheader").toBool()) {
-    QStringList columns;
-    for( int i=0; i<model->columnCount(); i++ )
-      columns << model->headerData( i, Qt::Horizontal ).toString()
-                  .prepend( del ).append( del );
-
-    f->write(columns.join(sep).append(sep).toLatin1());
-    f->write("\n");
-  }
-
-
-  /*
-   * Writing data
-   */
-  QModelIndex idx;
-  // échapement des quotes : par exemple " -> \"
-  QString escape = del;
-  escape.prepend("\\");
-  for (int y=0; y<model->rowCount(); y++) {
-    // each row
-
-    for (int x=0; x<model->columnCount(); x++) {
-      // each piece of data
-
-      idx = model->index(y, x);
-      if (idx.data().canConvert(QVariant::String)) {
-        QString data = idx.data().toString().replace(del, escape);
-        f->write(data.prepend(del).append(del + sep).toLatin1());
+  if (header) {
+    for (int i=0; i<columnCount; i++) {
+      if (i > 0) {
+        buffer.append(separator);
       }
+      appendField(columns.fieldName(i));
     }
-    f->write("\n");
+    buffer.append('\n');
+    flush();
+  }
+}
+
+void CsvWriter::end() {
+  flush();
+}
 
-    emit progress(y);
+void CsvWriter::flush() {
+  if (!buffer.isEmpty()) {
+    out->write(buffer.toUtf8());
+    // keeps the allocated capacity
+    buffer.resize(0);
+  }
+}
+
+bool CsvWriter::needsQuotes(const QString &value) {
+  if (separator.size() != 1) {
+    return value.contains(delimiter) || value.contains(separator)
+        || value.contains('\n') || value.contains('\r');
+  }
+
+  QChar sep = separator.at(0);
+  const QChar *c = value.constData();
+  const QChar *last = c + value.size();
+  for (; c != last; c++) {
+    if (*c == delimiter || *c == sep || *c == '\n' || *c == '\r') {
+      return true;
+    }
   }
+  return false;
 }
 
+/**
+ * Writes the current row of a query, or a record holding the values.
+ */
+template <class Row>
+void CsvWriter::write(const Row &row) {
+  for (int x=0; x<columnCount; x++) {
+    // each piece of data
+    if (x > 0) {
+      buffer.append(separator);
+    }
+
+    QVariant value = row.value(x);
+    if (!value.isNull() && value.canConvert(QVariant::String)) {
+      appendField(value.toString());
+    }
+  }
+  buffer.append('\n');
+
+  if (buffer.size() >= BufferSize) {
+    flush();
+  }
+}
+
+void CsvWriter::writeRecord(const QSqlRecord &record) {
+  write(record);
+}
+
+void CsvWriter::writeRow(const QSqlQuery &query) {
+  write(query);
+}
+
+CsvExportEngine::CsvExportEngine() {
+  m_wizardPage = new CsvWizardPage();
+}
+
+ExportWriter *CsvExportEngine::createWriter() {
+  return new CsvWriter(wizard->field("csvdelimiter").toString(),
+                       wizard->field("csvseparator").toString(),
+                       wizard->field("csvheader").toBool(),
+                       (CsvWriter::Quoting) wizard->field("csvquoting").toInt());
+}
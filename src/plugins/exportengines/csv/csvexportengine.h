@@ -6,6 +6,46 @@
 #include <QApplication>
 #include <QObject>
 
+/**
+ * Writes RFC 4180 records in UTF-8.
+ *
+ * Fields are escaped in a single pass into a reusable buffer, which is encoded
+ * and written to the device once it reaches BufferSize characters.
+ */
+class CsvWriter : public ExportWriter {
+public:
+  enum Quoting {
+    QuoteAll,
+    QuoteNeeded,
+    QuoteNone
+  };
+
+  CsvWriter(QString delimiter, QString separator, bool header,
+            Quoting quoting = QuoteAll);
+
+  void begin(QIODevice *out, const QSqlRecord &columns);
+  void end();
+  void writeRecord(const QSqlRecord &record);
+  void writeRow(const QSqlQuery &query);
+
+  static const int BufferSize = 1024 * 1024;
+
+private:
+  template <class Row> void write(const Row &row);
+
+  void appendField(const QString &value);
+  void flush();
+  bool needsQuotes(const QString &value);
+
+  QString buffer;
+  int columnCount;
+  QChar delimiter;
+  bool header;
+  QIODevice *out;
+  Quoting quoting;
+  QString separator;
+};
+
 class CsvExportEngine : public QObject, public ExportEngine {
 Q_OBJECT
 Q_INTERFACES(ExportEngine)
@@ -19,18 +59,16 @@ public:
   QString version() { return QApplication::applicationVersion(); };
 
   // Fonctions de ExportEngine
+  bool canConcatenate() { return true; };
   QString displayIconCode() { return "spreadsheet"; };
   QString displayName() { return tr("CSV"); };
   QString extension() { return "csv"; };
-  void process(QFile *f);
+  ExportWriter *createWriter();
 
   void setModel(QAbstractItemModel *m) { model = m; };
   void setWizard(QWizard *w) { wizard = w; };
   QWizardPage *wizardPage() { return m_wizardPage; };
 
-signals:
-  void progress(int);
-
 protected:
 };
 
@@ -7,5 +7,6 @@ CsvWizardPage::CsvWizardPage(QWidget *parent)
 
   registerField("csvdelimiter", delimiterLineEdit);
   registerField("csvheader"   , headerCheckBox);
+  registerField("csvquoting"  , quotingComboBox);
   registerField("csvseparator", separatorLineEdit);
 }
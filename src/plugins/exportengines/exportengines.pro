@@ -1,2 +1,2 @@
 TEMPLATE=subdirs
-SUBDIRS=csv html #plaintext
+SUBDIRS=arrow csv html #plaintext
@@ -2,6 +2,7 @@ TEMPLATE=lib
 CONFIG+=release plugin
 VERSION=0.8
 INCLUDEPATH+=../../../src/plugins
+QT+=sql
 TARGET=htmlexportengine
 
 HEADERS += \
@@ -1,14 +1,16 @@
 #include "htmlexportengine.h"
 #include "htmlwizardpage.h"
 
-HtmlExportEngine::HtmlExportEngine() {
-  m_wizardPage = new HtmlWizardPage(model, NULL);
+HtmlWriter::HtmlWriter() {
+  columnCount = 0;
+  out = NULL;
 }
 
-void HtmlExportEngine::process(QFile *f) {
+void HtmlWriter::begin(QIODevice *out, const QSqlRecord &columns) {
+  this->out = out;
+  columnCount = columns.count();
 
-  emit progress(-1);
-  f->write("<html>\n<head>\n<title></title>\n</head>\n<body>\n");
+  out->write("<html>\n<head>\n<title></title>\n</head>\n<body>\n");
 
   /*
    * Writing query
@@ -23,39 +25,55 @@ void HtmlExportEngine::process(QFile *f) {
   /*
    * Writing header
    */
-  f->write("<table border=\"1\">\n");
-  f->write("<tr>");
-  for(int i=0; i<model->columnCount(); i++) {
-    f->write(model->headerData(i, Qt::Horizontal).toString()
-            .prepend("<th>").append("</th>").toLatin1());
+  out->write("<table border=\"1\">\n");
+  out->write("<tr>");
+  for (int i=0; i<columnCount; i++) {
+    out->write(columns.fieldName(i)
+               .prepend("<th>").append("</th>").toLatin1());
   }
 
-  f->write("</tr>\n");
+  out->write("</tr>\n");
+}
 
-  /*
-   * Writing data
-   */
-  QModelIndex idx;
-  for (int y=0; y<model->rowCount(); y++) {
-    f->write("<tr>");
-    for (int x=0; x<model->columnCount(); x++) {
-      idx = model->index(y, x);
-      if(idx.data().canConvert(QVariant::String))
-        f->write(idx.data().toString()
-                .prepend("<td>").append("</td>")
-                .toLatin1());
-    }
-    f->write("</tr>\n");
+void HtmlWriter::end() {
+  out->write("</table>\n");
+  out->write("</body></html>");
+}
 
-    emit progress(y);
+/**
+ * Writes the current row of a query, or a record holding the values.
+ */
+template <class Row>
+void HtmlWriter::write(const Row &row) {
+  out->write("<tr>");
+  for (int x=0; x<columnCount; x++) {
+    QVariant value = row.value(x);
+    if (value.canConvert(QVariant::String)) {
+      out->write(value.toString()
+                 .prepend("<td>").append("</td>")
+                 .toLatin1());
+    }
   }
+  out->write("</tr>\n");
+}
 
-  f->write("</table>\n");
-  f->write("</body></html>");
+void HtmlWriter::writeRecord(const QSqlRecord &record) {
+  write(record);
+}
+
+void HtmlWriter::writeRow(const QSqlQuery &query) {
+  write(query);
+}
+
+HtmlExportEngine::HtmlExportEngine() {
+  m_wizardPage = new HtmlWizardPage(model, NULL);
+}
+
+ExportWriter *HtmlExportEngine::createWriter() {
+  return new HtmlWriter();
 }
 
 void HtmlExportEngine::setModel(QAbstractItemModel *m) {
   model = m;
   ((HtmlWizardPage*) m_wizardPage)->setModel(m);
 }
-
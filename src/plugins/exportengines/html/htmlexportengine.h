@@ -6,6 +6,22 @@
 #include <QApplication>
 #include <QObject>
 
+class HtmlWriter : public ExportWriter {
+public:
+  HtmlWriter();
+
+  void begin(QIODevice *out, const QSqlRecord &columns);
+  void end();
+  void writeRecord(const QSqlRecord &record);
+  void writeRow(const QSqlQuery &query);
+
+private:
+  template <class Row> void write(const Row &row);
+
+  int columnCount;
+  QIODevice *out;
+};
+
 class HtmlExportEngine : public QObject, public ExportEngine {
 Q_OBJECT
 Q_INTERFACES(ExportEngine)
@@ -22,15 +38,12 @@ public:
   QString displayIconCode() { return "html"; };
   QString displayName() { return tr("HTML"); };
   QString extension() { return "html"; };
-  void process(QFile *f);
+  ExportWriter *createWriter();
 
   void setModel(QAbstractItemModel *m);
   void setWizard(QWizard *w) { wizard = w; };
   QWizardPage *wizardPage() { return m_wizardPage; };
 
-signals:
-  void progress(int);
-
 protected:
 };
 
@@ -2,11 +2,46 @@
 
 #include "plaintextwizardpage.h"
 
+PlainTextWriter::PlainTextWriter() {
+  columnCount = 0;
+  out = NULL;
+}
+
+void PlainTextWriter::begin(QIODevice *out, const QSqlRecord &columns) {
+  this->out = out;
+  columnCount = columns.count();
+
+  QString line;
+  for (int i=0; i<columnCount; i++) {
+    line += columns.fieldName(i).leftJustified(ColumnWidth, ' ', true);
+  }
+  out->write(line.append("\n").toUtf8());
+}
+
+/**
+ * Writes the current row of a query, or a record holding the values.
+ */
+template <class Row>
+void PlainTextWriter::write(const Row &row) {
+  QString line;
+  for (int i=0; i<columnCount; i++) {
+    line += row.value(i).toString().leftJustified(ColumnWidth, ' ', true);
+  }
+  out->write(line.append("\n").toUtf8());
+}
+
+void PlainTextWriter::writeRecord(const QSqlRecord &record) {
+  write(record);
+}
+
+void PlainTextWriter::writeRow(const QSqlQuery &query) {
+  write(query);
+}
+
 PlainTextExportEngine::PlainTextExportEngine() {
   m_wizardPage = new PlainTextWizardPage();
 }
 
-void PlainTextExportEngine::process(QFile *f) {
-  emit progress(1);
+ExportWriter *PlainTextExportEngine::createWriter() {
+  return new PlainTextWriter();
 }
-
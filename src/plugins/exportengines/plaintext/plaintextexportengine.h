@@ -6,6 +6,27 @@
 #include <QApplication>
 #include <QObject>
 
+/**
+ * Fixed width columns.
+ */
+class PlainTextWriter : public ExportWriter {
+public:
+  PlainTextWriter();
+
+  void begin(QIODevice *out, const QSqlRecord &columns);
+  void end() {};
+  void writeRecord(const QSqlRecord &record);
+  void writeRow(const QSqlQuery &query);
+
+  static const int ColumnWidth = 10;
+
+private:
+  template <class Row> void write(const Row &row);
+
+  int columnCount;
+  QIODevice *out;
+};
+
 class PlainTextExportEngine : public QObject, public ExportEngine {
 Q_OBJECT
 Q_INTERFACES(ExportEngine)
@@ -19,18 +40,16 @@ public:
   QString version() { return QApplication::applicationVersion(); };
 
   // Fonctions de ExportEngine
+  bool canConcatenate() { return true; };
   QString displayIconCode() { return "text"; };
   QString displayName() { return tr("Plain text"); };
   QString extension() { return "txt"; };
-  void process(QFile *f);
+  ExportWriter *createWriter();
 
   void setModel(QAbstractItemModel *m) { model = m; };
   void setWizard(QWizard *w) { wizard = w ;};
   QWizardPage *wizardPage() { return m_wizardPage; };
 
-signals:
-  void progress(int);
-
 public slots:
 
 };
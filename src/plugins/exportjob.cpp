@@ -0,0 +1,178 @@
+#include "exportjob.h"
+
+#include <QFile>
+#include <QSqlError>
+
+QAtomicInt ExportJob::connectionCount;
+
+/**
+ * @param writer
+ *    writer created by the export engine, owned by the job
+ */
+ExportJob::ExportJob(ExportWriter *writer, QString query, QSqlDatabase db,
+                     QString path, QObject *parent)
+  : QObject(parent) {
+  this->writer = writer;
+  this->query = query;
+  this->db = db;
+  this->m_path = path;
+
+  compression = CompressionDevice::NoCompression;
+  compressionLevel = -1;
+  m_headerSize = 0;
+  m_rowCount = 0;
+  useRows = false;
+
+  setAutoDelete(false);
+}
+
+ExportJob::~ExportJob() {
+  delete writer;
+}
+
+void ExportJob::cancel() {
+  canceled.store(1);
+}
+
+void ExportJob::setCompression(CompressionDevice::Format format, int level) {
+  compression = format;
+  compressionLevel = level;
+}
+
+/**
+ * Writes these rows instead of running the query.
+ *
+ * @param columns
+ *    names and types of the columns
+ */
+void ExportJob::setRows(QSqlRecord columns, QList<QSqlRecord> rows) {
+  this->columns = columns;
+  this->rows = rows;
+  useRows = true;
+}
+
+void ExportJob::writeRows(QIODevice *out) {
+  writer->begin(out, columns);
+  m_headerSize = out->pos();
+
+  int count = 0;
+  foreach (const QSqlRecord &r, rows) {
+    if (count % ProgressRows == 0 && isCanceled()) {
+      break;
+    }
+    writer->writeRecord(r);
+    count++;
+  }
+
+  writer->end();
+  m_rowCount = count;
+  emit progress(count);
+}
+
+/**
+ * Runs the query on a clone of the connection and writes its rows.
+ */
+bool ExportJob::read(QIODevice *out) {
+  // the connection can't be shared with the GUI thread
+  QString name = QString("export-%1").arg(connectionCount.fetchAndAddOrdered(1));
+  bool ok = true;
+
+  {
+    QSqlDatabase clone = QSqlDatabase::cloneDatabase(db, name);
+    if (!clone.open()) {
+      m_errorString = clone.lastError().text();
+      ok = false;
+    }
+
+    QSqlQuery q(clone);
+    q.setForwardOnly(true);
+    if (ok && !q.exec(query)) {
+      m_errorString = q.lastError().text();
+      ok = false;
+    }
+
+    if (ok) {
+      writer->begin(out, q.record());
+      m_headerSize = out->pos();
+
+      int count = 0;
+      QElapsedTimer timer;
+      timer.start();
+      while (q.next()) {
+        writer->writeRow(q);
+        count++;
+
+        if (count % ProgressRows == 0) {
+          if (isCanceled()) {
+            break;
+          }
+          if (timer.elapsed() >= ProgressInterval) {
+            emit progress(count);
+            timer.restart();
+          }
+        }
+      }
+
+      writer->end();
+      m_rowCount = count;
+      emit progress(count);
+
+      if (q.lastError().type() != QSqlError::NoError) {
+        m_errorString = q.lastError().text();
+        ok = false;
+      }
+    }
+  }
+  QSqlDatabase::removeDatabase(name);
+
+  return ok;
+}
+
+void ExportJob::run() {
+  // canceled while it was queued
+  if (isCanceled()) {
+    emit finished(false);
+    return;
+  }
+
+  QFile f(m_path);
+  if (!f.open(QFile::WriteOnly)) {
+    m_errorString = tr("Unable to open the file %1.").arg(m_path);
+    emit finished(false);
+    return;
+  }
+
+  QIODevice *out = &f;
+  CompressionDevice compressor(&f, compression, compressionLevel);
+  if (compression != CompressionDevice::NoCompression) {
+    if (!compressor.open(QIODevice::WriteOnly)) {
+      m_errorString = tr("Unsupported compression format");
+      f.close();
+      f.remove();
+      emit finished(false);
+      return;
+    }
+    out = &compressor;
+  }
+
+  bool ok = true;
+  if (useRows) {
+    writeRows(out);
+  } else {
+    ok = read(out);
+  }
+
+  compressor.close();
+  if (ok && compressor.hasFailed()) {
+    m_errorString = compressor.errorString();
+    ok = false;
+  }
+  f.close();
+
+  if (isCanceled()) {
+    f.remove();
+    ok = false;
+  }
+
+  emit finished(ok);
+}
@@ -0,0 +1,76 @@
+#ifndef EXPORTJOB_H
+#define EXPORTJOB_H
+
+#include "exportengine.h"
+#include "../tools/compressiondevice.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QRunnable>
+#include <QSqlDatabase>
+
+/**
+ * Runs an export on a QThreadPool.
+ *
+ * The query is executed again on a clone of the connection, rows are read on a
+ * forward-only cursor and handed to the writer one at a time : the result is
+ * never materialized. Progress is only reported every ProgressInterval ms.
+ * When the query can't run again, the rows already read are given instead,
+ * see setRows().
+ *
+ * The output can be compressed on the fly, see CompressionDevice.
+ */
+class ExportJob : public QObject, public QRunnable {
+Q_OBJECT
+public:
+  ExportJob(ExportWriter *writer, QString query, QSqlDatabase db,
+            QString path, QObject *parent = 0);
+  ~ExportJob();
+
+  QString errorString() { return m_errorString; };
+  /**
+   * Size of what the writer wrote in begin(), valid once finished.
+   */
+  qint64 headerSize() { return m_headerSize; };
+  bool isCanceled() { return canceled.load() != 0; };
+  QString path() { return m_path; };
+  int rowCount() { return m_rowCount; };
+  void run();
+  void setCompression(CompressionDevice::Format format, int level = -1);
+  void setRows(QSqlRecord columns, QList<QSqlRecord> rows);
+
+  static const int ProgressInterval = 100;
+  static const int ProgressRows = 1000;
+
+signals:
+  void finished(bool ok);
+  void progress(int rows);
+
+public slots:
+  void cancel();
+
+private:
+  bool read(QIODevice *out);
+  void writeRows(QIODevice *out);
+
+  QAtomicInt canceled;
+  QSqlRecord columns;
+  CompressionDevice::Format compression;
+  int compressionLevel;
+  QSqlDatabase db;
+  QString query;
+  QList<QSqlRecord> rows;
+  bool useRows;
+  ExportWriter *writer;
+
+  QString m_errorString;
+  qint64 m_headerSize;
+  QString m_path;
+  int m_rowCount;
+
+  static QAtomicInt connectionCount;
+};
+
+#endif // EXPORTJOB_H
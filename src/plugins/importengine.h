@@ -0,0 +1,80 @@
+#ifndef IMPORTENGINE_H
+#define IMPORTENGINE_H
+
+#include "plugin.h"
+#include "../db_enum.h"
+
+#include <QApplication>
+#include <QIODevice>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QWizard>
+
+/**
+ * Reads the rows of one import. A reader is created for each import and is
+ * used from a worker thread : it must not touch the wizard nor any widget.
+ */
+class ImportReader {
+public:
+  virtual ~ImportReader() {};
+
+  /**
+   * Starts the input, e.g. reads the header.
+   *
+   * @return false if the input can't be read, see errorString()
+   */
+  virtual bool begin(QIODevice *in) =0;
+  /**
+   * Describes the file for the server's bulk loader, see
+   * SqlWrapper::bulkLoad(). Only the format is filled.
+   *
+   * @return false if the server can't read the file itself
+   */
+  virtual bool bulkLoadFormat(SqlBulkLoad *load) { return false; };
+  /**
+   * Names of the fields of a row, read from the header or numbered. Valid
+   * once begin() is done.
+   */
+  virtual QStringList columns() =0;
+  virtual QString errorString() { return ""; };
+  /**
+   * Reads the next row. Null values are null variants, missing fields are
+   * left out.
+   *
+   * @return false at the end of the input, or on error if errorString() is
+   *    set
+   */
+  virtual bool readRow(QVector<QVariant> &row) =0;
+};
+
+class ImportEngine : public Plugin {
+public:
+  /**
+   * Nom du format à afficher, par ex. CSV.
+   */
+  virtual QString displayName() =0;
+  /**
+   * Les extensions des fichiers lus (csv, txt, etc.), pour le filtre du
+   * sélecteur de fichiers.
+   */
+  virtual QStringList extensions() =0;
+  virtual QString displayIconCode() { return ""; };
+  /**
+   * Créé un reader avec les options choisies dans l'assistant. Appelée depuis
+   * le thread graphique, l'import lui-même est threadé.
+   */
+  virtual ImportReader *createReader() =0;
+
+  virtual void setWizard(QWizard *w) =0;
+  virtual QWizardPage *wizardPage() =0;
+
+protected:
+
+  QWizard *wizard;
+  QWizardPage *m_wizardPage;
+};
+
+Q_DECLARE_INTERFACE(ImportEngine, "dbmaster.ImportEngine")
+
+#endif // IMPORTENGINE_H
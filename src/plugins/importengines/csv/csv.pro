@@ -0,0 +1,37 @@
+TEMPLATE=lib
+CONFIG+=release plugin
+VERSION=0.8
+INCLUDEPATH+=../../../src/plugins
+QT+=sql
+TARGET=csvimportengine
+HEADERS += \
+    csvimportengine.h \
+    csvimportpage.h \
+    ../../../tools/csvtokenizer.h
+
+SOURCES += \
+    csvimportengine.cpp \
+    csvimportpage.cpp \
+    ../../../tools/csvtokenizer.cpp
+
+FORMS += \
+    csvimportpage.ui
+
+# ##
+# MS Windows
+win32: {
+    isEmpty(PREFIX):PREFIX = ..\\..\\..\\src\\install
+    DEFINES += PREFIX=\\\"$${PREFIX}\\\"
+    target.path = $${PREFIX}\\plugins
+    INSTALLS = target
+}
+
+# ##
+# All unix-like
+unix:!macx {
+    isEmpty( PREFIX ):PREFIX = /usr
+    DEFINES += PREFIX=\\\"$${PREFIX}\\\"
+    target.path = $${PREFIX}/share/dbmaster/plugins
+    INSTALLS = target
+}
+
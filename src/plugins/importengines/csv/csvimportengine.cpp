@@ -0,0 +1,317 @@
+#include "csvimportengine.h"
+#include "csvimportpage.h"
+
+#include <QTextCodec>
+
+/**
+ * @param delimiter
+ *    quote character, only its first character is used. Empty if the fields
+ *    are never quoted.
+ * @param separator
+ *    only its first character is used
+ */
+CsvReader::CsvReader(QString delimiter, QString separator, bool header) {
+  this->delimiter = delimiter.isEmpty() ? QChar() : delimiter.at(0);
+  this->separator = separator.isEmpty() ? QChar(',') : separator.at(0);
+  this->header = header;
+
+  decoder = NULL;
+  file = NULL;
+  in = NULL;
+  line = 0;
+  mapped = false;
+  pos = 0;
+  record = 0;
+  recordCount = 0;
+  slice = 0;
+  tokenizer = NULL;
+  window = NULL;
+  windowLength = 0;
+  windowOffset = 0;
+  windowSize = WindowSize;
+}
+
+/**
+ * The window stays mapped : the file may already be closed, which unmaps it.
+ */
+CsvReader::~CsvReader() {
+  delete decoder;
+  delete tokenizer;
+}
+
+void CsvReader::appendField(QVector<QVariant> &fields, QString &value,
+                            bool quoted) {
+  if (quoted) {
+    fields << QVariant(value.isNull() ? QString("") : value);
+  } else if (value.isEmpty()) {
+    fields << QVariant(QVariant::String);
+  } else {
+    fields << QVariant(value);
+  }
+  value = QString();
+}
+
+bool CsvReader::begin(QIODevice *in) {
+  this->in = in;
+
+  delete decoder;
+  decoder = QTextCodec::codecForName("UTF-8")->makeDecoder();
+  buffer.clear();
+  firstRow.clear();
+  line = 0;
+  pos = 0;
+  m_columns.clear();
+  m_errorString.clear();
+
+  delete tokenizer;
+  tokenizer = NULL;
+  file = qobject_cast<QFile*>(in);
+  mapped = false;
+  recordCount = 0;
+  slices.clear();
+  window = NULL;
+  windowLength = 0;
+  windowOffset = 0;
+  windowSize = WindowSize;
+  // the tokenizer only handles ASCII separators and quotes
+  if (file && delimiter.unicode() < 0x80 && separator.unicode() < 0x80) {
+    tokenizer = new CsvTokenizer(separator.toLatin1(), delimiter.toLatin1());
+    // the byte order mark of UTF-8, dropped by the decoder too
+    if (file->peek(3) == "\xEF\xBB\xBF") {
+      windowOffset = 3;
+    }
+    mapped = mapWindow();
+  }
+
+  QVector<QVariant> fields;
+  if (!readRow(fields)) {
+    if (m_errorString.isEmpty()) {
+      m_errorString = QCoreApplication::translate("CsvReader",
+                                                  "The file is empty");
+    }
+    return false;
+  }
+
+  for (int i=0; i<fields.size(); i++) {
+    if (header) {
+      m_columns << fields[i].toString();
+    } else {
+      m_columns << QCoreApplication::translate("CsvReader", "Column %1")
+                   .arg(i + 1);
+    }
+  }
+
+  if (!header) {
+    firstRow = fields;
+  }
+
+  return true;
+}
+
+bool CsvReader::bulkLoadFormat(SqlBulkLoad *load) {
+  load->separator = separator;
+  load->quote = delimiter;
+  load->header = header;
+  return true;
+}
+
+/**
+ * Decodes the next chunk of the input.
+ *
+ * @return false at the end of the input
+ */
+bool CsvReader::fill() {
+  forever {
+    QByteArray bytes = in->read(ChunkSize);
+    if (bytes.isEmpty()) {
+      return false;
+    }
+
+    buffer = decoder->toUnicode(bytes);
+    pos = 0;
+    // the chunk may only hold the beginning of a character
+    if (!buffer.isEmpty()) {
+      return true;
+    }
+  }
+}
+
+/**
+ * Maps and tokenizes the window following the records read, and unmaps the
+ * previous one. The window grows until it holds a complete record.
+ *
+ * @return false at the end of the file, or if it can't be mapped
+ */
+bool CsvReader::mapWindow() {
+  if (window) {
+    file->unmap(window);
+    window = NULL;
+  }
+  slices.clear();
+  slice = 0;
+  record = 0;
+
+  qint64 offset = windowOffset + windowLength;
+  forever {
+    qint64 size = qMin(windowSize, file->size() - offset);
+    if (size <= 0) {
+      return false;
+    }
+
+    window = file->map(offset, size);
+    if (!window) {
+      // else the file is read as a stream
+      if (mapped) {
+        m_errorString = file->errorString();
+      }
+      return false;
+    }
+
+    windowOffset = offset;
+    windowLength = tokenizer->tokenize((const char*) window, size,
+                                       offset + size == file->size(), slices);
+    if (windowLength > 0) {
+      return true;
+    }
+
+    file->unmap(window);
+    window = NULL;
+    windowSize *= 2;
+  }
+}
+
+/**
+ * Reads the fields of the next record from the mapped windows.
+ *
+ * @return false at the end of the file or on error
+ */
+bool CsvReader::readMappedRecord(QVector<QVariant> &fields) {
+  fields.resize(0);
+  while (slice >= slices.size() || record >= slices[slice].ends.size()) {
+    if (slice + 1 < slices.size()) {
+      slice++;
+      record = 0;
+    } else if (!mapWindow()) {
+      return false;
+    }
+  }
+
+  const CsvTokenizer::Records &r = slices[slice];
+  const char *data = (const char*) window;
+  for (int i = record > 0 ? r.ends[record - 1] : 0; i < r.ends[record]; i++) {
+    QString value = tokenizer->value(data, r.fields[i]);
+    fields << (value.isNull() ? QVariant(QVariant::String) : QVariant(value));
+  }
+
+  recordCount++;
+  if (r.unterminated && record == r.ends.size() - 1) {
+    m_errorString = QCoreApplication::translate("CsvReader",
+        "Record %1 : unterminated quoted field").arg(recordCount);
+    return false;
+  }
+
+  record++;
+  return true;
+}
+
+/**
+ * Reads the fields of the next record, line breaks of the quoted fields
+ * included.
+ *
+ * @return false at the end of the input or on error
+ */
+bool CsvReader::readRecord(QVector<QVariant> &fields) {
+  if (mapped) {
+    return readMappedRecord(fields);
+  }
+
+  fields.resize(0);
+  if (pos >= buffer.size() && !fill()) {
+    return false;
+  }
+
+  int first = line + 1;
+  QString value;
+  bool quoted = false;
+  bool inQuotes = false;
+
+  forever {
+    if (pos >= buffer.size() && !fill()) {
+      if (inQuotes) {
+        m_errorString = QCoreApplication::translate("CsvReader",
+            "Line %1 : unterminated quoted field").arg(first);
+        return false;
+      }
+
+      // the last record has no line break
+      appendField(fields, value, quoted);
+      return true;
+    }
+
+    QChar c = buffer.at(pos++);
+    if (inQuotes) {
+      if (c != delimiter) {
+        if (c == '\n') {
+          line++;
+        }
+        value.append(c);
+        continue;
+      }
+
+      // a doubled delimiter, or the end of the quotes
+      if (pos >= buffer.size()) {
+        fill();
+      }
+      if (pos < buffer.size() && buffer.at(pos) == delimiter) {
+        value.append(c);
+        pos++;
+      } else {
+        inQuotes = false;
+      }
+    } else if (c == separator) {
+      appendField(fields, value, quoted);
+      quoted = false;
+    } else if (c == '\n') {
+      line++;
+      appendField(fields, value, quoted);
+      return true;
+    } else if (c == '\r') {
+      // CRLF line break
+    } else if (c == delimiter && !delimiter.isNull() && !quoted
+               && value.isEmpty()) {
+      inQuotes = true;
+      quoted = true;
+    } else {
+      value.append(c);
+    }
+  }
+}
+
+bool CsvReader::readRow(QVector<QVariant> &row) {
+  if (!firstRow.isEmpty()) {
+    row = firstRow;
+    firstRow.clear();
+    return true;
+  }
+
+  forever {
+    if (!readRecord(row)) {
+      return false;
+    }
+
+    // a blank line, unless it's a NULL of a single column
+    if (row.size() > 1 || !row[0].isNull() || m_columns.size() == 1) {
+      return true;
+    }
+  }
+}
+
+CsvImportEngine::CsvImportEngine() {
+  m_wizardPage = new CsvImportPage();
+}
+
+ImportReader *CsvImportEngine::createReader() {
+  return new CsvReader(wizard->field("csvdelimiter").toString(),
+                       wizard->field("csvseparator").toString(),
+                       wizard->field("csvheader").toBool());
+}
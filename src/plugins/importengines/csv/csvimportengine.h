@@ -0,0 +1,92 @@
+#ifndef CSVIMPORTENGINE_H
+#define CSVIMPORTENGINE_H
+
+#include "../../importengine.h"
+#include "../../../tools/csvtokenizer.h"
+
+#include <QApplication>
+#include <QFile>
+#include <QObject>
+#include <QTextDecoder>
+
+/**
+ * Reads RFC 4180 records in UTF-8, as written by the CSV export engine.
+ *
+ * A file is mapped in memory by windows of WindowSize bytes, which are split by
+ * CsvTokenizer without copying them. Other devices, or a file that can't be
+ * mapped, are decoded by chunks of ChunkSize bytes : the input is never
+ * loaded at once. An empty field is NULL unless it is quoted, as for
+ * PostgreSQL's COPY. Blank lines are skipped, unless the file has a single
+ * column.
+ */
+class CsvReader : public ImportReader {
+public:
+  CsvReader(QString delimiter, QString separator, bool header);
+  ~CsvReader();
+
+  bool begin(QIODevice *in);
+  bool bulkLoadFormat(SqlBulkLoad *load);
+  QStringList columns() { return m_columns; };
+  QString errorString() { return m_errorString; };
+  bool readRow(QVector<QVariant> &row);
+
+  static const int ChunkSize = 256 * 1024;
+  static const int WindowSize = 4 * 1024 * 1024;
+
+private:
+  void appendField(QVector<QVariant> &fields, QString &value, bool quoted);
+  bool fill();
+  bool mapWindow();
+  bool readMappedRecord(QVector<QVariant> &fields);
+  bool readRecord(QVector<QVariant> &fields);
+
+  QString buffer;
+  QTextDecoder *decoder;
+  QChar delimiter;
+  QFile *file;
+  QVector<QVariant> firstRow;
+  bool header;
+  QIODevice *in;
+  int line;
+  bool mapped;
+  int pos;
+  /** Next record of the current slice. */
+  int record;
+  int recordCount;
+  QChar separator;
+  int slice;
+  QVector<CsvTokenizer::Records> slices;
+  CsvTokenizer *tokenizer;
+  uchar *window;
+  /** Length of the window which was tokenized. */
+  qint64 windowLength;
+  qint64 windowOffset;
+  qint64 windowSize;
+
+  QStringList m_columns;
+  QString m_errorString;
+};
+
+class CsvImportEngine : public QObject, public ImportEngine {
+Q_OBJECT
+Q_INTERFACES(ImportEngine)
+public:
+  CsvImportEngine();
+
+  // Fonctions de Plugin
+  QString plid() { return "DBM.CSV.IMPORTENGINE"; };
+  QString title() { return tr("CSV import engine"); };
+  QString vendor() { return "DbMaster"; };
+  QString version() { return QApplication::applicationVersion(); };
+
+  // Fonctions de ImportEngine
+  QString displayIconCode() { return "spreadsheet"; };
+  QString displayName() { return tr("CSV"); };
+  QStringList extensions() { return QStringList() << "csv" << "txt"; };
+  ImportReader *createReader();
+
+  void setWizard(QWizard *w) { wizard = w; };
+  QWizardPage *wizardPage() { return m_wizardPage; };
+};
+
+#endif // CSVIMPORTENGINE_H
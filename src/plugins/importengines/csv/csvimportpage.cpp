@@ -0,0 +1,11 @@
+#include "csvimportpage.h"
+
+CsvImportPage::CsvImportPage(QWidget *parent)
+  : QWizardPage(parent)
+{
+  setupUi(this);
+
+  registerField("csvdelimiter", delimiterLineEdit);
+  registerField("csvheader"   , headerCheckBox);
+  registerField("csvseparator", separatorLineEdit);
+}
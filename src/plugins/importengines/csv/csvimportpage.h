@@ -0,0 +1,14 @@
+#ifndef CSVIMPORTPAGE_H
+#define CSVIMPORTPAGE_H
+
+#include "ui_csvimportpage.h"
+
+#include <QWizardPage>
+
+class CsvImportPage : public QWizardPage, Ui::CsvImportPage {
+Q_OBJECT
+public:
+  CsvImportPage(QWidget *parent = 0);
+};
+
+#endif // CSVIMPORTPAGE_H
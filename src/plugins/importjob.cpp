@@ -0,0 +1,315 @@
+#include "importjob.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+
+QAtomicInt ImportJob::connectionCount;
+
+/**
+ * @param reader
+ *    reader created by the import engine, owned by the job
+ * @param table
+ *    target table, possibly prefixed with its schema
+ * @param columns
+ *    target column of each field of the file, empty if the field is skipped
+ */
+ImportJob::ImportJob(ImportReader *reader, QString path, QSqlDatabase db,
+                     QString table, QStringList columns, QObject *parent)
+  : QObject(parent) {
+  this->reader = reader;
+  this->m_path = path;
+  this->db = db;
+  this->table = table;
+  this->columns = columns;
+
+  m_native = false;
+  m_rowCount = 0;
+  m_transactionSize = DefaultTransactionSize;
+  wrapper = NULL;
+
+  setAutoDelete(false);
+}
+
+ImportJob::~ImportJob() {
+  delete reader;
+}
+
+/**
+ * Also interrupts the server's bulk loader, from another thread.
+ */
+void ImportJob::cancel() {
+  canceled.store(1);
+
+  QMutexLocker locker(&cancelMutex);
+  QueryCanceler::cancelLater(canceler);
+}
+
+QString ImportJob::escapedTable(QSqlDatabase &connection) {
+  QStringList parts = table.split('.');
+  for (int i=0; i<parts.size(); i++) {
+    parts[i] = connection.driver()->escapeIdentifier(parts[i],
+                                                     QSqlDriver::TableName);
+  }
+  return parts.join(".");
+}
+
+/**
+ * Inserts the rows of the reader by batches.
+ */
+bool ImportJob::insert(QIODevice *in, QSqlDatabase &connection) {
+  if (!reader->begin(in)) {
+    m_errorString = reader->errorString();
+    return false;
+  }
+
+  QList<int> fields;
+  QStringList names;
+  QStringList placeholders;
+  for (int i=0; i<columns.size(); i++) {
+    if (!columns[i].isEmpty()) {
+      fields << i;
+      names << connection.driver()->escapeIdentifier(columns[i],
+                                                     QSqlDriver::FieldName);
+      placeholders << "?";
+    }
+  }
+
+  if (fields.isEmpty()) {
+    m_errorString = tr("No column to import");
+    return false;
+  }
+
+  QSqlQuery query(connection);
+  if (!query.prepare(QString("INSERT INTO %1 (%2) VALUES (%3)")
+                     .arg(escapedTable(connection))
+                     .arg(names.join(", "))
+                     .arg(placeholders.join(", ")))) {
+    m_errorString = query.lastError().text();
+    return false;
+  }
+
+  bool transactions =
+      connection.driver()->hasFeature(QSqlDriver::Transactions);
+  int batchSize = m_transactionSize > 0 && transactions
+      ? qMin((int) BatchSize, m_transactionSize) : BatchSize;
+
+  QVector<QVariantList> values(fields.size());
+  QVector<QVariant> row;
+  int pending = 0;
+  int rows = 0;
+  int uncommitted = 0;
+  bool ok = true;
+  qint64 lastProgress = 0;
+
+  if (transactions) {
+    connection.transaction();
+  }
+
+  forever {
+    bool more = reader->readRow(row);
+    if (!more && !reader->errorString().isEmpty()) {
+      m_errorString = reader->errorString();
+      ok = false;
+      break;
+    }
+
+    if (more) {
+      for (int i=0; i<fields.size(); i++) {
+        values[i] << (fields[i] < row.size() ? row[fields[i]]
+                                             : QVariant(QVariant::String));
+      }
+      pending++;
+    }
+
+    if (pending == batchSize || (!more && pending > 0)) {
+      for (int i=0; i<fields.size(); i++) {
+        query.bindValue(i, values[i]);
+        values[i].clear();
+      }
+
+      if (!query.execBatch()) {
+        m_errorString = tr("Rows %1 to %2 : %3").arg(rows + 1)
+            .arg(rows + pending).arg(query.lastError().text());
+        ok = false;
+        break;
+      }
+
+      rows += pending;
+      uncommitted += pending;
+      pending = 0;
+
+      if (transactions && m_transactionSize > 0
+          && uncommitted >= m_transactionSize) {
+        if (!connection.commit()) {
+          m_errorString = connection.lastError().text();
+          ok = false;
+          break;
+        }
+        m_rowCount = rows;
+        uncommitted = 0;
+        connection.transaction();
+      }
+
+      if (timer.elapsed() - lastProgress >= ProgressInterval) {
+        lastProgress = timer.elapsed();
+        emit progress(rows, (int) lastProgress);
+      }
+
+      if (isCanceled()) {
+        ok = false;
+        break;
+      }
+    }
+
+    if (!more) {
+      break;
+    }
+  }
+
+  if (transactions) {
+    if (!ok) {
+      connection.rollback();
+    } else if (!connection.commit()) {
+      m_errorString = connection.lastError().text();
+      ok = false;
+    }
+  }
+
+  // without transactions, the rows inserted stay
+  if (ok || !transactions) {
+    m_rowCount = rows;
+  }
+  emit progress(m_rowCount, (int) timer.elapsed());
+
+  return ok;
+}
+
+/**
+ * Hands the file over to the server's bulk loader, if there is one for the
+ * format of the file.
+ *
+ * @param loaded
+ *    set if the loader was used, even if it failed
+ */
+bool ImportJob::load(QSqlDatabase &connection, bool *loaded) {
+  *loaded = false;
+
+  SqlBulkLoad load;
+  if (!reader->bulkLoadFormat(&load)) {
+    return true;
+  }
+
+  load.path = m_path;
+  load.table = escapedTable(connection);
+  foreach (QString c, columns) {
+    load.columns << (c.isEmpty() ? c
+        : connection.driver()->escapeIdentifier(c, QSqlDriver::FieldName));
+  }
+
+  {
+    QSharedPointer<QueryCanceler> c(wrapper->canceler(&connection));
+    QMutexLocker locker(&cancelMutex);
+    canceler = c;
+  }
+
+  // canceled before the canceler was armed
+  QString error;
+  int rows = -1;
+  if (!isCanceled()) {
+    rows = wrapper->bulkLoad(&connection, load, &error);
+  }
+
+  QSharedPointer<QueryCanceler> c;
+  {
+    QMutexLocker locker(&cancelMutex);
+    c = canceler;
+    canceler.clear();
+  }
+  // waits for a request being sent
+  if (c) {
+    c->release();
+  }
+
+  if (rows >= 0) {
+    *loaded = true;
+    m_native = true;
+    m_rowCount = rows;
+    emit progress(rows, (int) timer.elapsed());
+    return true;
+  }
+
+  if (!error.isEmpty()) {
+    *loaded = true;
+    m_errorString = error;
+    return false;
+  }
+
+  return true;
+}
+
+void ImportJob::run() {
+  // canceled while it was queued
+  if (isCanceled()) {
+    emit finished(false);
+    return;
+  }
+
+  QFile f(m_path);
+  if (!f.open(QFile::ReadOnly)) {
+    m_errorString = tr("Unable to open the file %1.").arg(m_path);
+    emit finished(false);
+    return;
+  }
+
+  timer.start();
+
+  // the connection can't be shared with the GUI thread
+  QString name = QString("import-%1").arg(connectionCount.fetchAndAddOrdered(1));
+  bool ok = true;
+
+  {
+    QSqlDatabase clone = QSqlDatabase::cloneDatabase(db, name);
+    if (!clone.open()) {
+      m_errorString = clone.lastError().text();
+      ok = false;
+    }
+
+    bool loaded = false;
+    if (ok && wrapper) {
+      ok = load(clone, &loaded);
+    }
+
+    if (ok && !loaded && !isCanceled()) {
+      ok = insert(&f, clone);
+    }
+  }
+  QSqlDatabase::removeDatabase(name);
+
+  f.close();
+
+  if (isCanceled()) {
+    ok = false;
+  }
+
+  emit finished(ok);
+}
+
+/**
+ * @param rows
+ *    rows per transaction, 0 for a single transaction. The server's bulk
+ *    loaders always use a single one.
+ */
+void ImportJob::setTransactionSize(int rows) {
+  m_transactionSize = qMax(0, rows);
+}
+
+/**
+ * The wrapper of the connection, for the server's bulk loader. NULL to always
+ * insert the rows.
+ */
+void ImportJob::setWrapper(SqlWrapper *wrapper) {
+  this->wrapper = wrapper;
+}
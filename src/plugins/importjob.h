@@ -0,0 +1,88 @@
+#ifndef IMPORTJOB_H
+#define IMPORTJOB_H
+
+#include "importengine.h"
+#include "querycanceler.h"
+#include "sqlwrapper.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+
+/**
+ * Runs an import on a QThreadPool.
+ *
+ * The file is handed over to the server's bulk loader when the wrapper and the
+ * format allow it, e.g. COPY for PostgreSQL. Otherwise the rows are streamed
+ * from the reader and inserted with a prepared statement, BatchSize rows per
+ * execBatch(), on a clone of the connection. A transaction is committed every
+ * transactionSize() rows : on error, the rows of the last transaction are
+ * rolled back and the previous ones kept.
+ */
+class ImportJob : public QObject, public QRunnable {
+Q_OBJECT
+public:
+  ImportJob(ImportReader *reader, QString path, QSqlDatabase db,
+            QString table, QStringList columns, QObject *parent = 0);
+  ~ImportJob();
+
+  QString errorString() { return m_errorString; };
+  bool isCanceled() { return canceled.load() != 0; };
+  /**
+   * The file was loaded by the server's bulk loader, valid once finished.
+   */
+  bool isNative() { return m_native; };
+  QString path() { return m_path; };
+  /**
+   * Rows committed, valid once finished.
+   */
+  int rowCount() { return m_rowCount; };
+  void run();
+  void setTransactionSize(int rows);
+  void setWrapper(SqlWrapper *wrapper);
+  int transactionSize() { return m_transactionSize; };
+
+  static const int BatchSize = 500;
+  static const int DefaultTransactionSize = 10000;
+  static const int ProgressInterval = 100;
+
+signals:
+  void finished(bool ok);
+  /**
+   * @param msecs
+   *    time since the job started
+   */
+  void progress(int rows, int msecs);
+
+public slots:
+  void cancel();
+
+private:
+  QString escapedTable(QSqlDatabase &connection);
+  bool insert(QIODevice *in, QSqlDatabase &connection);
+  bool load(QSqlDatabase &connection, bool *loaded);
+
+  QMutex cancelMutex;
+  QSharedPointer<QueryCanceler> canceler;
+  QAtomicInt canceled;
+  QStringList columns;
+  QSqlDatabase db;
+  ImportReader *reader;
+  QString table;
+  QElapsedTimer timer;
+  SqlWrapper *wrapper;
+
+  QString m_errorString;
+  bool m_native;
+  QString m_path;
+  int m_rowCount;
+  int m_transactionSize;
+
+  static QAtomicInt connectionCount;
+};
+
+#endif // IMPORTJOB_H
@@ -0,0 +1,293 @@
+#include "partitionedexport.h"
+
+#include "../db/queryscheduler.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QRunnable>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTextStream>
+#include <QThreadPool>
+
+/**
+ * Appends the parts to the output file, skipping the header of all but the
+ * first one, then removes them.
+ */
+class PartsConcatenation : public QRunnable {
+public:
+  PartsConcatenation(QObject *receiver, QStringList files,
+                     QVector<qint64> headerSizes, QString path) {
+    this->receiver = receiver;
+    this->files = files;
+    this->headerSizes = headerSizes;
+    this->path = path;
+  }
+
+  void run() {
+    bool ok = concatenate();
+    QMetaObject::invokeMethod(receiver, "concatenationFinished",
+                              Qt::QueuedConnection, Q_ARG(bool, ok));
+  }
+
+private:
+  bool concatenate() {
+    QFile out(path);
+    if (!out.open(QFile::WriteOnly)) {
+      return false;
+    }
+
+    for (int i=0; i<files.size(); i++) {
+      QFile in(files[i]);
+      if (!in.open(QFile::ReadOnly)) {
+        return false;
+      }
+      if (i > 0) {
+        in.seek(headerSizes[i]);
+      }
+
+      while (!in.atEnd()) {
+        if (out.write(in.read(1024 * 1024)) < 0) {
+          return false;
+        }
+      }
+    }
+
+    out.close();
+    foreach (QString f, files) {
+      QFile::remove(f);
+    }
+    return true;
+  }
+
+  QStringList files;
+  QVector<qint64> headerSizes;
+  QString path;
+  QObject *receiver;
+};
+
+/**
+ * @param query
+ *    select statement of the whole table
+ * @param key
+ *    integer primary key used to split the rows
+ */
+PartitionedExport::PartitionedExport(ExportEngine *engine, QString query,
+                                     QString key, QSqlDatabase db,
+                                     QString path, int parts,
+                                     bool concatenate, QObject *parent)
+  : QObject(parent) {
+  this->engine = engine;
+  this->query = query;
+  this->key = key;
+  this->db = db;
+  this->path = path;
+  this->parts = qMax(1, parts);
+  this->concatenate = concatenate && engine->canConcatenate();
+
+  canceled = false;
+  failed = false;
+  compression = CompressionDevice::NoCompression;
+  compressionLevel = -1;
+  running = 0;
+}
+
+/**
+ * Stops the running parts after a failure.
+ */
+void PartitionedExport::abort() {
+  foreach (ExportJob *job, jobs) {
+    if (job) {
+      job->cancel();
+    }
+  }
+}
+
+void PartitionedExport::cancel() {
+  canceled = true;
+  abort();
+}
+
+void PartitionedExport::concatenationFinished(bool ok) {
+  if (!ok) {
+    m_errorString = tr("Unable to concatenate the parts into %1.").arg(path);
+    emit finished(false);
+    return;
+  }
+
+  emit finished(writeManifest(partFiles(), path));
+}
+
+void PartitionedExport::jobFinished(bool ok) {
+  ExportJob *job = (ExportJob*) sender();
+  int i = jobs.indexOf(job);
+
+  headerSizes[i] = job->headerSize();
+  partRows[i] = job->rowCount();
+  jobs[i] = NULL;
+  running--;
+
+  // the first failure is reported, the other parts are only stopped
+  if (!ok && !canceled && !failed) {
+    failed = true;
+    m_errorString = tr("Part %1 : %2").arg(i + 1).arg(job->errorString());
+    abort();
+  }
+
+  if (running > 0) {
+    return;
+  }
+
+  jobs.clear();
+
+  QStringList files = partFiles();
+  if (failed || canceled) {
+    foreach (QString f, files) {
+      QFile::remove(f);
+    }
+    emit finished(false);
+    return;
+  }
+
+  if (concatenate) {
+    QThreadPool::globalInstance()->start(
+          new PartsConcatenation(this, files, headerSizes, path));
+  } else {
+    emit finished(writeManifest(files));
+  }
+}
+
+QStringList PartitionedExport::partFiles() {
+  QStringList files;
+  for (int p=0; p<parts; p++) {
+    files << partPath(path, p) + CompressionDevice::suffix(compression);
+  }
+  return files;
+}
+
+void PartitionedExport::jobProgress(int rows) {
+  int i = jobs.indexOf((ExportJob*) sender());
+  if (i < 0) {
+    return;
+  }
+
+  partRows[i] = rows;
+
+  int total = 0;
+  foreach (int r, partRows) {
+    total += r;
+  }
+  emit progress(total);
+}
+
+QString PartitionedExport::manifestPath(QString path) {
+  QFileInfo info(path);
+  return info.dir().filePath(info.completeBaseName() + ".manifest");
+}
+
+/**
+ * @return the path of a part, e.g. export.part1.csv for export.csv
+ */
+QString PartitionedExport::partPath(QString path, int part) {
+  QFileInfo info(path);
+  QString name = QString("%1.part%2").arg(info.completeBaseName()).arg(part + 1);
+  if (!info.suffix().isEmpty()) {
+    name.append(".").append(info.suffix());
+  }
+
+  return info.dir().filePath(name);
+}
+
+/**
+ * Parts are compressed separately, they can't be concatenated anymore.
+ */
+void PartitionedExport::setCompression(CompressionDevice::Format format,
+                                       int level) {
+  compression = format;
+  compressionLevel = level;
+  if (format != CompressionDevice::NoCompression) {
+    concatenate = false;
+  }
+}
+
+/**
+ * Reads the key bounds and starts one job per range. The bounds query is
+ * answered by the primary key index, it runs on the calling thread.
+ */
+void PartitionedExport::start() {
+  QString k = db.driver()->escapeIdentifier(key, QSqlDriver::FieldName);
+
+  QSqlQuery bounds(db);
+  if (!bounds.exec(QString("SELECT MIN(%1), MAX(%1) FROM (%2) dbm_bounds")
+                   .arg(k).arg(query))
+      || !bounds.next()) {
+    m_errorString = bounds.lastError().text();
+    emit finished(false);
+    return;
+  }
+
+  qlonglong min = bounds.value(0).toLongLong();
+  qlonglong max = bounds.value(1).toLongLong();
+  qlonglong step = (max - min) / parts + 1;
+
+  headerSizes.fill(0, parts);
+  lowerBounds.resize(parts);
+  partRows.fill(0, parts);
+  upperBounds.resize(parts);
+
+  for (int i=0; i<parts; i++) {
+    lowerBounds[i] = min + i * step;
+    upperBounds[i] = lowerBounds[i] + step;
+
+    QString partQuery = QString("SELECT * FROM (%1) dbm_part"
+                                " WHERE %2 >= %3 AND %2 < %4")
+        .arg(query).arg(k).arg(lowerBounds[i]).arg(upperBounds[i]);
+
+    ExportJob *job = new ExportJob(engine->createWriter(), partQuery, db,
+                                   partPath(path, i)
+                                   + CompressionDevice::suffix(compression));
+    job->setCompression(compression, compressionLevel);
+    connect(job, SIGNAL(progress(int)), this, SLOT(jobProgress(int)));
+    connect(job, SIGNAL(finished(bool)), this, SLOT(jobFinished(bool)));
+    connect(job, SIGNAL(finished(bool)), job, SLOT(deleteLater()));
+    jobs << job;
+  }
+
+  running = parts;
+  for (int i=0; i<parts; i++) {
+    QueryScheduler::instance->submit(jobs[i], db,
+                                     tr("Export part %1 : %2")
+                                     .arg(i + 1).arg(query));
+  }
+}
+
+/**
+ * The manifest lists one part per line : file, key range and row count.
+ *
+ * @param output
+ *    file the parts were concatenated into, in their order. Empty if they
+ *    are kept.
+ */
+bool PartitionedExport::writeManifest(QStringList files, QString output) {
+  QFile f(manifestPath(path));
+  if (!f.open(QFile::WriteOnly | QFile::Text)) {
+    m_errorString = tr("Unable to open the file %1.").arg(f.fileName());
+    return false;
+  }
+
+  QTextStream out(&f);
+  out << "# " << key << " >= from AND " << key << " < to\n";
+  if (!output.isEmpty()) {
+    out << "# concatenated into " << QFileInfo(output).fileName() << "\n";
+  }
+  out << "file\tfrom\tto\trows\n";
+  for (int i=0; i<parts; i++) {
+    out << QFileInfo(files[i]).fileName() << "\t" << lowerBounds[i] << "\t"
+        << upperBounds[i] << "\t" << partRows[i] << "\n";
+  }
+
+  return true;
+}
@@ -0,0 +1,77 @@
+#ifndef PARTITIONEDEXPORT_H
+#define PARTITIONEDEXPORT_H
+
+#include "exportengine.h"
+#include "exportjob.h"
+
+#include <QList>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Exports a table to several files in parallel.
+ *
+ * The rows are split in ranges of an integer primary key. Each range is read
+ * by its own ExportJob, on its own clone of the connection. Once every part is
+ * written, a manifest listing the ranges and their row counts is saved next to
+ * the output, and the parts are optionally concatenated into it. Compressed
+ * parts are never concatenated.
+ */
+class PartitionedExport : public QObject {
+Q_OBJECT
+public:
+  PartitionedExport(ExportEngine *engine, QString query, QString key,
+                    QSqlDatabase db, QString path, int parts,
+                    bool concatenate, QObject *parent = 0);
+
+  QString errorString() { return m_errorString; };
+  bool isCanceled() { return canceled; };
+  void setCompression(CompressionDevice::Format format, int level = -1);
+  void start();
+
+  static QString manifestPath(QString path);
+  static QString partPath(QString path, int part);
+
+signals:
+  void finished(bool ok);
+  void progress(int rows);
+
+public slots:
+  void cancel();
+
+private:
+  void abort();
+  QStringList partFiles();
+  bool writeManifest(QStringList files, QString output = QString());
+
+  /** By the user, see failed for the errors. */
+  bool canceled;
+  CompressionDevice::Format compression;
+  int compressionLevel;
+  bool concatenate;
+  QSqlDatabase db;
+  ExportEngine *engine;
+  bool failed;
+  QList<ExportJob*> jobs;
+  QString key;
+  QString path;
+  int parts;
+  QString query;
+  int running;
+
+  QVector<qint64> headerSizes;
+  QVector<qlonglong> lowerBounds;
+  QVector<int> partRows;
+  QVector<qlonglong> upperBounds;
+
+  QString m_errorString;
+
+private slots:
+  void concatenationFinished(bool ok);
+  void jobFinished(bool ok);
+  void jobProgress(int rows);
+};
+
+#endif // PARTITIONEDEXPORT_H
@@ -8,6 +8,8 @@
 
 class Plugin {
 public:
+  virtual ~Plugin() {};
+
   /** Boîte de dialogue de configuration. */
   virtual QDialog* configDialog() { return NULL; };
 
@@ -1,11 +1,15 @@
 #include "pluginmanager.h"
 #include "exportengine.h"
+#include "importengine.h"
 #include "sqlwrapper.h"
 
+#include "exportengines/arrow/arrowexportengine.h"
 #include "exportengines/csv/csvexportengine.h"
 #include "exportengines/html/htmlexportengine.h"
 #include "exportengines/plaintext/plaintextexportengine.h"
 
+#include "importengines/csv/csvimportengine.h"
+
 #include "wrappers/db2i/db2iwrapper.h"
 #include "wrappers/mysql/mysqlwrapper.h"
 #include "wrappers/psql/psqlwrapper.h"
@@ -22,6 +26,9 @@ Plugin* PluginManagerPrivate::toPlugin(QObject *pl) {
   if (!p) {
     p = qobject_cast<ExportEngine*>(pl);
   }
+  if (!p) {
+    p = qobject_cast<ImportEngine*>(pl);
+  }
   if (!p) {
     p = qobject_cast<SqlWrapper*>(pl);
   }
@@ -73,11 +80,30 @@ QList<ExportEngine*> PluginManagerPrivate::exportEngines() {
   return engines;
 }
 
+/**
+ * Extrait les moteurs d'import
+ */
+QList<ImportEngine*> PluginManagerPrivate::importEngines() {
+  QList<ImportEngine*> engines;
+
+  foreach (QObject *p, m_plugins) {
+    ImportEngine *e = qobject_cast<ImportEngine*>(p);
+    if (e) {
+      engines << e;
+    }
+  }
+
+  return engines;
+}
+
 void PluginManagerPrivate::init() {
   registerPlugin(new CsvExportEngine());
   registerPlugin(new HtmlExportEngine());
+  registerPlugin(new ArrowExportEngine());
   // registerPlugin(new PlainTextExportEngine());
 
+  registerPlugin(new CsvImportEngine());
+
   registerPlugin(new Db2iWrapper());
   registerPlugin(new MysqlWrapper());
   registerPlugin(new PsqlWrapper());
@@ -95,6 +121,8 @@ void PluginManagerPrivate::registerPlugin(QObject *plugin) {
 
   if (qobject_cast<ExportEngine*>(plugin)) {
     type = tr("Export engine");
+  } else if (qobject_cast<ImportEngine*>(plugin)) {
+    type = tr("Import engine");
   } else if (qobject_cast<SqlWrapper*>(plugin)) {
     type = tr("SQL Wrapper");
   }
@@ -160,6 +188,10 @@ QList<ExportEngine*> PluginManager::exportEngines() {
   return instance->exportEngines();
 }
 
+QList<ImportEngine*> PluginManager::importEngines() {
+  return instance->importEngines();
+}
+
 void PluginManager::init() {
   instance = new PluginManagerPrivate();
 }
@@ -2,6 +2,7 @@
 #define PLUGINMANAGER_H
 
 #include "exportengine.h"
+#include "importengine.h"
 #include "plugin.h"
 #include "sqlwrapper.h"
 
@@ -18,6 +19,7 @@ public:
   void          add(QString path);
   SqlWrapper*   availableWrapper(QString driver);
   QList<ExportEngine*> exportEngines();
+  QList<ImportEngine*> importEngines();
   QObject*      plugin(QString plid);
   void          registerPlugin(QObject *toPlugin);
   SqlWrapper*   wrapper(QString plid);
@@ -39,6 +41,7 @@ class PluginManager {
 public:
   static SqlWrapper* availableWrapper(QString driver);
   static QList<ExportEngine*> exportEngines();
+  static QList<ImportEngine*> importEngines();
   static void init();
   static QStandardItemModel *model()    { return instance->model();   };
   static Plugin *plugin(QString plid);
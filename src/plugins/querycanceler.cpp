@@ -0,0 +1,112 @@
+#include "querycanceler.h"
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThreadPool>
+
+/**
+ * Sends a cancel request outside of the calling thread.
+ */
+class CancelTask : public QRunnable {
+public:
+  CancelTask(QSharedPointer<QueryCanceler> canceler) {
+    this->canceler = canceler;
+  }
+
+  void run() {
+    canceler->cancel();
+  }
+
+private:
+  QSharedPointer<QueryCanceler> canceler;
+};
+
+QueryCanceler::QueryCanceler() {
+  canceled = false;
+  released = false;
+}
+
+/**
+ * The statement is held until the request is sent : release() waits for it.
+ *
+ * @return false if the statement is already done or could not be canceled
+ */
+bool QueryCanceler::cancel(QString *errorString) {
+  QMutexLocker locker(&mutex);
+  if (released || canceled) {
+    return false;
+  }
+
+  canceled = true;
+  return sendCancel(errorString);
+}
+
+/**
+ * Sends the request from the global thread pool : opening a side connection
+ * may take a while, the GUI must not wait for it.
+ */
+void QueryCanceler::cancelLater(QSharedPointer<QueryCanceler> canceler) {
+  if (canceler) {
+    QThreadPool::globalInstance()->start(new CancelTask(canceler));
+  }
+}
+
+/**
+ * The statement is done, cancel() is now a no-op.
+ */
+void QueryCanceler::release() {
+  QMutexLocker locker(&mutex);
+  released = true;
+}
+
+QAtomicInt SqlQueryCanceler::connectionCount;
+
+/**
+ * Only the settings of the connection are kept : the side connection is
+ * opened by the thread sending the request.
+ */
+SqlQueryCanceler::SqlQueryCanceler(QSqlDatabase *connection,
+                                   QString statement) {
+  connectOptions = connection->connectOptions();
+  databaseName = connection->databaseName();
+  driverName = connection->driverName();
+  hostName = connection->hostName();
+  password = connection->password();
+  port = connection->port();
+  userName = connection->userName();
+  this->statement = statement;
+}
+
+bool SqlQueryCanceler::sendCancel(QString *errorString) {
+  QString name = QString("cancel-%1")
+      .arg(connectionCount.fetchAndAddOrdered(1));
+  bool ok;
+
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase(driverName, name);
+    db.setConnectOptions(connectOptions);
+    db.setDatabaseName(databaseName);
+    db.setHostName(hostName);
+    db.setPassword(password);
+    db.setPort(port);
+    db.setUserName(userName);
+
+    ok = db.open();
+    if (ok) {
+      QSqlQuery q(db);
+      ok = q.exec(statement);
+      if (!ok && errorString) {
+        *errorString = q.lastError().text();
+      }
+    } else if (errorString) {
+      *errorString = db.lastError().text();
+    }
+
+    db.close();
+  }
+  QSqlDatabase::removeDatabase(name);
+
+  return ok;
+}
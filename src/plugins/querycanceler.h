@@ -0,0 +1,67 @@
+#ifndef QUERYCANCELER_H
+#define QUERYCANCELER_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QString>
+
+/**
+ * Cancels, on the server, the statement running on a worker connection.
+ *
+ * Created by SqlWrapper::canceler() in the thread of the connection, before
+ * the statement is run. cancel() is then called from any other thread.
+ * Once the statement is done, its runner calls release() : later calls to
+ * cancel() do nothing, so the request never reaches the next statement of the
+ * connection, nor a handle already closed.
+ */
+class QueryCanceler {
+public:
+  QueryCanceler();
+  virtual ~QueryCanceler() {};
+
+  bool cancel(QString *errorString = NULL);
+  void release();
+
+  static void cancelLater(QSharedPointer<QueryCanceler> canceler);
+
+protected:
+  /**
+   * Sends the request. Called once at most, the statement still running.
+   *
+   * @return false if the request could not be sent
+   */
+  virtual bool sendCancel(QString *errorString) =0;
+
+private:
+  bool canceled;
+  QMutex mutex;
+  bool released;
+};
+
+/**
+ * Runs a statement on a side connection opened with the same settings, e.g.
+ * KILL QUERY for MySQL.
+ */
+class SqlQueryCanceler : public QueryCanceler {
+public:
+  SqlQueryCanceler(QSqlDatabase *connection, QString statement);
+
+protected:
+  bool sendCancel(QString *errorString);
+
+private:
+  QString connectOptions;
+  QString databaseName;
+  QString driverName;
+  QString hostName;
+  QString password;
+  int port;
+  QString statement;
+  QString userName;
+
+  static QAtomicInt connectionCount;
+};
+
+#endif // QUERYCANCELER_H
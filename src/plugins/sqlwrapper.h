@@ -2,9 +2,11 @@
 #define WRAPPER_H
 
 #include "plugin.h"
+#include "querycanceler.h"
 #include "../db_enum.h"
 
 #include <QList>
+#include <QMap>
 #include <QSqlDatabase>
 #include <QSqlDriver>
 #include <QString>
@@ -29,6 +31,46 @@ public:
 
   virtual SqlWrapper* newInstance(QSqlDatabase *db) =0;
 
+  /**
+   * Spécifie si le pilote exécute en un seul appel plusieurs requêtes séparées
+   * par des points-virgules. Le lanceur de scripts les envoie alors par
+   * groupes, un seul aller-retour par groupe.
+   */
+  virtual bool acceptsMultipleStatements() { return false; };
+
+  /**
+   * Charge un fichier texte délimité, encodé en UTF-8, par la voie la plus
+   * rapide du SGBD (COPY, LOAD DATA...) au lieu d'INSERT ligne à ligne.
+   * Appelée dans le thread de la connexion de travail.
+   *
+   * @return le nombre de lignes chargées, -1 en cas d'échec. errorString
+   *    reste vide si ce chargement n'est pas possible : l'import se fait alors
+   *    par INSERT.
+   */
+  virtual int bulkLoad(QSqlDatabase *connection, const SqlBulkLoad &load,
+                       QString *errorString) {
+    return -1;
+  };
+
+  /**
+   * Prépare l'annulation, côté serveur, de la prochaine requête d'une
+   * connexion de travail. Appelée dans le thread de la connexion, juste avant
+   * la requête.
+   *
+   * @return NULL si le SGBD ne permet pas d'annuler une requête. L'appelant
+   *    devient propriétaire de l'objet.
+   */
+  virtual QueryCanceler* canceler(QSqlDatabase *connection) { return NULL; };
+
+  /**
+   * Version globale du catalogue, par ex. PRAGMA schema_version pour SQLite.
+   * Tant qu'elle ne change pas, le cache des métadonnées est considéré à jour
+   * sans appeler tableVersions().
+   *
+   * @return une chaîne vide si le SGBD n'en fournit pas.
+   */
+  virtual QString catalogVersion() { return ""; };
+
   virtual QList<SqlColumn> columns(QString table) { return QList<SqlColumn>(); };
 
   virtual QString driver() =0;
@@ -61,15 +103,89 @@ public:
    */
   virtual QList<SqlSchema> schemas() { return QList<SqlSchema>(); };
 
+  /**
+   * Limite, côté serveur, la durée des requêtes d'une connexion. Appelée dans
+   * le thread de la connexion.
+   *
+   * @param msecs
+   *    durée maximale en millisecondes, 0 pour ne pas la limiter
+   *
+   * @return false si la fonctionnalité n'est pas supportée.
+   */
+  virtual bool setStatementTimeout(QSqlDatabase *connection, int msecs) {
+    return false;
+  };
+
   /** Extrait une table depuis son nom */
   virtual SqlTable table(QString t) =0;
 
   virtual QList<SqlTable> tables() { return QList<SqlTable>(); };
   virtual QList<SqlTable> tables(QString schema) { return QList<SqlTable>(); };
 
+  /**
+   * Extrait certaines tables d'un schéma, avec leurs colonnes. Utilisée pour
+   * ne relire que les tables modifiées, voir tableVersions().
+   *
+   * @param schema
+   *    vide si le SGBD n'a pas de schémas
+   * @param names
+   *    tables à extraire, toutes si la liste est vide
+   */
+  virtual QList<SqlTable> tables(QString schema, QStringList names) {
+    if (names.isEmpty()) {
+      return schema.isEmpty() ? tables() : tables(schema);
+    }
+
+    QList<SqlTable> ret;
+    foreach (QString n, names) {
+      ret << table(schema.isEmpty() ? n : schema + "." + n);
+    }
+    return ret;
+  };
+
+  /**
+   * Liste des tables d'un schéma, sans leurs colonnes : bien plus rapide que
+   * tables() sur un gros catalogue, les colonnes sont lues à la demande.
+   *
+   * @param schema
+   *    vide si le SGBD n'a pas de schémas
+   */
+  virtual QList<SqlTable> tableList(QString schema) {
+    QList<SqlTable> ret = tables(schema, QStringList());
+    for (int i=0; i<ret.size(); i++) {
+      ret[i].columnCount = ret[i].columns.size();
+      ret[i].columns.clear();
+    }
+    return ret;
+  };
+
+  /**
+   * Version de la structure de chaque table d'un schéma, indexée par le nom de
+   * la table. La version change dès que la table (ou une de ses colonnes) est
+   * modifiée : seules ces tables sont relues pour mettre le cache à jour.
+   *
+   * @param schema
+   *    vide si le SGBD n'a pas de schémas
+   *
+   * @return une liste vide si la fonctionnalité n'est pas supportée.
+   */
+  virtual QMap<QString, QString> tableVersions(QString schema) {
+    return QMap<QString, QString>();
+  };
+
   QSqlDatabase* db() { return m_db; };
 
 protected:
+  /**
+   * Noms entre apostrophes, séparés par des virgules, pour une clause IN.
+   */
+  static QString sqlList(QStringList names) {
+    for (int i=0; i<names.size(); i++) {
+      names[i] = "'" + names[i].replace("'", "''") + "'";
+    }
+    return names.join(", ");
+  };
+
   QSqlDatabase *m_db;
 };
 
@@ -5,9 +5,11 @@ VERSION=0.8
 INCLUDEPATH+=../../../src/plugins
 TARGET=mysqlwrapper
 HEADERS += \
+    ../../querycanceler.h \
     mysqlwrapper.h
 
 SOURCES += \
+    ../../querycanceler.cpp \
     mysqlwrapper.cpp
 
 # ##
@@ -1,10 +1,20 @@
 #include "mysqlwrapper.h"
 
 #include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QPair>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QVariant>
 
+/**
+ * String literal, backslashes being escape characters.
+ */
+static QString sqlString(QString s) {
+  return "'" + s.replace("\\", "\\\\").replace("'", "\\'") + "'";
+}
+
 MysqlWrapper::MysqlWrapper(QObject *parent)
   : QObject(parent) {
 }
@@ -14,6 +24,76 @@ MysqlWrapper::MysqlWrapper(QSqlDatabase *db)
   m_db = db;
 }
 
+/**
+ * LOAD DATA LOCAL INFILE : the client library sends the file itself. The
+ * server (local_infile) and the client (MYSQL_OPT_LOCAL_INFILE=1 in the
+ * connection options) must both allow it. Empty fields are loaded as NULL.
+ */
+int MysqlWrapper::bulkLoad(QSqlDatabase *connection, const SqlBulkLoad &load,
+                           QString *errorString) {
+  QSqlQuery query(*connection);
+  if (!query.exec("SELECT @@local_infile") || !query.next()
+      || !query.value(0).toBool()) {
+    return -1;
+  }
+
+  // lines are ended as in the beginning of the file
+  QFile f(load.path);
+  if (!f.open(QFile::ReadOnly)) {
+    *errorString = tr("Unable to open the file %1.").arg(load.path);
+    return -1;
+  }
+  bool crlf = f.read(64 * 1024).contains("\r\n");
+  f.close();
+
+  QStringList fields;
+  QStringList assignments;
+  for (int i=0; i<load.columns.size(); i++) {
+    fields << QString("@f%1").arg(i);
+    if (!load.columns[i].isEmpty()) {
+      assignments << QString("%1 = NULLIF(@f%2, '')")
+                     .arg(load.columns[i], QString::number(i));
+    }
+  }
+
+  QString sql = "LOAD DATA LOCAL INFILE " + sqlString(load.path);
+  sql += " INTO TABLE " + load.table + " CHARACTER SET utf8mb4";
+  sql += " FIELDS TERMINATED BY " + sqlString(load.separator);
+  if (!load.quote.isNull()) {
+    sql += " OPTIONALLY ENCLOSED BY " + sqlString(load.quote);
+  }
+  sql += " ESCAPED BY ''";
+  sql += crlf ? " LINES TERMINATED BY '\\r\\n'" : " LINES TERMINATED BY '\\n'";
+  if (load.header) {
+    sql += " IGNORE 1 LINES";
+  }
+  sql += " (" + fields.join(", ") + ") SET " + assignments.join(", ");
+
+  if (!query.exec(sql)) {
+    // refused by the client library or the server
+    int code = query.lastError().nativeErrorCode().toInt();
+    if (code != 1148 && code != 2068 && code != 3948 && code != 3950) {
+      *errorString = query.lastError().text();
+    }
+    return -1;
+  }
+
+  return query.numRowsAffected();
+}
+
+/**
+ * KILL QUERY on a side connection : the connection itself is kept.
+ */
+QueryCanceler* MysqlWrapper::canceler(QSqlDatabase *connection) {
+  QSqlQuery query(*connection);
+  if (!query.exec("SELECT CONNECTION_ID()") || !query.next()) {
+    return NULL;
+  }
+
+  return new SqlQueryCanceler(connection,
+      QString("KILL QUERY %1").arg(query.value(0).toLongLong()));
+}
+
 QList<SqlColumn> MysqlWrapper::columns(QString table) {
   QList<SqlColumn> cols;
 
@@ -94,6 +174,20 @@ SqlWrapper* MysqlWrapper::newInstance(QSqlDatabase *db) {
   return new MysqlWrapper(db);
 }
 
+/**
+ * max_execution_time on MySQL, which only applies to SELECT statements.
+ * MariaDB names it max_statement_time, in seconds.
+ */
+bool MysqlWrapper::setStatementTimeout(QSqlDatabase *connection, int msecs) {
+  QSqlQuery query(*connection);
+  if (query.exec(QString("SET SESSION max_execution_time = %1").arg(msecs))) {
+    return true;
+  }
+
+  return query.exec(QString("SET SESSION max_statement_time = %1")
+                    .arg(msecs / 1000.0));
+}
+
 SqlTable MysqlWrapper::table(QString t) {
   SqlTable table;
 
@@ -183,7 +277,10 @@ SqlTable MysqlWrapper::table(QString t) {
   return table;
 }
 
-QList<SqlTable> MysqlWrapper::tables() {
+/**
+ * Tables of the database without their columns, only counted.
+ */
+QList<SqlTable> MysqlWrapper::tableList(QString schema) {
   QList<SqlTable> tables;
 
   if (!m_db) {
@@ -191,30 +288,183 @@ QList<SqlTable> MysqlWrapper::tables() {
   }
 
   QString sql;
-
-  sql += "SELECT TABLE_NAME, TABLE_TYPE ";
-  sql += "FROM INFORMATION_SCHEMA.TABLES ";
-  sql += "WHERE TABLE_SCHEMA = '";
-  sql += m_db->databaseName();
-  sql += "' ";
-
-  sql += "ORDER BY TABLE_NAME";
+  sql += "SELECT T.TABLE_NAME, T.TABLE_TYPE, T.TABLE_COMMENT, ";
+  sql += "COUNT(C.COLUMN_NAME) ";
+  sql += "FROM INFORMATION_SCHEMA.TABLES T ";
+  sql +=   "LEFT JOIN INFORMATION_SCHEMA.COLUMNS C ";
+  sql +=   "ON C.TABLE_NAME = T.TABLE_NAME ";
+  sql +=     "AND C.TABLE_SCHEMA = T.TABLE_SCHEMA ";
+  sql += "WHERE T.TABLE_SCHEMA='" + m_db->databaseName() + "' ";
+  sql += "GROUP BY T.TABLE_NAME, T.TABLE_TYPE, T.TABLE_COMMENT ";
+  sql += "ORDER BY T.TABLE_NAME";
 
   QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
   if (!query.exec(sql)) {
     qDebug() << query.lastError().text();
     return tables;
   }
 
-  SqlTable t;
   while (query.next()) {
-    t = SqlTable();
+    SqlTable t;
     t.name = query.value(0).toString();
     t.type = query.value(1).toString().toLower() == "base table"
         ? Table : ViewTable;
-    t.columns = columns(t.name);
-
+    t.comment = query.value(2).toString();
+    t.columnCount = query.value(3).toInt();
     tables << t;
   }
+
+  return tables;
+}
+
+QList<SqlTable> MysqlWrapper::tables() {
+  return tables("", QStringList());
+}
+
+/**
+ * Loads the tables of the database with their columns and primary keys in two
+ * queries, whatever the number of tables.
+ */
+QList<SqlTable> MysqlWrapper::tables(QString schema, QStringList names) {
+  QList<SqlTable> tables;
+
+  if (!m_db) {
+    return tables;
+  }
+
+  QString sql;
+
+  // Récupération des tables et de leurs colonnes
+
+  sql += "SELECT T.TABLE_NAME, T.TABLE_TYPE, T.TABLE_COMMENT, C.COLUMN_NAME, ";
+  sql += "C.COLUMN_TYPE, C.IS_NULLABLE, C.COLUMN_DEFAULT, C.COLUMN_COMMENT ";
+  sql += "FROM INFORMATION_SCHEMA.TABLES T ";
+  sql +=   "LEFT JOIN INFORMATION_SCHEMA.COLUMNS C ";
+  sql +=   "ON C.TABLE_NAME = T.TABLE_NAME ";
+  sql +=     "AND C.TABLE_SCHEMA = T.TABLE_SCHEMA ";
+  sql += "WHERE T.TABLE_SCHEMA='" + m_db->databaseName() + "' ";
+  if (!names.isEmpty()) {
+    sql += "AND T.TABLE_NAME IN (" + sqlList(names) + ") ";
+  }
+
+  // the rows of a table must follow each other, even if another one only
+  // differs by the case
+  sql += "ORDER BY BINARY T.TABLE_NAME, C.ORDINAL_POSITION";
+
+  QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
+  if (!query.exec(sql)) {
+    qDebug() << query.lastError().text();
+    return tables;
+  }
+
+  // position of each column, to flag the primary keys
+  QHash<QPair<QString, QString>, QPair<int, int> > positions;
+
+  while (query.next()) {
+    QString name = query.value(0).toString();
+    if (tables.isEmpty() || tables.last().name != name) {
+      SqlTable t;
+      t.name = name;
+      t.type = query.value(1).toString().toLower() == "base table"
+          ? Table : ViewTable;
+      t.comment = query.value(2).toString();
+      t.columnCount = 0;
+      tables << t;
+    }
+
+    // tables without columns
+    if (query.isNull(3)) {
+      continue;
+    }
+
+    SqlTable &t = tables.last();
+
+    SqlColumn c;
+    c.name = query.value(3).toString();
+    c.primaryKey = false;
+    SqlType ty;
+    ty.name = query.value(4).toString().toUpper();
+    c.type = ty;
+    c.permitsNull = query.value(5).toString().toLower() == "yes";
+    c.defaultValue = query.value(6);
+    c.comment = query.value(7).toString();
+
+    positions.insert(qMakePair(t.name, c.name),
+                     qMakePair(tables.size() - 1, t.columns.size()));
+    t.columns << c;
+    t.columnCount++;
+  }
+
+  if (tables.isEmpty()) {
+    return tables;
+  }
+
+  // Récupération des clés primaires
+
+  sql = "";
+  sql += "SELECT TABLE_NAME, COLUMN_NAME ";
+  sql += "FROM INFORMATION_SCHEMA.KEY_COLUMN_USAGE ";
+  sql += "WHERE CONSTRAINT_SCHEMA='" + m_db->databaseName() + "' ";
+  sql +=   "AND CONSTRAINT_NAME='PRIMARY' ";
+  if (!names.isEmpty()) {
+    sql += "AND TABLE_NAME IN (" + sqlList(names) + ") ";
+  }
+
+  if (!query.exec(sql)) {
+    qDebug() << query.lastError().text();
+    return tables;
+  }
+
+  while (query.next()) {
+    QPair<QString, QString> key(query.value(0).toString(),
+                                query.value(1).toString());
+    if (!positions.contains(key)) {
+      qDebug() << "Unable to find" << key.second << "in table" << key.first;
+      continue;
+    }
+
+    QPair<int, int> pos = positions.value(key);
+    tables[pos.first].columns[pos.second].primaryKey = true;
+  }
+
   return tables;
 }
+
+/**
+ * MySQL has no cheap catalog version : the version of a table is its creation
+ * time and a checksum of its columns.
+ */
+QMap<QString, QString> MysqlWrapper::tableVersions(QString schema) {
+  QMap<QString, QString> versions;
+
+  if (!m_db) {
+    return versions;
+  }
+
+  QString sql;
+  sql += "SELECT T.TABLE_NAME, CONCAT_WS('.', T.CREATE_TIME, ";
+  sql += "SUM(CRC32(CONCAT_WS('|', C.ORDINAL_POSITION, C.COLUMN_NAME, ";
+  sql += "C.COLUMN_TYPE, C.IS_NULLABLE, C.COLUMN_DEFAULT, C.COLUMN_KEY, ";
+  sql += "C.COLUMN_COMMENT)))) ";
+  sql += "FROM INFORMATION_SCHEMA.TABLES T ";
+  sql +=   "LEFT JOIN INFORMATION_SCHEMA.COLUMNS C ";
+  sql +=   "ON C.TABLE_NAME = T.TABLE_NAME ";
+  sql +=     "AND C.TABLE_SCHEMA = T.TABLE_SCHEMA ";
+  sql += "WHERE T.TABLE_SCHEMA='" + m_db->databaseName() + "' ";
+  sql += "GROUP BY T.TABLE_NAME, T.CREATE_TIME";
+
+  QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
+  if (!query.exec(sql)) {
+    qDebug() << query.lastError().text();
+    return versions;
+  }
+
+  while (query.next()) {
+    versions[query.value(0).toString()] = query.value(1).toString();
+  }
+
+  return versions;
+}
@@ -20,12 +20,19 @@ public:
   QString version() { return QCoreApplication::applicationVersion(); };
 
   // Fonctions de SqlWrapper
+  int bulkLoad(QSqlDatabase *connection, const SqlBulkLoad &load,
+               QString *errorString);
+  QueryCanceler* canceler(QSqlDatabase *connection);
   QList<SqlColumn> columns(QString table);
   WrapperFeatures features();
   SqlWrapper* newInstance(QSqlDatabase *db);
   QString driver() { return "QMYSQL"; };
+  bool setStatementTimeout(QSqlDatabase *connection, int msecs);
   SqlTable table(QString t);
+  QList<SqlTable> tableList(QString schema);
   QList<SqlTable> tables();
+  QList<SqlTable> tables(QString schema, QStringList names);
+  QMap<QString, QString> tableVersions(QString schema);
 
 signals:
 
@@ -5,13 +5,22 @@ VERSION=0.8
 INCLUDEPATH+=../../../src/plugins
 TARGET=psqlwrapper
 HEADERS += \
+    ../../querycanceler.h \
     psqlwrapper.h \
     psqlconfig.h
 
 SOURCES += \
+    ../../querycanceler.cpp \
     psqlwrapper.cpp \
     psqlconfig.cpp
 
+# PQcancel() and COPY FROM STDIN through the QPSQL handle (qmake CONFIG+=libpq)
+libpq {
+    DEFINES += HAVE_LIBPQ
+    LIBS += -lpq
+    unix:INCLUDEPATH += /usr/include/postgresql
+}
+
 # ##
 # MS Windows
 win32: {
@@ -1,11 +1,18 @@
 #include "psqlwrapper.h"
 
 #include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QPair>
 #include <QSettings>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QVariant>
 
+#ifdef HAVE_LIBPQ
+#include <libpq-fe.h>
+#endif
+
 bool PsqlWrapper::informationSchemaHidden = true;
 bool PsqlWrapper::pgCatalogHidden = true;
 
@@ -19,7 +26,157 @@ PsqlWrapper::PsqlWrapper(QSqlDatabase *db)
   pgCatalogHidden = s.value("pgCatalogHidden", true).toBool();
   s.endGroup();
 
-  m_configDialog = new PsqlConfig(this);
+  // instances may be created by the loading threads, which can't make widgets
+  m_configDialog = NULL;
+}
+
+PsqlWrapper::~PsqlWrapper() {
+  delete m_configDialog;
+}
+
+#ifdef HAVE_LIBPQ
+/**
+ * The libpq connection behind the QPSQL handle, NULL if there is none.
+ */
+static PGconn* pgConnection(QSqlDatabase *connection) {
+  QVariant v = connection->driver()->handle();
+  if (v.isValid() && qstrcmp(v.typeName(), "PGconn*") == 0) {
+    return *static_cast<PGconn **>(v.data());
+  }
+
+  return NULL;
+}
+
+/**
+ * Cancels through the protocol, as psql does on Ctrl+C : PQcancel() needs
+ * no other connection.
+ */
+class PsqlCanceler : public QueryCanceler {
+public:
+  PsqlCanceler(PGconn *conn) {
+    handle = PQgetCancel(conn);
+  }
+
+  ~PsqlCanceler() {
+    if (handle) {
+      PQfreeCancel(handle);
+    }
+  }
+
+protected:
+  bool sendCancel(QString *errorString) {
+    char buffer[256];
+    if (handle && PQcancel(handle, buffer, sizeof(buffer))) {
+      return true;
+    }
+
+    if (errorString) {
+      *errorString = QString::fromLocal8Bit(handle ? buffer : "");
+    }
+    return false;
+  }
+
+private:
+  PGcancel *handle;
+};
+#endif
+
+/**
+ * COPY ... FROM STDIN in CSV format, the file being sent by chunks through the
+ * driver's handle : only possible with libpq (qmake CONFIG+=libpq). COPY can't
+ * skip a field of the file.
+ */
+int PsqlWrapper::bulkLoad(QSqlDatabase *connection, const SqlBulkLoad &load,
+                          QString *errorString) {
+#ifdef HAVE_LIBPQ
+  PGconn *conn = pgConnection(connection);
+  if (!conn || load.columns.contains("")) {
+    return -1;
+  }
+
+  QFile f(load.path);
+  if (!f.open(QFile::ReadOnly)) {
+    *errorString = tr("Unable to open the file %1.").arg(load.path);
+    return -1;
+  }
+
+  // no way to disable the quotes of the CSV format : an unlikely character
+  QString quote = load.quote.isNull() ? "E'\\x01'"
+      : "'" + QString(load.quote).replace("'", "''") + "'";
+
+  QString sql = QString("COPY %1 (%2) FROM STDIN WITH (FORMAT csv, "
+                        "DELIMITER '%3', QUOTE %4, HEADER %5, "
+                        "ENCODING 'UTF8')")
+      .arg(load.table)
+      .arg(load.columns.join(", "))
+      .arg(QString(load.separator).replace("'", "''"))
+      .arg(quote)
+      .arg(load.header ? "true" : "false");
+
+  PGresult *res = PQexec(conn, sql.toUtf8().constData());
+  if (PQresultStatus(res) != PGRES_COPY_IN) {
+    *errorString = QString::fromUtf8(PQresultErrorMessage(res));
+    PQclear(res);
+    return -1;
+  }
+  PQclear(res);
+
+  bool sent = true;
+  QByteArray chunk;
+  while (sent && !(chunk = f.read(CopyChunkSize)).isEmpty()) {
+    sent = PQputCopyData(conn, chunk.constData(), chunk.size()) == 1;
+  }
+
+  // a read error aborts the COPY
+  if (sent) {
+    PQputCopyEnd(conn, f.error() == QFile::NoError ? NULL : "read error");
+  }
+
+  // the outcome of the COPY, then the end of the results
+  int rows = -1;
+  while ((res = PQgetResult(conn))) {
+    if (PQresultStatus(res) == PGRES_COMMAND_OK) {
+      rows = QString(PQcmdTuples(res)).toInt();
+    } else if (errorString->isEmpty()) {
+      *errorString = QString::fromUtf8(PQresultErrorMessage(res));
+    }
+    PQclear(res);
+  }
+
+  if (rows < 0 && errorString->isEmpty()) {
+    *errorString = QString::fromUtf8(PQerrorMessage(conn));
+  }
+  if (f.error() != QFile::NoError) {
+    *errorString = f.errorString();
+    rows = -1;
+  }
+
+  return rows;
+#else
+  return -1;
+#endif
+}
+
+/**
+ * With libpq (qmake CONFIG+=libpq), the cancel request goes through the
+ * driver's handle. Otherwise pg_cancel_backend() is run on a side connection,
+ * which costs a query to read the backend's pid.
+ */
+QueryCanceler* PsqlWrapper::canceler(QSqlDatabase *connection) {
+#ifdef HAVE_LIBPQ
+  PGconn *conn = pgConnection(connection);
+  if (conn) {
+    return new PsqlCanceler(conn);
+  }
+#endif
+
+  QSqlQuery query(*connection);
+  if (!query.exec("SELECT pg_backend_pid()") || !query.next()) {
+    return NULL;
+  }
+
+  return new SqlQueryCanceler(connection,
+      QString("SELECT pg_cancel_backend(%1)").arg(query.value(0).toInt()));
 }
 
 QList<SqlColumn> PsqlWrapper::columns(QString table) {
@@ -95,6 +252,16 @@ QList<SqlColumn> PsqlWrapper::columns(QString table) {
   return cols;
 }
 
+/**
+ * Created when first shown, always from the GUI thread.
+ */
+QDialog* PsqlWrapper::configDialog() {
+  if (!m_configDialog) {
+    m_configDialog = new PsqlConfig(this);
+  }
+  return m_configDialog;
+}
+
 SqlWrapper::WrapperFeatures PsqlWrapper::features() {
   return ODBC | Schemas;
 }
@@ -160,7 +327,8 @@ SqlSchema PsqlWrapper::schema(QString sch) {
 }
 
 /**
- * Récupération de la liste des tables
+ * Récupération de la liste des schémas et de leurs tables, sans les colonnes :
+ * elles sont lues quand une table est dépliée.
  */
 QList<SqlSchema> PsqlWrapper::schemas() {
   QList<SqlSchema> schemas;
@@ -170,170 +338,65 @@ QList<SqlSchema> PsqlWrapper::schemas() {
   }
 
   QString sql;
-  sql += "SELECT t.table_schema, t.table_name, t.table_type, c.column_name, ";
-  sql += "c.is_nullable, c.data_type, c.column_default ";
-  sql += "FROM INFORMATION_SCHEMA.COLUMNS C ";
-  sql += "INNER JOIN INFORMATION_SCHEMA.TABLES T ";
-  sql +=   "ON C.TABLE_NAME = T.TABLE_NAME ";
-  sql +=      "AND C.TABLE_SCHEMA = T.TABLE_SCHEMA ";
-  sql +=   "WHERE t.table_catalog='" + m_db->databaseName() + "' ";
+  sql += "SELECT n.nspname, pg_get_userbyid(n.nspowner), c.relname, ";
+  sql += "c.relkind, (SELECT COUNT(*) FROM pg_catalog.pg_attribute a ";
+  sql +=   "WHERE a.attrelid = c.oid AND a.attnum > 0 ";
+  sql +=     "AND NOT a.attisdropped) ";
+  sql += "FROM pg_catalog.pg_namespace n ";
+  sql += "LEFT JOIN pg_catalog.pg_class c ";
+  sql +=   "ON c.relnamespace = n.oid ";
+  sql +=     "AND c.relkind IN ('r', 'p', 'f', 'v', 'm') ";
+  sql += "WHERE n.nspname NOT LIKE 'pg_toast%' ";
+  sql +=   "AND n.nspname NOT LIKE 'pg_temp_%' ";
   if (informationSchemaHidden) {
-    sql +=   "AND t.table_schema <> 'information_schema' ";
+    sql +=   "AND n.nspname <> 'information_schema' ";
   }
   if (pgCatalogHidden) {
-    sql +=   "AND t.table_schema <> 'pg_catalog' ";
+    sql +=   "AND n.nspname <> 'pg_catalog' ";
   }
-  sql +=   "ORDER BY table_schema, table_name, ordinal_position ";
+  sql += "ORDER BY n.nspname, c.relname ";
 
   QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
   if (!query.exec(sql)) {
     qDebug() << query.lastError().text();
     return schemas;
   }
 
-  // compte le nombre total de tables
-  // si = 0 alors inutile de chercher les clés primaires.
-  int tableCount = 0;
-
-  bool first = true;
-  bool ruptureSchema = false;
-  bool ruptureTable = false;
-  SqlSchema s;
-  SqlTable t;
   while (query.next()) {
-    // Schémas
-    ruptureSchema = s.name != query.value(0).toString();
-
-    if (ruptureSchema && s.name != "") {
-      s.tables << t;
-      schemas << s;
-
-      tableCount += s.tables.size();
-    }
-
-    if (ruptureSchema) {
-      s = SqlSchema();
-      s.name = query.value(0).toString();
+    QString name = query.value(0).toString();
+    if (schemas.isEmpty() || schemas.last().name != name) {
+      SqlSchema s;
+      s.name = name;
       s.defaultSchema = s.name == "public";
+      s.owner = query.value(1).toString();
+      schemas << s;
     }
 
-    // Tables
-    ruptureTable = t.name != query.value(1).toString();
-
-    if (first || (ruptureTable && !ruptureSchema && t.name != "")) {
-      first = false;
-      s.tables << t;
-    }
-
-    if (ruptureTable) {
-      t = SqlTable();
-      t.name = query.value(1).toString();
-      if (query.value(2).toString() == "BASE TABLE") {
-        t.type = Table;
-      } else if (query.value(2).toString() == "VIEW") {
-        t.type = ViewTable;
-      }
-    }
-
-    // Colonnes
-    SqlColumn c;
-    c.name = query.value(3).toString();
-    c.permitsNull = query.value(4).toBool();
-    c.primaryKey = false;
-    c.defaultValue = query.value(6);
-    t.columns << c;
-  }
-
-  if (s.name.length() > 0) {
-    if (t.name.length() > 0) {
-      s.tables << t;
-    }
-    schemas << s;
-
-    tableCount += s.tables.size();
-  }
-
-  if (tableCount == 0) {
-    return schemas;
-  }
-
-
-
-  // Récupération des clés primaires
-
-  sql = "";
-  sql += "SELECT U.TABLE_SCHEMA, U.TABLE_NAME, COLUMN_NAME ";
-  sql += "FROM INFORMATION_SCHEMA.KEY_COLUMN_USAGE U ";
-  sql += "INNER JOIN INFORMATION_SCHEMA.TABLE_CONSTRAINTS T ";
-  sql += "USING (TABLE_CATALOG, TABLE_SCHEMA, TABLE_NAME, CONSTRAINT_NAME) ";
-  sql += "WHERE T.CONSTRAINT_CATALOG = '" + m_db->databaseName() + "' ";
-  sql +=   "AND CONSTRAINT_TYPE = 'PRIMARY KEY' ";
-  sql += "ORDER BY TABLE_SCHEMA, TABLE_NAME";
-
-  if (!query.exec(sql)) {
-    qDebug() << query.lastError().text();
-    return schemas;
-  }
-
-  QString ruptureS = "";
-  QString ruptureT = "";
-  s = schemas[0];
-  int t_idx = -1;
-  int s_idx = 0;
-  while (query.next()) {
-
-    ruptureS = query.value(0).toString();
-    if (schemas[s_idx].name != ruptureS) {
-      s_idx = -1;
-      for (int i=0; i<schemas.size(); i++) {
-        if (schemas[i].name == ruptureS) {
-          s_idx = i;
-          s = schemas[i];
-          break;
-        }
-      }
-
-      if (s_idx == -1) {
-        s_idx = 0;
-        qDebug() << "Unknown schema" << ruptureS;
-        continue;
-      }
-    }
-
-    if (ruptureT != query.value(1).toString()) {
-      ruptureT = query.value(1).toString();
-      t_idx = -1;
-      for (int i=0; i<s.tables.size(); i++) {
-        if (s.tables[i].name == ruptureT) {
-          t_idx = i;
-          break;
-        }
-      }
-
-      if (t_idx < 0) {
-        qDebug() << "Unknown table" << ruptureT;
-        continue;
-      }
-    }
-
-    QString column = query.value(2).toString();
-    int position = -1;
-    for (int i=0; i<schemas[s_idx].tables[t_idx].columns.size(); i++) {
-      if (schemas[s_idx].tables[t_idx].columns[i].name == column) {
-        position = i;
-        schemas[s_idx].tables[t_idx].columns[position].primaryKey = true;
-      }
+    // schémas vides
+    if (query.isNull(2)) {
+      continue;
     }
 
-    if (position == -1) {
-      qDebug() << "Unable to find" << column
-               << "in table" << schemas[s_idx].tables[t_idx].name;
-    }
+    SqlTable t;
+    t.name = query.value(2).toString();
+    QString kind = query.value(3).toString();
+    t.type = kind == "v" || kind == "m" ? ViewTable : Table;
+    t.columnCount = query.value(4).toInt();
+    schemas.last().tables << t;
   }
 
   return schemas;
 }
 
+/**
+ * statement_timeout, the server then cancels the query by itself.
+ */
+bool PsqlWrapper::setStatementTimeout(QSqlDatabase *connection, int msecs) {
+  QSqlQuery query(*connection);
+  return query.exec(QString("SET statement_timeout = %1").arg(msecs));
+}
+
 SqlTable PsqlWrapper::table(QString t) {
   SqlTable table;
 
@@ -429,7 +492,59 @@ SqlTable PsqlWrapper::table(QString t) {
   return table;
 }
 
+/**
+ * Tables of a schema without their columns, only counted.
+ */
+QList<SqlTable> PsqlWrapper::tableList(QString schema) {
+  QList<SqlTable> tables;
+
+  if (!m_db) {
+    return tables;
+  }
+
+  QString sql;
+  sql += "SELECT c.relname, c.relkind, pg_get_userbyid(c.relowner), ";
+  sql += "obj_description(c.oid, 'pg_class'), ";
+  sql += "(SELECT COUNT(*) FROM pg_catalog.pg_attribute a ";
+  sql +=   "WHERE a.attrelid = c.oid AND a.attnum > 0 ";
+  sql +=     "AND NOT a.attisdropped) ";
+  sql += "FROM pg_catalog.pg_class c ";
+  sql += "INNER JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace ";
+  sql += "WHERE n.nspname = '" + schema + "' ";
+  sql +=   "AND c.relkind IN ('r', 'p', 'f', 'v', 'm') ";
+  sql += "ORDER BY c.relname ";
+
+  QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
+  if (!query.exec(sql)) {
+    qDebug() << query.lastError().text();
+    return tables;
+  }
+
+  while (query.next()) {
+    SqlTable t;
+    t.name = query.value(0).toString();
+    QString kind = query.value(1).toString();
+    t.type = kind == "v" || kind == "m" ? ViewTable : Table;
+    t.owner = query.value(2).toString();
+    t.comment = query.value(3).toString();
+    t.columnCount = query.value(4).toInt();
+    tables << t;
+  }
+
+  return tables;
+}
+
 QList<SqlTable> PsqlWrapper::tables(QString schema) {
+  return tables(schema, QStringList());
+}
+
+/**
+ * Loads the tables of a schema with their columns and primary keys : one
+ * query on pg_catalog for the columns, one for the keys, whatever the number
+ * of tables.
+ */
+QList<SqlTable> PsqlWrapper::tables(QString schema, QStringList names) {
 
   QList<SqlTable> tables;
 
@@ -438,31 +553,138 @@ QList<SqlTable> PsqlWrapper::tables(QString schema) {
   }
 
   QString sql;
-  sql += "SELECT table_schema, table_name, table_type ";
-  sql += "FROM INFORMATION_SCHEMA.TABLES ";
-  sql +=   "WHERE table_catalog='" + m_db->databaseName() + "' ";
-  sql +=     "AND table_schema = '" + schema + "' ";
-  sql +=   "ORDER BY table_schema, table_name ";
+  sql += "SELECT c.relname, c.relkind, pg_get_userbyid(c.relowner), ";
+  sql += "obj_description(c.oid, 'pg_class'), a.attname, NOT a.attnotnull, ";
+  sql += "format_type(a.atttypid, a.atttypmod), ";
+  sql += "pg_get_expr(d.adbin, d.adrelid), col_description(c.oid, a.attnum) ";
+  sql += "FROM pg_catalog.pg_class c ";
+  sql += "INNER JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace ";
+  sql += "LEFT JOIN pg_catalog.pg_attribute a ";
+  sql +=   "ON a.attrelid = c.oid AND a.attnum > 0 AND NOT a.attisdropped ";
+  sql += "LEFT JOIN pg_catalog.pg_attrdef d ";
+  sql +=   "ON d.adrelid = c.oid AND d.adnum = a.attnum ";
+  sql += "WHERE n.nspname = '" + schema + "' ";
+  sql +=   "AND c.relkind IN ('r', 'p', 'f', 'v', 'm') ";
+  if (!names.isEmpty()) {
+    sql += "AND c.relname IN (" + sqlList(names) + ") ";
+  }
+  sql += "ORDER BY c.relname, a.attnum ";
 
   QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
   if (!query.exec(sql)) {
     qDebug() << query.lastError().text();
     return tables;
   }
 
-  SqlTable t;
+  // position of each column, to flag the primary keys
+  QHash<QPair<QString, QString>, QPair<int, int> > positions;
+
   while (query.next()) {
-    t = SqlTable();
-    t.name = query.value(1).toString();
-    if (query.value(2).toString() == "BASE TABLE") {
-      t.type = Table;
-    } else if (query.value(2).toString() == "VIEW") {
-      t.type = ViewTable;
+    QString name = query.value(0).toString();
+    if (tables.isEmpty() || tables.last().name != name) {
+      SqlTable t;
+      t.name = name;
+      QString kind = query.value(1).toString();
+      t.type = kind == "v" || kind == "m" ? ViewTable : Table;
+      t.owner = query.value(2).toString();
+      t.comment = query.value(3).toString();
+      t.columnCount = 0;
+      tables << t;
     }
-    t.columns = columns(t.name);
 
-    tables << t;
+    // tables without columns
+    if (query.isNull(4)) {
+      continue;
+    }
+
+    SqlTable &t = tables.last();
+
+    SqlColumn c;
+    c.name = query.value(4).toString();
+    c.permitsNull = query.value(5).toBool();
+    c.primaryKey = false;
+    c.type.name = query.value(6).toString();
+    c.type.hasSize = false;
+    c.type.size = 0;
+    c.defaultValue = query.value(7);
+    c.comment = query.value(8).toString();
+
+    positions.insert(qMakePair(t.name, c.name),
+                     qMakePair(tables.size() - 1, t.columns.size()));
+    t.columns << c;
+    t.columnCount++;
+  }
+
+  if (tables.isEmpty()) {
+    return tables;
+  }
+
+  // Récupération des clés primaires
+
+  sql = "";
+  sql += "SELECT c.relname, a.attname ";
+  sql += "FROM pg_catalog.pg_index i ";
+  sql += "INNER JOIN pg_catalog.pg_class c ON c.oid = i.indrelid ";
+  sql += "INNER JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace ";
+  sql += "INNER JOIN pg_catalog.pg_attribute a ";
+  sql +=   "ON a.attrelid = c.oid AND a.attnum = ANY(i.indkey) ";
+  sql += "WHERE i.indisprimary ";
+  sql +=   "AND n.nspname = '" + schema + "' ";
+  if (!names.isEmpty()) {
+    sql += "AND c.relname IN (" + sqlList(names) + ") ";
+  }
+
+  if (!query.exec(sql)) {
+    qDebug() << query.lastError().text();
+    return tables;
+  }
+
+  while (query.next()) {
+    QPair<QString, QString> key(query.value(0).toString(),
+                                query.value(1).toString());
+    if (!positions.contains(key)) {
+      qDebug() << "Unable to find" << key.second << "in table" << key.first;
+      continue;
+    }
+
+    QPair<int, int> pos = positions.value(key);
+    tables[pos.first].columns[pos.second].primaryKey = true;
   }
 
   return tables;
 }
+
+/**
+ * The version of a table changes with its pg_class row (ALTER TABLE), its
+ * relfilenode (rewrites) or any of its pg_attribute rows.
+ */
+QMap<QString, QString> PsqlWrapper::tableVersions(QString schema) {
+  QMap<QString, QString> versions;
+
+  if (!m_db) {
+    return versions;
+  }
+
+  QString sql;
+  sql += "SELECT c.relname, c.xmin::text || '.' || c.relfilenode || '.' || ";
+  sql += "(SELECT max(a.xmin::text::bigint) FROM pg_catalog.pg_attribute a ";
+  sql +=   "WHERE a.attrelid = c.oid) ";
+  sql += "FROM pg_catalog.pg_class c ";
+  sql += "INNER JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace ";
+  sql += "WHERE n.nspname = '" + schema + "' ";
+  sql +=   "AND c.relkind IN ('r', 'p', 'f', 'v', 'm') ";
+
+  QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
+  if (!query.exec(sql)) {
+    qDebug() << query.lastError().text();
+    return versions;
+  }
+
+  while (query.next()) {
+    versions[query.value(0).toString()] = query.value(1).toString();
+  }
+
+  return versions;
+}
@@ -12,6 +12,7 @@ Q_OBJECT
 Q_INTERFACES(SqlWrapper)
 public:
   PsqlWrapper(QSqlDatabase *db =0);
+  ~PsqlWrapper();
 
   // Fonctions de Plugin
   QString plid() { return "DBM.PSQL.WRAPPER"; };
@@ -21,20 +22,30 @@ public:
   QString version() { return QCoreApplication::applicationVersion(); };
 
   // Fonctions de SqlWrapper
+  bool            acceptsMultipleStatements() { return true; };
+  int             bulkLoad(QSqlDatabase *connection, const SqlBulkLoad &load,
+                           QString *errorString);
+  QueryCanceler*  canceler(QSqlDatabase *connection);
   QList<SqlColumn> columns(QString table);
-  QDialog*        configDialog() { return m_configDialog; };
+  QDialog*        configDialog();
   WrapperFeatures features();
   SqlWrapper*     newInstance(QSqlDatabase *db);
   SqlSchema       schema(QString s);
   QList<SqlSchema> schemas();
+  bool            setStatementTimeout(QSqlDatabase *connection, int msecs);
   QString         driver() { return "QPSQL"; };
   SqlTable        table(QString t);
   QList<SqlTable> tables(QString schema);
+  QList<SqlTable> tableList(QString schema);
+  QList<SqlTable> tables(QString schema, QStringList names);
+  QMap<QString, QString> tableVersions(QString schema);
 
   // Fonctions propres
   static bool pgCatalogHidden;
   static bool informationSchemaHidden;
 
+  static const int CopyChunkSize = 256 * 1024;
+
 signals:
 
 public slots:
@@ -5,11 +5,19 @@ VERSION=0.8
 INCLUDEPATH+=../../../src/plugins
 TARGET=sqlitewrapper
 HEADERS += \
+    ../../querycanceler.h \
     sqlitewrapper.h
 
 SOURCES += \
+    ../../querycanceler.cpp \
     sqlitewrapper.cpp
 
+# sqlite3_interrupt(), Qt must use the system SQLite (qmake CONFIG+=sqlite3)
+sqlite3 {
+    DEFINES += HAVE_SQLITE3
+    LIBS += -lsqlite3
+}
+
 # ##
 # MS Windows
 win32: {
@@ -5,6 +5,33 @@
 #include <QSqlQuery>
 #include <QVariant>
 
+#ifdef HAVE_SQLITE3
+#include <sqlite3.h>
+#endif
+
+#ifdef HAVE_SQLITE3
+/**
+ * sqlite3_interrupt() is safe from any thread while the handle is open, which
+ * the release of the canceler guarantees.
+ */
+class SqliteCanceler : public QueryCanceler {
+public:
+  SqliteCanceler(sqlite3 *handle) {
+    this->handle = handle;
+  }
+
+protected:
+  bool sendCancel(QString *errorString) {
+    Q_UNUSED(errorString);
+    sqlite3_interrupt(handle);
+    return true;
+  }
+
+private:
+  sqlite3 *handle;
+};
+#endif
+
 SqliteWrapper::SqliteWrapper(QObject *parent)
   : QObject(parent) {
 }
@@ -14,6 +41,40 @@ SqliteWrapper::SqliteWrapper(QSqlDatabase *db)
   m_db = db;
 }
 
+QString SqliteWrapper::catalogVersion() {
+  if (!m_db) {
+    return "";
+  }
+
+  QSqlQuery query(*m_db);
+  if (!query.exec("PRAGMA schema_version") || !query.next()) {
+    qDebug() << query.lastError().text();
+    return "";
+  }
+
+  return query.value(0).toString();
+}
+
+/**
+ * Only with the SQLite library Qt is linked to (qmake CONFIG+=sqlite3) : the
+ * driver's handle is then a sqlite3*.
+ */
+QueryCanceler* SqliteWrapper::canceler(QSqlDatabase *connection) {
+#ifdef HAVE_SQLITE3
+  QVariant v = connection->driver()->handle();
+  if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
+    sqlite3 *handle = *static_cast<sqlite3 **>(v.data());
+    if (handle) {
+      return new SqliteCanceler(handle);
+    }
+  }
+#else
+  Q_UNUSED(connection);
+#endif
+
+  return NULL;
+}
+
 QList<SqlColumn> SqliteWrapper::columns(QString table) {
   QList<SqlColumn> cols;
 
@@ -31,7 +92,7 @@ QList<SqlColumn> SqliteWrapper::columns(QString table) {
   while (query.next()) {
     c.name = query.value(1).toString();
     c.type.name = query.value(2).toString();
-    c.permitsNull = query.value(3).toBool();
+    c.permitsNull = !query.value(3).toBool();
     c.defaultValue = query.value(4);
     c.primaryKey = query.value(5).toBool();
 
@@ -67,7 +128,7 @@ SqlTable SqliteWrapper::table(QString t) {
   while (query.next()) {
     c.name = query.value(1).toString();
     c.type.name = query.value(2).toString();
-    c.permitsNull = query.value(3).toBool();
+    c.permitsNull = !query.value(3).toBool();
     c.defaultValue = query.value(4);
     c.primaryKey = query.value(5).toBool();
 
@@ -77,7 +138,45 @@ SqlTable SqliteWrapper::table(QString t) {
   return table;
 }
 
+/**
+ * Tables without their columns, straight from sqlite_master.
+ */
+QList<SqlTable> SqliteWrapper::tableList(QString schema) {
+  QList<SqlTable> tables;
+
+  if (!m_db) {
+    return tables;
+  }
+
+  QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
+  if (!query.exec("SELECT name, type FROM sqlite_master "
+                  "WHERE type in ('table', 'view') ORDER BY name")) {
+    qDebug() << query.lastError().text();
+    return tables;
+  }
+
+  while (query.next()) {
+    SqlTable t;
+    t.name = query.value(0).toString();
+    t.type = query.value(1).toString() == "table" ? Table : ViewTable;
+    t.columnCount = 0;
+    tables << t;
+  }
+
+  return tables;
+}
+
 QList<SqlTable> SqliteWrapper::tables() {
+  return tables("", QStringList());
+}
+
+/**
+ * Loads the tables with their columns in one query, joining sqlite_master with
+ * pragma_table_info(). SQLite versions older than 3.16 do not have the
+ * table-valued pragmas : the columns are then read table by table.
+ */
+QList<SqlTable> SqliteWrapper::tables(QString schema, QStringList names) {
   QList<SqlTable> tables;
 
   if (!m_db) {
@@ -86,8 +185,64 @@ QList<SqlTable> SqliteWrapper::tables() {
 
   QString sql;
 
+  sql += "SELECT m.name, m.type, p.name, p.type, p.\"notnull\", ";
+  sql += "p.dflt_value, p.pk ";
+  sql += "FROM sqlite_master m ";
+  sql +=   "LEFT JOIN pragma_table_info(m.name) p ";
+  sql += "WHERE m.type in ('table', 'view') ";
+  if (!names.isEmpty()) {
+    sql += "AND m.name IN (" + sqlList(names) + ") ";
+  }
+  sql += "ORDER BY m.name, p.cid ";
+
+  QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
+  if (!query.exec(sql)) {
+    qDebug() << query.lastError().text();
+    return tablesByPragma(names);
+  }
+
+  while (query.next()) {
+    QString name = query.value(0).toString();
+    if (tables.isEmpty() || tables.last().name != name) {
+      SqlTable t;
+      t.name = name;
+      t.type = query.value(1).toString() == "table" ? Table : ViewTable;
+      t.columnCount = 0;
+      tables << t;
+    }
+
+    if (query.isNull(2)) {
+      continue;
+    }
+
+    SqlColumn c;
+    c.name = query.value(2).toString();
+    c.type.name = query.value(3).toString();
+    c.permitsNull = !query.value(4).toBool();
+    c.defaultValue = query.value(5);
+    c.primaryKey = query.value(6).toBool();
+
+    tables.last().columns << c;
+    tables.last().columnCount++;
+  }
+
+  return tables;
+}
+
+/**
+ * Loads the tables with one PRAGMA TABLE_INFO per table.
+ */
+QList<SqlTable> SqliteWrapper::tablesByPragma(QStringList names) {
+  QList<SqlTable> tables;
+
+  QString sql;
+
   sql += "SELECT name, type FROM sqlite_master ";
   sql += "WHERE type in ('table', 'view') ";
+  if (!names.isEmpty()) {
+    sql += "AND name IN (" + sqlList(names) + ") ";
+  }
   sql += "ORDER BY name ";
 
   QSqlQuery query(*m_db);
@@ -101,9 +256,35 @@ QList<SqlTable> SqliteWrapper::tables() {
     t.name = query.value(0).toString();
     t.type = query.value(1).toString() == "table" ? Table : ViewTable;
     t.columns = columns(t.name);
+    t.columnCount = t.columns.size();
     tables << t;
   }
 
   return tables;
 }
 
+/**
+ * The version of a table is its CREATE statement, which SQLite rewrites on
+ * every ALTER TABLE.
+ */
+QMap<QString, QString> SqliteWrapper::tableVersions(QString schema) {
+  QMap<QString, QString> versions;
+
+  if (!m_db) {
+    return versions;
+  }
+
+  QSqlQuery query(*m_db);
+  query.setForwardOnly(true);
+  if (!query.exec("SELECT name, sql FROM sqlite_master "
+                  "WHERE type in ('table', 'view')")) {
+    qDebug() << query.lastError().text();
+    return versions;
+  }
+
+  while (query.next()) {
+    versions[query.value(0).toString()] = query.value(1).toString();
+  }
+
+  return versions;
+}
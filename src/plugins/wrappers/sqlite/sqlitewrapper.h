@@ -20,6 +20,8 @@ public:
   QString version() { return QCoreApplication::applicationVersion(); };
 
   // Fonctions de SqlWrapper
+  QueryCanceler* canceler(QSqlDatabase *connection);
+  QString catalogVersion();
   QList<SqlColumn> columns(QString table);
   QString driver() { return "QSQLITE"; };
   WrapperFeatures features();
@@ -28,12 +30,17 @@ public:
   SqlWrapper *newInstance(QSqlDatabase *db);
   bool requiresHostname() { return false; };
   SqlTable table(QString t);
+  QList<SqlTable> tableList(QString schema);
   QList<SqlTable> tables();
+  QList<SqlTable> tables(QString schema, QStringList names);
+  QMap<QString, QString> tableVersions(QString schema);
 
 signals:
 
 public slots:
 
+private:
+  QList<SqlTable> tablesByPragma(QStringList names);
 };
 
 #endif // SQLITEWRAPPER_H
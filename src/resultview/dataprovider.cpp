@@ -1 +1,50 @@
 #include "dataprovider.h"
+
+#include <QSqlQueryModel>
+
+void DataProvider::cancel() {
+  emit error();
+  emit complete();
+}
+
+bool DataProvider::canFetchMore() {
+  return model()->canFetchMore(QModelIndex());
+}
+
+int DataProvider::columnCount() {
+  return model()->columnCount();
+}
+
+QString DataProvider::columnName(int column) {
+  return model()->headerData(column, Qt::Horizontal).toString();
+}
+
+QVariant DataProvider::data(int row, int column) {
+  return model()->index(row, column).data();
+}
+
+void DataProvider::fetchMore() {
+  model()->fetchMore(QModelIndex());
+  emit rowsFetched(rowCount());
+}
+
+QSqlRecord DataProvider::record(int row) {
+  QSqlQueryModel *m = qobject_cast<QSqlQueryModel*>(model());
+  if (m) {
+    return m->record(row);
+  }
+
+  return QSqlRecord();
+}
+
+int DataProvider::rowCount() {
+  return model()->rowCount();
+}
+
+void DataProvider::setLazy(bool lazy) {
+  Q_UNUSED(lazy);
+}
+
+void DataProvider::stop() {
+  requestInterruption();
+}
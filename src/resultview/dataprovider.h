@@ -1,24 +1,78 @@
 #ifndef DATAPROVIDER_H
 #define DATAPROVIDER_H
 
+#include <QAbstractItemModel>
+#include <QSqlDatabase>
 #include <QSqlError>
-#include <QSqlQueryModel>
+#include <QSqlRecord>
 #include <QThread>
 
 class DataProvider : public QThread {
   Q_OBJECT
 public:
-  virtual QSqlQueryModel* model() =0;
+  virtual QAbstractItemModel* model() =0;
 
+  virtual QSqlDatabase database() =0;
+  /**
+   * Whether stop() cancels the running statement on the server. Otherwise it
+   * only takes effect once the statement returns.
+   */
+  virtual bool isCancelable() { return false; };
   virtual bool isReadOnly() =0;
+  /**
+   * Whether query() can run again on another connection with the same result
+   * and no side effect. Otherwise the rows held must be used.
+   */
+  virtual bool isRepeatable() { return true; };
   virtual QSqlError lastError() =0;
+  /**
+   * The select statement returning the provider's rows, used to read them
+   * again on another connection (e.g. for exports).
+   */
+  virtual QString query() =0;
+  /**
+   * The table the rows come from, empty for queries.
+   */
+  virtual QString table() { return ""; };
+
+  /**
+   * Called when the run is dropped from the QueryScheduler's queue before it
+   * started : reports the end through error() and complete().
+   */
+  virtual void cancel();
+
+  /*
+   * Row access. The default implementations read the model, providers that
+   * don't rely on a QSqlQueryModel should override them.
+   */
+  virtual bool canFetchMore();
+  virtual int columnCount();
+  virtual QString columnName(int column);
+  virtual QVariant data(int row, int column);
+  virtual void fetchMore();
+  virtual QSqlRecord record(int row);
+  virtual int rowCount();
+
+  /**
+   * In lazy mode, rows are only fetched when fetchMore() is called instead of
+   * reading the whole result at once.
+   */
+  virtual void setLazy(bool lazy);
 
 signals:
   void complete();
   void error();
+  /**
+   * Emitted each time new rows are available, with the total row count.
+   */
+  void rowsFetched(int count);
   void success();
 
 public slots:
+  /**
+   * Asks the running query to stop.
+   */
+  virtual void stop();
 
 protected:
   virtual void run() =0;
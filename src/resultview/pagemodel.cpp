@@ -0,0 +1,173 @@
+#include "pagemodel.h"
+
+#include <QSet>
+
+PageModel::PageModel(QObject *parent)
+  : QAbstractTableModel(parent) {
+  provider = 0;
+  showInsertRow = false;
+  m_count = 0;
+  m_rows = 0;
+  m_start = 0;
+}
+
+bool PageModel::canFetchMore(const QModelIndex &parent) const {
+  if (parent.isValid() || !provider || m_rows >= m_count) {
+    return false;
+  }
+
+  return provider->canFetchMore();
+}
+
+void PageModel::clearModifications() {
+  overlay.clear();
+  refresh();
+}
+
+int PageModel::columnCount(const QModelIndex &parent) const {
+  if (parent.isValid() || !provider) {
+    return 0;
+  }
+
+  return provider->columnCount();
+}
+
+QVariant PageModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || !provider
+      || (role != Qt::DisplayRole && role != Qt::EditRole)) {
+    return QVariant();
+  }
+
+  Cell cell(sourceRow(index.row()), index.column());
+  QHash<Cell, QVariant>::const_iterator it = overlay.constFind(cell);
+  if (it != overlay.constEnd()) {
+    return it.value();
+  }
+
+  return provider->data(cell.first, cell.second);
+}
+
+void PageModel::fetchMore(const QModelIndex &parent) {
+  if (!parent.isValid() && provider) {
+    provider->fetchMore();
+  }
+}
+
+Qt::ItemFlags PageModel::flags(const QModelIndex &index) const {
+  Qt::ItemFlags f = QAbstractTableModel::flags(index);
+  if (provider && !provider->isReadOnly()) {
+    f |= Qt::ItemIsEditable;
+  }
+  return f;
+}
+
+QVariant PageModel::headerData(int section, Qt::Orientation orientation,
+                               int role) const {
+  if (role != Qt::DisplayRole || !provider) {
+    return QVariant();
+  }
+
+  if (orientation == Qt::Horizontal) {
+    return provider->columnName(section);
+  }
+
+  if (showInsertRow && sourceRow(section) == provider->rowCount() - 1) {
+    return "*";
+  }
+
+  return QString::number(sourceRow(section) + 1);
+}
+
+/**
+ * Returns the provider's record for the given row, edited cells applied.
+ */
+QSqlRecord PageModel::modifiedRecord(int sourceRow) const {
+  QSqlRecord record = provider->record(sourceRow);
+
+  QHash<Cell, QVariant>::const_iterator it;
+  for (it = overlay.constBegin(); it != overlay.constEnd(); ++it) {
+    if (it.key().first == sourceRow) {
+      record.setValue(it.key().second, it.value());
+    }
+  }
+
+  return record;
+}
+
+QList<int> PageModel::modifiedRows() const {
+  QSet<int> rows;
+  foreach (Cell c, overlay.keys()) {
+    rows << c.first;
+  }
+
+  QList<int> ret = rows.toList();
+  qSort(ret);
+  return ret;
+}
+
+/**
+ * Recomputes the window size, e.g. after the provider fetched new rows. Rows
+ * appended at the end of the window are inserted without resetting the model.
+ */
+void PageModel::refresh() {
+  int rows = provider ? qBound(0, provider->rowCount() - m_start, m_count) : 0;
+
+  if (rows > m_rows) {
+    beginInsertRows(QModelIndex(), m_rows, rows - 1);
+    m_rows = rows;
+    endInsertRows();
+  } else if (rows < m_rows) {
+    setWindow(m_start, m_count);
+  }
+}
+
+int PageModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid()) {
+    return 0;
+  }
+
+  return m_rows;
+}
+
+bool PageModel::setData(const QModelIndex &index, const QVariant &value,
+                        int role) {
+  if (!index.isValid() || role != Qt::EditRole || !provider
+      || provider->isReadOnly()) {
+    return false;
+  }
+
+  overlay[Cell(sourceRow(index.row()), index.column())] = value;
+
+  emit dataChanged(index, index);
+  emit edited();
+  return true;
+}
+
+void PageModel::setDataProvider(DataProvider *provider) {
+  beginResetModel();
+  this->provider = provider;
+  overlay.clear();
+  m_rows = 0;
+  m_start = 0;
+  endResetModel();
+}
+
+void PageModel::setInsertRow(bool show) {
+  showInsertRow = show;
+}
+
+/**
+ * Moves the window.
+ *
+ * @param start
+ *    index of the first source row
+ * @param count
+ *    maximum number of rows to show
+ */
+void PageModel::setWindow(int start, int count) {
+  beginResetModel();
+  m_start = start;
+  m_count = count;
+  m_rows = provider ? qBound(0, provider->rowCount() - start, count) : 0;
+  endResetModel();
+}
@@ -0,0 +1,62 @@
+#ifndef PAGEMODEL_H
+#define PAGEMODEL_H
+
+#include "dataprovider.h"
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QPair>
+
+/**
+ * Table model showing a window (a page) over the rows of a DataProvider.
+ *
+ * Nothing is copied : data() reads the provider directly, and edited cells
+ * are kept in a sparse overlay until they are committed or reverted.
+ * Changing the page only resets the model, the view then asks for the
+ * visible cells. A window reaching the end of the provider's rows forwards
+ * canFetchMore()/fetchMore() to it, which is how the continuous scroll mode
+ * loads rows while the scrollbar moves down.
+ */
+class PageModel : public QAbstractTableModel {
+Q_OBJECT
+public:
+  typedef QPair<int, int> Cell;
+
+  explicit PageModel(QObject *parent = 0);
+
+  bool canFetchMore(const QModelIndex &parent) const;
+  void clearModifications();
+  int columnCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  void fetchMore(const QModelIndex &parent);
+  Qt::ItemFlags flags(const QModelIndex &index) const;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const;
+  bool isModified() const { return !overlay.isEmpty(); };
+  QSqlRecord modifiedRecord(int sourceRow) const;
+  QList<int> modifiedRows() const;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  bool setData(const QModelIndex &index, const QVariant &value,
+               int role = Qt::EditRole);
+  void setDataProvider(DataProvider *provider);
+  void setInsertRow(bool show);
+  void setWindow(int start, int count);
+  int sourceRow(int row) const { return m_start + row; };
+  int start() const { return m_start; };
+
+signals:
+  void edited();
+
+public slots:
+  void refresh();
+
+private:
+  DataProvider *provider;
+  QHash<Cell, QVariant> overlay;
+  bool showInsertRow;
+  int m_count;
+  int m_rows;
+  int m_start;
+};
+
+#endif // PAGEMODEL_H
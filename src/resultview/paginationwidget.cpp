@@ -39,12 +39,27 @@ void PaginationWidget::setPage(int page, int pageCount) {
   lastPageButton->setEnabled(page < pageCount);
 
   pageLabel->setText(genPageCount(page, pageCount));
+  resultSpinBox->setEnabled(true);
 }
 
 void PaginationWidget::setReloadEnabled(bool enable) {
   reloadButton->setEnabled(enable);
 }
 
+/**
+ * Used in continuous mode : shows the number of fetched rows instead of the
+ * page number.
+ */
+void PaginationWidget::setRowCount(int rows) {
+  firstPageButton->setEnabled(false);
+  prevPageButton->setEnabled(false);
+  nextPageButton->setEnabled(false);
+  lastPageButton->setEnabled(false);
+  resultSpinBox->setEnabled(false);
+
+  pageLabel->setText(tr("%1 rows").arg(rows));
+}
+
 void PaginationWidget::setRowsPerPage(int rows) {
   resultSpinBox->setValue(rows);
 }
@@ -54,6 +69,8 @@ void PaginationWidget::setupConnections() {
   connect(prevPageButton, SIGNAL(clicked()), this, SIGNAL(previous()));
   connect(nextPageButton, SIGNAL(clicked()), this, SIGNAL(next()));
   connect(lastPageButton, SIGNAL(clicked()), this, SIGNAL(last()));
+  connect(continuousButton, SIGNAL(toggled(bool)),
+          this, SIGNAL(continuousChanged(bool)));
   connect(reloadButton, SIGNAL(clicked()), this, SIGNAL(reload()));
   connect(resultSpinBox, SIGNAL(valueChanged(int)),
           this, SIGNAL(rowsPerPageChanged(int)));
@@ -92,6 +109,11 @@ void PaginationWidget::setupWidgets() {
   lastPageButton = genButton(tr("Last page"), "go-last");
   layout->addWidget(lastPageButton);
 
+  continuousButton = genButton(tr("Continuous scroll"), "go-down");
+  continuousButton->setCheckable(true);
+  continuousButton->setEnabled(true);
+  layout->addWidget(continuousButton);
+
   layout->addSpacing(10);
 
   reloadButton = genButton(tr("Reload"), "view-refresh");
@@ -14,9 +14,11 @@ public:
 
   void setPage(int page, int pageCount);
   void setReloadEnabled(bool enable);
+  void setRowCount(int rows);
   void setRowsPerPage(int rows);
 
 signals:
+  void continuousChanged(bool);
   void first();
   void last();
   void next();
@@ -45,6 +47,8 @@ private:
   QToolButton* nextPageButton;
   QToolButton* lastPageButton;
 
+  QToolButton* continuousButton;
+
   QToolButton* reloadButton;
 
   QSpinBox* resultSpinBox;
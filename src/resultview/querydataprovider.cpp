@@ -1,33 +1,416 @@
 #include "querydataprovider.h"
 
 #include "tools/logger.h"
+#include "tools/sqllexer.h"
 
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+/**
+ * Whether each statement only reads : a SELECT, or a WITH, holding no INSERT,
+ * UPDATE, DELETE, MERGE nor INTO outside strings and comments.
+ */
+static bool isReadOnlyStatement(const QString &query) {
+  // every word is an identifier
+  SqlLexer lexer((QStringList()), QStringList(), QStringList());
+  QVector<SqlToken> tokens;
+  int state = SqlLexer::Normal;
+  bool first = true;
+
+  foreach (QString line, query.split('\n')) {
+    state = lexer.tokenize(line, state, tokens);
+    foreach (const SqlToken &t, tokens) {
+      if (t.type == SqlToken::Comment || t.type == SqlToken::String) {
+        continue;
+      }
+
+      QString word = line.mid(t.position, t.length).toUpper();
+      if (first) {
+        if (word != "SELECT" && word != "WITH" && word != "(") {
+          return false;
+        }
+        first = word == "(";
+      } else if (word == ";") {
+        first = true;
+      } else if (word == "INSERT" || word == "UPDATE" || word == "DELETE"
+                 || word == "MERGE" || word == "INTO") {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
 
 QueryDataProvider::QueryDataProvider(QObject *parent) {
-  m_model = new QSqlQueryModel();
+  m_model = new QueryResultModel(this);
+  pendingReset = false;
+  fetchLimit = 0;
+  lazy = false;
+  queuedRows = 0;
+  m_timeout = 0;
+  serverTimeout = false;
+  timedOut = false;
+  wrapper = NULL;
+
+  connect(this, SIGNAL(rowsQueued()), this, SLOT(publishRows()),
+          Qt::QueuedConnection);
+
+  // the timer lives in the GUI thread, the signals of the worker are queued
+  timeoutTimer = new QTimer(this);
+  timeoutTimer->setSingleShot(true);
+  connect(timeoutTimer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+  connect(this, SIGNAL(started()), this, SLOT(onStarted()));
+  connect(this, SIGNAL(success()), timeoutTimer, SLOT(stop()));
+  connect(this, SIGNAL(finished()), timeoutTimer, SLOT(stop()));
 
   setParent(parent);
 }
 
-QSqlError QueryDataProvider::lastError() {
-  return m_model->lastError();
+QueryDataProvider::~QueryDataProvider() {
+  stop();
+  wait();
 }
 
-void QueryDataProvider::run() {
-  m_model->setQuery(query, db);
-  qDebug() << query;
+void QueryDataProvider::cancel() {
+  m_error = QSqlError(tr("Query canceled"), "", QSqlError::UnknownError);
+  DataProvider::cancel();
+}
+
+bool QueryDataProvider::canFetchMore() {
+  QMutexLocker locker(&pendingMutex);
+  return lazy && isRunning() && fetchLimit - queuedRows < LazyFetchSize;
+}
+
+int QueryDataProvider::columnCount() {
+  return m_model->columnCount();
+}
+
+QString QueryDataProvider::columnName(int column) {
+  return m_model->record().fieldName(column);
+}
+
+QVariant QueryDataProvider::data(int row, int column) {
+  return m_model->value(row, column);
+}
+
+/**
+ * Runs the query and streams its rows. Called from the worker thread.
+ */
+void QueryDataProvider::execute(QSqlDatabase &connection) {
+  QSqlQuery q(connection);
+  q.setForwardOnly(true);
+
+  QVector<QVariant> values;
+
+  // stopped before the canceler was armed
+  if (isInterruptionRequested()) {
+    m_error = QSqlError(tr("Query canceled"), "", QSqlError::UnknownError);
+  } else if (!q.exec(m_query)) {
+    m_error = q.lastError();
+
+    QMutexLocker locker(&cancelMutex);
+    if (timedOut) {
+      m_error = QSqlError(tr("Query canceled : it ran for more than %1 s")
+                          .arg(m_timeout / 1000.0), m_error.databaseText(),
+                          m_error.type());
+    }
+  }
+
+  if (m_error.type() != QSqlError::NoError) {
+    queueRows(values, true);
+    Logger::instance->logError(m_error.text());
+    emit error();
+    emit complete();
+    return;
+  }
+
+  QSqlRecord rec = q.record();
+  int cols = rec.count();
+  queueRows(values, true, rec);
 
-  if (m_model->lastError().type() == QSqlError::NoError) {
-    emit success();
+  bool first = true;
+  int chunkSize = FirstChunkSize;
+  int chunkRows = 0;
+  QElapsedTimer timer;
+  timer.start();
+
+  while (cols > 0 && !isInterruptionRequested() && q.next()) {
+    for (int i=0; i<cols; i++) {
+      values << q.value(i);
+    }
+    chunkRows++;
+
+    if (chunkRows >= chunkSize || timer.elapsed() >= PublishInterval) {
+      bool lazyMode = queueRows(values);
+      chunkRows = 0;
+      chunkSize = qMin(chunkSize * 2,
+                       lazyMode ? (int) LazyFetchSize : (int) MaxChunkSize);
+      timer.restart();
+
+      // the first page is available, the query is known to be valid
+      if (first) {
+        first = false;
+        emit success();
+      }
+    }
+  }
+
+  if (q.lastError().type() != QSqlError::NoError) {
+    m_error = q.lastError();
+  }
+
+  queueRows(values);
+
+  if (m_error.type() == QSqlError::NoError) {
+    if (first) {
+      emit success();
+    }
   } else {
-    Logger::instance->logError(lastError().text());
+    Logger::instance->logError(m_error.text());
     emit error();
   }
   emit complete();
 }
 
-void QueryDataProvider::setQuery(QString query, QSqlDatabase db) {
+/**
+ * Asks the worker for LazyFetchSize more rows.
+ */
+void QueryDataProvider::fetchMore() {
+  QMutexLocker locker(&pendingMutex);
+  fetchLimit = queuedRows + LazyFetchSize;
+  fetchCondition.wakeAll();
+}
+
+QSqlError QueryDataProvider::lastError() {
+  return m_error;
+}
+
+/**
+ * Moves the queued rows into the model. Runs in the GUI thread.
+ */
+void QueryDataProvider::publishRows() {
+  QVector<QVariant> values;
+  QSqlRecord record;
+  bool reset;
+
+  {
+    QMutexLocker locker(&pendingMutex);
+    values = pendingValues;
+    pendingValues.clear();
+    record = pendingRecord;
+    reset = pendingReset;
+    pendingReset = false;
+  }
+
+  if (reset) {
+    m_model->setRecord(record);
+  }
+
+  m_model->appendRows(values);
+
+  emit rowsFetched(m_model->rowCount());
+}
+
+/**
+ * Hands a chunk over to the GUI thread. Called from the worker thread, which
+ * is then suspended while the lazy fetch limit is reached.
+ */
+bool QueryDataProvider::queueRows(QVector<QVariant> &values, bool reset,
+                                  QSqlRecord record) {
+  QMutexLocker locker(&pendingMutex);
+  if (reset) {
+    pendingReset = true;
+    pendingRecord = record;
+    pendingValues.clear();
+    queuedRows = 0;
+    fetchLimit = LazyFetchSize;
+  }
+
+  if (pendingRecord.count() > 0) {
+    queuedRows += values.size() / pendingRecord.count();
+  }
+  pendingValues += values;
+  values.clear();
+
+  emit rowsQueued();
+
+  while (lazy && queuedRows >= fetchLimit && !isInterruptionRequested()) {
+    fetchCondition.wait(&pendingMutex);
+  }
+
+  return lazy;
+}
+
+bool QueryDataProvider::isCancelable() {
+  QMutexLocker locker(&cancelMutex);
+  return !canceler.isNull();
+}
+
+/**
+ * Only a read-only statement outside a transaction is run again, e.g. by an
+ * export : a DML statement would be applied twice, and another connection
+ * can't see the uncommitted rows of the transaction.
+ */
+bool QueryDataProvider::isRepeatable() {
+  return pool && isReadOnlyStatement(m_query);
+}
+
+void QueryDataProvider::onStarted() {
+  if (m_timeout > 0) {
+    timeoutTimer->start();
+  }
+}
+
+/**
+ * The client-side limit : the server didn't stop the query in time, or can't
+ * limit it.
+ */
+void QueryDataProvider::onTimeout() {
+  if (!isRunning()) {
+    return;
+  }
+
+  {
+    QMutexLocker locker(&cancelMutex);
+    timedOut = true;
+  }
+
+  Logger::instance->logError(tr("Canceling the query : it ran for more "
+                                "than %1 s").arg(m_timeout / 1000.0));
+  stop();
+}
+
+/**
+ * Sets the timeout of the worker connection and arms its canceler. Called from
+ * the worker thread, before the statement.
+ */
+void QueryDataProvider::prepare(QSqlDatabase &connection) {
+  serverTimeout = false;
+  if (!wrapper) {
+    return;
+  }
+
+  if (m_timeout > 0) {
+    serverTimeout = wrapper->setStatementTimeout(&connection, m_timeout);
+  }
+
+  QSharedPointer<QueryCanceler> c(wrapper->canceler(&connection));
+  QMutexLocker locker(&cancelMutex);
+  canceler = c;
+}
+
+QSqlRecord QueryDataProvider::record(int row) {
+  return m_model->record(row);
+}
+
+/**
+ * Disarms the canceler, then resets the timeout : the connection is ready for
+ * another statement. Called from the worker thread.
+ */
+void QueryDataProvider::release(QSqlDatabase &connection) {
+  QSharedPointer<QueryCanceler> c;
+  {
+    QMutexLocker locker(&cancelMutex);
+    c = canceler;
+    canceler.clear();
+  }
+
+  // waits for a request being sent
+  if (c) {
+    c->release();
+  }
+
+  if (serverTimeout) {
+    wrapper->setStatementTimeout(&connection, 0);
+    serverTimeout = false;
+  }
+}
+
+int QueryDataProvider::rowCount() {
+  return m_model->rowCount();
+}
+
+void QueryDataProvider::run() {
+  qDebug() << m_query;
+
+  m_error = QSqlError();
+  {
+    QMutexLocker locker(&cancelMutex);
+    timedOut = false;
+  }
+
+  // a worker connection, unless the query belongs to a transaction
+  QSqlDatabase connection = db;
+  if (pool) {
+    connection = pool->checkout(&m_error);
+    if (!connection.isValid()) {
+      QVector<QVariant> values;
+      queueRows(values, true);
+      Logger::instance->logError(m_error.text());
+      emit error();
+      emit complete();
+      return;
+    }
+  }
+
+  prepare(connection);
+  execute(connection);
+  release(connection);
+
+  if (pool) {
+    pool->checkin(connection);
+  }
+}
+
+void QueryDataProvider::setLazy(bool lazy) {
+  QMutexLocker locker(&pendingMutex);
+  this->lazy = lazy;
+  fetchCondition.wakeAll();
+}
+
+/**
+ * @param pool
+ *    pool of the connection, the query then runs on a worker connection. NULL
+ *    to run it on db itself, e.g. inside a transaction.
+ */
+void QueryDataProvider::setQuery(QString query, QSqlDatabase db,
+                                 ConnectionPool *pool) {
   this->db = db;
-  this->query = query;
+  this->m_query = query;
+  this->pool = pool;
+}
+
+/**
+ * @param msecs
+ *    longest run allowed to the query, 0 for no limit. Enforced by the server
+ *    if the wrapper supports it, and by the provider TimeoutGrace later.
+ */
+void QueryDataProvider::setTimeout(int msecs) {
+  m_timeout = qMax(0, msecs);
+  timeoutTimer->setInterval(m_timeout + TimeoutGrace);
+}
+
+/**
+ * The wrapper of the connection, used to cancel the statement and to set its
+ * timeout. NULL if there is none.
+ */
+void QueryDataProvider::setWrapper(SqlWrapper *wrapper) {
+  this->wrapper = wrapper;
+}
+
+/**
+ * Also sends the cancel request to the server, from another thread.
+ */
+void QueryDataProvider::stop() {
+  requestInterruption();
+
+  {
+    QMutexLocker locker(&cancelMutex);
+    QueryCanceler::cancelLater(canceler);
+  }
+
+  QMutexLocker locker(&pendingMutex);
+  fetchCondition.wakeAll();
 }
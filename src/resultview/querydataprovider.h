@@ -2,32 +2,110 @@
 #define QUERYDATAPROVIDER_H
 
 #include "dataprovider.h"
+#include "db/connectionpool.h"
+#include "plugins/sqlwrapper.h"
+#include "queryresultmodel.h"
 
+#include <QMutex>
+#include <QPointer>
+#include <QSharedPointer>
 #include <QSqlQuery>
+#include <QTimer>
+#include <QWaitCondition>
 
+/**
+ * Runs a query on a forward-only cursor and streams its rows by chunks.
+ *
+ * The worker thread never touches the model : fetched rows are queued and
+ * published from the GUI thread, so the first page shows up as soon as the
+ * first chunk arrives.
+ *
+ * In lazy mode, the worker stops reading once fetchMore() limit is reached and
+ * waits for the view to ask for more rows. The cursor stays open meanwhile.
+ *
+ * With a wrapper, stop() also cancels the statement on the server, and the
+ * timeout is enforced by the server. A timer stops the query anyway a little
+ * after the timeout, for the DBMS that can't limit it themselves.
+ */
 class QueryDataProvider : public DataProvider {
 Q_OBJECT
 public:
   explicit QueryDataProvider(QObject *parent = 0);
+  ~QueryDataProvider();
 
+  QSqlDatabase database() { return db; };
+  bool isCancelable();
   bool isReadOnly() { return true; };
+  bool isRepeatable();
   QSqlError lastError();
-  QSqlQueryModel* model() { return m_model; };
+  QAbstractItemModel* model() { return m_model; };
+  QString query() { return m_query; };
 
-  void setQuery(QString query, QSqlDatabase db);
+  void cancel();
+  bool canFetchMore();
+  int columnCount();
+  QString columnName(int column);
+  QVariant data(int row, int column);
+  void fetchMore();
+  QSqlRecord record(int row);
+  int rowCount();
+  void setLazy(bool lazy);
+
+  void setQuery(QString query, QSqlDatabase db, ConnectionPool *pool = 0);
+  void setTimeout(int msecs);
+  void setWrapper(SqlWrapper *wrapper);
+  int timeout() { return m_timeout; };
+
+  static const int FirstChunkSize = 256;
+  static const int LazyFetchSize = 1024;
+  static const int MaxChunkSize = 16384;
+  static const int PublishInterval = 200;
+  static const int TimeoutGrace = 1000;
 
 signals:
+  void rowsQueued();
 
 public slots:
+  void stop();
 
 protected:
   void run();
 
 private:
+  void execute(QSqlDatabase &connection);
+  void prepare(QSqlDatabase &connection);
+  void release(QSqlDatabase &connection);
+  bool queueRows(QVector<QVariant> &values, bool reset =false,
+                 QSqlRecord record =QSqlRecord());
+
   QSqlDatabase db;
-  QSqlQueryModel* m_model;
-  QString query;
+  QSqlError m_error;
+  QPointer<ConnectionPool> pool;
+  QueryResultModel* m_model;
+  QString m_query;
+
+  QMutex cancelMutex;
+  QSharedPointer<QueryCanceler> canceler;
+  int m_timeout;
+  bool serverTimeout;
+  bool timedOut;
+  QTimer *timeoutTimer;
+  SqlWrapper *wrapper;
+
+  QWaitCondition fetchCondition;
+  int fetchLimit;
+  bool lazy;
+  int queuedRows;
+
+  QMutex pendingMutex;
+  QSqlRecord pendingRecord;
+  bool pendingReset;
+  QVector<QVariant> pendingValues;
 
+private slots:
+  void onStarted();
+  void onTimeout();
+  void publishRows();
 };
 
 #endif // QUERYDATAPROVIDER_H
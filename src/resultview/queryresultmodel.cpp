@@ -0,0 +1,220 @@
+#include "queryresultmodel.h"
+
+#include "tools/logger.h"
+
+#include <QDataStream>
+
+QueryResultModel::QueryResultModel(QObject *parent)
+  : QAbstractTableModel(parent) {
+  m_cacheSize = DefaultCacheSize;
+  m_rowCount = 0;
+  residentValues = 0;
+  spill = NULL;
+}
+
+QueryResultModel::~QueryResultModel() {
+  delete spill;
+}
+
+/**
+ * Appends rows to the model.
+ *
+ * @param values
+ *    row-major values, its size must be a multiple of columnCount()
+ */
+void QueryResultModel::appendRows(const QVector<QVariant> &values) {
+  int cols = m_record.count();
+  if (cols == 0 || values.size() < cols) {
+    return;
+  }
+
+  int count = values.size() / cols;
+
+  beginInsertRows(QModelIndex(), m_rowCount, m_rowCount + count - 1);
+
+  int blockValues = BlockSize * cols;
+  int pos = 0;
+  while (pos < count * cols) {
+    if (blocks.isEmpty() || blocks.last().size() == blockValues) {
+      blocks << QVector<QVariant>();
+      blocks.last().reserve(blockValues);
+      spillOffsets << -1;
+      touchBlock(blocks.size() - 1);
+    }
+
+    QVector<QVariant> &block = blocks.last();
+    int n = qMin(blockValues - block.size(), count * cols - pos);
+    for (int i=0; i<n; i++) {
+      block << values[pos + i];
+    }
+    pos += n;
+    residentValues += n;
+  }
+
+  m_rowCount += count;
+
+  trimCache();
+
+  endInsertRows();
+}
+
+void QueryResultModel::clear() {
+  beginResetModel();
+  resetBlocks();
+  m_record = QSqlRecord();
+  endResetModel();
+}
+
+int QueryResultModel::columnCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : m_record.count();
+}
+
+QVariant QueryResultModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || role != Qt::DisplayRole) {
+    return QVariant();
+  }
+
+  return value(index.row(), index.column());
+}
+
+QVariant QueryResultModel::headerData(int section, Qt::Orientation orientation,
+                                      int role) const {
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole
+      && section >= 0 && section < m_record.count()) {
+    return m_record.fieldName(section);
+  }
+
+  return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+/**
+ * Reads a spilled block back from the temporary file.
+ */
+void QueryResultModel::loadBlock(int block) const {
+  if (!spill || spillOffsets[block] < 0) {
+    return;
+  }
+
+  spill->seek(spillOffsets[block]);
+  QDataStream in(spill);
+  in >> blocks[block];
+  residentValues += blocks[block].size();
+
+  touchBlock(block);
+  trimCache();
+}
+
+QSqlRecord QueryResultModel::record(int row) const {
+  QSqlRecord r = m_record;
+  if (row < 0 || row >= m_rowCount) {
+    return r;
+  }
+
+  for (int i=0; i<r.count(); i++) {
+    r.setValue(i, value(row, i));
+  }
+  return r;
+}
+
+void QueryResultModel::resetBlocks() {
+  blocks.clear();
+  lru.clear();
+  spillOffsets.clear();
+  residentValues = 0;
+  m_rowCount = 0;
+
+  delete spill;
+  spill = NULL;
+}
+
+int QueryResultModel::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : m_rowCount;
+}
+
+/**
+ * Sets the maximum number of values kept in memory. 0 means no limit.
+ */
+void QueryResultModel::setCacheSize(int values) {
+  m_cacheSize = values;
+  trimCache();
+}
+
+/**
+ * Sets the columns description. Must be called before appending rows.
+ */
+void QueryResultModel::setRecord(const QSqlRecord &record) {
+  beginResetModel();
+  resetBlocks();
+  m_record = record;
+  endResetModel();
+}
+
+/**
+ * Marks a block as the most recently used one.
+ */
+void QueryResultModel::touchBlock(int block) const {
+  if (!lru.isEmpty() && lru.last() == block) {
+    return;
+  }
+
+  lru.removeOne(block);
+  lru << block;
+}
+
+/**
+ * Spills the least recently used blocks until the cache fits its size. The
+ * last block, still being filled, always stays in memory.
+ */
+void QueryResultModel::trimCache() const {
+  if (m_cacheSize <= 0) {
+    return;
+  }
+
+  int i = 0;
+  while (residentValues > m_cacheSize && i < lru.size() - 1) {
+    int block = lru[i];
+    if (block == blocks.size() - 1) {
+      i++;
+      continue;
+    }
+
+    if (spillOffsets[block] < 0) {
+      if (!spill) {
+        spill = new QTemporaryFile();
+        if (!spill->open()) {
+          Logger::instance->logError(tr("Unable to create a temporary file, "
+                                        "the result cache is disabled"));
+          delete spill;
+          spill = NULL;
+          m_cacheSize = 0;
+          return;
+        }
+      }
+
+      spillOffsets[block] = spill->size();
+      spill->seek(spillOffsets[block]);
+      QDataStream out(spill);
+      out << blocks[block];
+    }
+
+    residentValues -= blocks[block].size();
+    blocks[block] = QVector<QVariant>();
+    lru.removeAt(i);
+  }
+}
+
+QVariant QueryResultModel::value(int row, int column) const {
+  int cols = m_record.count();
+  if (row < 0 || row >= m_rowCount || column < 0 || column >= cols) {
+    return QVariant();
+  }
+
+  int block = row / BlockSize;
+  if (blocks[block].isEmpty()) {
+    loadBlock(block);
+  } else {
+    touchBlock(block);
+  }
+
+  return blocks[block].value((row % BlockSize) * cols + column);
+}
@@ -0,0 +1,60 @@
+#ifndef QUERYRESULTMODEL_H
+#define QUERYRESULTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QList>
+#include <QSqlRecord>
+#include <QTemporaryFile>
+#include <QVector>
+
+/**
+ * Read-only model holding the rows fetched by a QueryDataProvider.
+ *
+ * Values are stored row-major in fixed-size blocks instead of one QSqlRecord
+ * per row, so appending a chunk only touches the last block.
+ *
+ * The number of values kept in memory is bounded by cacheSize() : least
+ * recently used blocks are spilled to a temporary file and read back when
+ * they are accessed again.
+ */
+class QueryResultModel : public QAbstractTableModel {
+Q_OBJECT
+public:
+  explicit QueryResultModel(QObject *parent = 0);
+  ~QueryResultModel();
+
+  void appendRows(const QVector<QVariant> &values);
+  int cacheSize() const { return m_cacheSize; };
+  void clear();
+  int columnCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const;
+  QSqlRecord record() const { return m_record; };
+  QSqlRecord record(int row) const;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  void setCacheSize(int values);
+  void setRecord(const QSqlRecord &record);
+  QVariant value(int row, int column) const;
+
+  static const int BlockSize = 1024;
+  static const int DefaultCacheSize = 2 * 1024 * 1024;
+
+private:
+  void loadBlock(int block) const;
+  void resetBlocks();
+  void touchBlock(int block) const;
+  void trimCache() const;
+
+  mutable QList<QVector<QVariant> > blocks;
+  mutable QList<int> lru;
+  mutable int residentValues;
+  mutable QTemporaryFile *spill;
+  mutable QVector<qint64> spillOffsets;
+
+  mutable int m_cacheSize;
+  QSqlRecord m_record;
+  int m_rowCount;
+};
+
+#endif // QUERYRESULTMODEL_H
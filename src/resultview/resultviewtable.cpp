@@ -9,6 +9,8 @@
 #include <QSqlRecord>
 #include <QSqlTableModel>
 
+#include <climits>
+
 ResultViewTable::ResultViewTable(QWidget *parent)
   : QTableView(parent) {
   currentEditedRow = -1;
@@ -21,8 +23,8 @@ ResultViewTable::ResultViewTable(QWidget *parent)
 
   exportWizard = new ExportWizard(this);
 
-  shortModel = new QStandardItemModel(this);
-  setModel(shortModel);
+  pageModel = new PageModel(this);
+  setModel(pageModel);
 
   sqlItemDelegate = new SqlItemDelegate(this);
   setItemDelegate(sqlItemDelegate);
@@ -33,18 +35,19 @@ ResultViewTable::ResultViewTable(QWidget *parent)
 
 void ResultViewTable::commit() {
   showInsertRow = false;
+  pageModel->setInsertRow(false);
 
-  if (modifiedRecords.size() == 0) {
+  if (!pageModel->isModified()) {
     return;
   }
 
   QSqlTableModel *tmodel = (QSqlTableModel*) dataProvider->model();
 
-  foreach (int row, modifiedRecords.keys()) {
-    tmodel->setRecord(row, modifiedRecords[row]);
+  foreach (int row, pageModel->modifiedRows()) {
+    tmodel->setRecord(row, pageModel->modifiedRecord(row));
   }
 
-  modifiedRecords.clear();
+  pageModel->clearModifications();
 
   if (!tmodel->submitAll()) {
     QMessageBox::critical(this, "Error", tmodel->lastError().text());
@@ -109,7 +112,7 @@ void ResultViewTable::copy() {
 void ResultViewTable::deleteRow() {
   QSet<int> rows;
   foreach (QModelIndex i, selectionModel()->selectedIndexes()) {
-    rows << (i.row() + page * rowsPerPage);
+    rows << pageModel->sourceRow(i.row());
   }
 
   foreach (int r, rows) {
@@ -120,24 +123,28 @@ void ResultViewTable::deleteRow() {
   updateView();
 }
 
-int ResultViewTable::endIndex(int start) {
-  int end = start + rowsPerPage;
-  if (end > dataProvider->model()->rowCount()) {
-    end = dataProvider->model()->rowCount();
-  }
-  return end;
-}
-
 void ResultViewTable::exportContent() {
   if (dataProvider == 0) {
      return;
   }
 
-   if (dataProvider->model()->columnCount() == 0 || dataProvider->model()->rowCount() == 0) {
+   if (dataProvider->columnCount() == 0 || dataProvider->rowCount() == 0) {
      return;
    }
 
    exportWizard->setModel(dataProvider->model());
+   exportWizard->setQuery(dataProvider->query(), dataProvider->database());
+   exportWizard->setTable(dataProvider->table());
+
+   // the rows shown are exported, the query isn't run again
+   if (!dataProvider->isRepeatable()) {
+     QList<QSqlRecord> rows;
+     for (int i=0; i<dataProvider->rowCount(); i++) {
+       rows << dataProvider->record(i);
+     }
+     exportWizard->setRows(dataProvider->record(-1), rows);
+   }
+
    exportWizard->exec();
 }
 
@@ -147,19 +154,20 @@ void ResultViewTable::firstPage() {
 }
 
 void ResultViewTable::insertRow() {
-  dataProvider->model()->insertRow(dataProvider->model()->rowCount());
+  dataProvider->model()->insertRow(dataProvider->rowCount());
   showInsertRow = true;
+  pageModel->setInsertRow(true);
   updateView();
   scrollToBottom();
 }
 
 void ResultViewTable::lastPage() {
-  page = (int) dataProvider->model()->rowCount() / rowsPerPage;
+  page = (int) dataProvider->rowCount() / rowsPerPage;
   updateView();
 }
 
 void ResultViewTable::nextPage() {
-  if ((page + 1) * rowsPerPage < dataProvider->model()->rowCount()) {
+  if ((page + 1) * rowsPerPage < dataProvider->rowCount()) {
     page++;
     updateView();
   } else {
@@ -167,6 +175,23 @@ void ResultViewTable::nextPage() {
   }
 }
 
+/**
+ * New rows are streamed by the provider : the current page is only rebuilt
+ * while it isn't full yet. In continuous mode they are appended at the end of
+ * the view.
+ */
+void ResultViewTable::onRowsFetched(int count) {
+  if (continuous) {
+    pageModel->refresh();
+    updatePagination();
+  } else if (pageModel->rowCount() < rowsPerPage
+      && count > pageModel->start() + pageModel->rowCount()) {
+    updateView();
+  } else {
+    updatePagination();
+  }
+}
+
 void ResultViewTable::previousPage() {
   if (page > 0) {
     page--;
@@ -176,16 +201,6 @@ void ResultViewTable::previousPage() {
   }
 }
 
-void ResultViewTable::populateShortModel() {
-  int start = startIndex();
-  int end = endIndex(start);
-
-  for (int i=start; i<end; i++) {
-    shortModel->appendRow(viewRow(i));
-  }
-  updateVerticalLabels(start, end);
-}
-
 void ResultViewTable::resetColumnSizes() {
   columnSizes = QList<int>();
 }
@@ -214,6 +229,8 @@ void ResultViewTable::resizeColumnsToContents() {
 
 void ResultViewTable::rollback() {
   showInsertRow = false;
+  pageModel->setInsertRow(false);
+  pageModel->clearModifications();
   ((QSqlTableModel*) dataProvider->model())->revertAll();
   updateView();
 }
@@ -235,13 +252,41 @@ void ResultViewTable::selectionChanged(const QItemSelection &selected,
   }
 }
 
+/**
+ * Switches between pages and a single grid loading rows while scrolling
+ * down. In continuous mode the provider only fetches the rows about to be
+ * shown.
+ */
+void ResultViewTable::setContinuous(bool continuous) {
+  this->continuous = continuous;
+  this->page = 0;
+
+  if (dataProvider) {
+    dataProvider->setLazy(continuous);
+  }
+
+  updateView();
+}
+
+/**
+ * The previous provider, if any, is no longer followed : it may be left to
+ * finish on its own.
+ */
 void ResultViewTable::setDataProvider(DataProvider *dataProvider) {
+  if (this->dataProvider) {
+    disconnect(this->dataProvider, 0, this, 0);
+  }
+
   this->dataProvider = dataProvider;
+  dataProvider->setLazy(continuous);
 
   this->page = 0;
+  pageModel->setDataProvider(dataProvider);
 
   updateView();
   connect(dataProvider, SIGNAL(complete()), this, SLOT(updateView()));
+  connect(dataProvider, SIGNAL(rowsFetched(int)),
+          this, SLOT(onRowsFetched(int)));
 }
 
 void ResultViewTable::setPagination(PaginationWidget *pagination) {
@@ -252,6 +297,8 @@ void ResultViewTable::setPagination(PaginationWidget *pagination) {
   connect(this->pagination, SIGNAL(next()), this, SLOT(nextPage()));
   connect(this->pagination, SIGNAL(last()), this, SLOT(lastPage()));
   connect(this->pagination, SIGNAL(rowsPerPageChanged(int)), this, SLOT(setRowsPerPage(int)));
+  connect(this->pagination, SIGNAL(continuousChanged(bool)),
+          this, SLOT(setContinuous(bool)));
 }
 
 void ResultViewTable::setRowsPerPage(int rpp) {
@@ -263,8 +310,7 @@ void ResultViewTable::setupConnections() {
   connect(actionCopy, SIGNAL(triggered()), this, SLOT(copy()));
   connect(actionDetails, SIGNAL(triggered()), this, SLOT(showBlob()));
   connect(actionExport, SIGNAL(triggered()), this, SLOT(exportContent()));
-  connect(shortModel, SIGNAL(itemChanged(QStandardItem*)),
-          this, SLOT(updateItem(QStandardItem*)));
+  connect(pageModel, SIGNAL(edited()), this, SLOT(updateItem()));
 }
 
 void ResultViewTable::setupMenus() {
@@ -296,46 +342,28 @@ void ResultViewTable::showBlob() {
 
 int ResultViewTable::startIndex() {
   int start = this->page * this->rowsPerPage;
-  if (start > dataProvider->model()->rowCount()) {
-    start = dataProvider->model()->rowCount() - rowsPerPage;
+  if (start > dataProvider->rowCount()) {
+    start = dataProvider->rowCount() - rowsPerPage;
   }
   if (start < 0) {
     start = 0;
   }
   return start;
 }
-void ResultViewTable::updateItem(QStandardItem *item) {
+void ResultViewTable::updateItem() {
   emit editRequested(true);
-
-  QSqlRecord record;
-  int row = item->row() + page * rowsPerPage;
-  if (modifiedRecords.contains(row)) {
-    record = modifiedRecords[row];
-  } else {
-    record = dataProvider->model()->record(row);
-  }
-  record.setValue(item->column(), item->data(Qt::DisplayRole));
-  modifiedRecords[row] = record;
 }
 
 void ResultViewTable::updatePagination() {
-  pagination->setPage(page, (int) dataProvider->model()->rowCount() / rowsPerPage);
-  pagination->setRowsPerPage(rowsPerPage);
-  pagination->setReloadEnabled(true);
-}
-
-void ResultViewTable::updateVerticalLabels(int start, int end) {
-  QStringList vlabels;
-  for (int i=start; i<end; i++) {
-    vlabels << QString::number(i+1);
-  }
-
-  if (showInsertRow) {
-    vlabels.removeLast();
-    vlabels << "*";
+  if (continuous) {
+    pagination->setRowCount(dataProvider->rowCount());
+    pagination->setReloadEnabled(true);
+    return;
   }
 
-  shortModel->setVerticalHeaderLabels(vlabels);
+  pagination->setPage(page, (int) dataProvider->rowCount() / rowsPerPage);
+  pagination->setRowsPerPage(rowsPerPage);
+  pagination->setReloadEnabled(true);
 }
 
 void ResultViewTable::updateView() {
@@ -344,48 +372,30 @@ void ResultViewTable::updateView() {
   int hpos = horizontalScrollBar()->value();
   int vpos = verticalScrollBar()->value();
 
-  shortModel->clear();
-
   if (!dataProvider) {
+    pageModel->setWindow(0, 0);
     return;
   }
 
   updatePagination();
-  updateViewHeader();
 
-  if (dataProvider->model()->rowCount() == 0) {
-    return;
+  if (continuous) {
+    pageModel->setWindow(0, INT_MAX);
+  } else {
+    pageModel->setWindow(startIndex(), rowsPerPage);
   }
 
-  populateShortModel();
+  if (dataProvider->rowCount() == 0) {
+    return;
+  }
 
   resizeColumnsToContents();
-  resizeRowsToContents();
+  if (!continuous) {
+    // rows of a continuous grid keep the default height : resizing them would
+    // read every fetched row
+    resizeRowsToContents();
+  }
 
   horizontalScrollBar()->setValue(hpos);
   verticalScrollBar()->setValue(vpos);
 }
-
-void ResultViewTable::updateViewHeader() {
-  for (int i=0; i<dataProvider->model()->columnCount(); i++) {
-    shortModel->setHorizontalHeaderItem(i, new QStandardItem(
-        dataProvider->model()->headerData(i, Qt::Horizontal).toString()));
-  }
-}
-
-QStandardItem* ResultViewTable::viewItem(QVariant value) {
-  QStandardItem* item = new QStandardItem();
-  item->setData(value, Qt::DisplayRole);
-  item->setData(false, Qt::UserRole);
-  item->setEditable(!dataProvider->isReadOnly());
-  return item;
-}
-
-QList<QStandardItem*> ResultViewTable::viewRow(int rowIdx) {
-  QList<QStandardItem*> row;
-  QSqlRecord r = dataProvider->model()->record(rowIdx);
-  for (int j=0; j<dataProvider->model()->columnCount(); j++) {
-    row << viewItem(r.value(j));
-  }
-  return row;
-}
@@ -5,12 +5,12 @@
 #include "../dialogs/blobdialog.h"
 #include "wizards/exportwizard.h"
 #include "resultview/dataprovider.h"
+#include "resultview/pagemodel.h"
 #include "resultview/paginationwidget.h"
 #include "resultview/sqlitemdelegate.h"
 
 #include <QMenu>
 #include <QSqlRecord>
-#include <QStandardItemModel>
 #include <QTableView>
 
 class ResultViewTable : public QTableView {
@@ -34,6 +34,7 @@ public slots:
   void resetColumnSizes();
   void resizeColumnsToContents();
   void rollback();
+  void setContinuous(bool continuous);
   void setRowsPerPage(int rpp);
 
   void firstPage();
@@ -47,16 +48,10 @@ protected:
                         const QItemSelection &deselected);
 
 private:
-  int endIndex(int start);
-  void populateShortModel();
   void setupConnections();
   void setupMenus();
   int startIndex();
   void updatePagination();
-  void updateVerticalLabels(int start, int end);
-  void updateViewHeader();
-  QStandardItem* viewItem(QVariant value);
-  QList<QStandardItem*> viewRow(int rowIdx);
 
   QAction* actionCopy;
   QAction* actionDetails;
@@ -65,12 +60,12 @@ private:
   BlobDialog* blobDialog;
   QList<int> columnSizes;
   QMenu* contextMenu;
+  bool continuous = false;
   int currentEditedRow;
   DataProvider* dataProvider =0;
   ExportWizard* exportWizard;
   SqlItemDelegate* sqlItemDelegate;
-  QMap<int, QSqlRecord> modifiedRecords;
-  QStandardItemModel *shortModel;
+  PageModel *pageModel;
   bool showInsertRow = false;
 
   PaginationWidget* pagination;
@@ -78,8 +73,9 @@ private:
   int rowsPerPage = 20;
 
 private slots:
+  void onRowsFetched(int count);
   void showBlob();
-  void updateItem(QStandardItem *item);
+  void updateItem();
   void updateView();
 };
 
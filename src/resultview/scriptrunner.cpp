@@ -0,0 +1,415 @@
+#include "scriptrunner.h"
+
+#include "tools/logger.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QStringList>
+
+ScriptRunner::ScriptRunner(QObject *parent) {
+  m_model = new QStandardItemModel(0, ColumnCount, this);
+  batchSize = 0;
+  errorPolicy = StopOnError;
+  grouping = true;
+  m_timeout = 0;
+  wrapper = NULL;
+  executed = 0;
+  failed = 0;
+
+  connect(this, SIGNAL(statementsDone(int,int,int,int,int,QString)),
+          this, SLOT(updateStatements(int,int,int,int,int,QString)),
+          Qt::QueuedConnection);
+
+  setParent(parent);
+}
+
+ScriptRunner::~ScriptRunner() {
+  stop();
+  wait();
+}
+
+void ScriptRunner::cancel() {
+  m_error = QSqlError(tr("Script canceled"), "", QSqlError::UnknownError);
+  updateStatements(0, statements.size(), Skipped, -1, -1, "");
+  DataProvider::cancel();
+}
+
+/**
+ * On failure, the statements of the batch are reported as rolled back.
+ */
+bool ScriptRunner::commitBatch(QSqlDatabase &connection, int first,
+                               int count) {
+  if (connection.commit()) {
+    return true;
+  }
+
+  QString error = connection.lastError().text();
+  connection.rollback();
+  emit statementsDone(first, count, RolledBack, -1, -1, error);
+  setError(first, error);
+  return false;
+}
+
+/**
+ * Runs statements in a single call.
+ *
+ * @param rows
+ *    affected or returned rows, -1 if unknown
+ */
+bool ScriptRunner::execute(QSqlDatabase &connection, int first, int count,
+                           int &rows, QString &error) {
+  QString sql = statements[first].text;
+  for (int i=first + 1; i<first + count; i++) {
+    sql += ";\n" + statements[i].text;
+  }
+
+  QSqlQuery q(connection);
+  q.setForwardOnly(true);
+  if (!q.exec(sql)) {
+    error = q.lastError().text();
+    return false;
+  }
+
+  rows = -1;
+  if (count == 1) {
+    if (!q.isSelect()) {
+      rows = q.numRowsAffected();
+    } else if (connection.driver()->hasFeature(QSqlDriver::QuerySize)) {
+      rows = q.size();
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Number of statements from first that can be sent together, before last.
+ */
+int ScriptRunner::groupSize(int first, int last) {
+  int count = 0;
+  while (first + count < last && count < MaxGroupSize
+         && isGroupable(first + count)) {
+    count++;
+  }
+
+  return qMax(1, count);
+}
+
+/**
+ * Statements returning rows, or controlling transactions, run alone.
+ */
+bool ScriptRunner::isGroupable(int statement) {
+  static QStringList alone = QStringList()
+      << "BEGIN" << "CALL" << "COMMIT" << "DESC" << "DESCRIBE" << "END"
+      << "EXPLAIN" << "PRAGMA" << "RELEASE" << "ROLLBACK" << "SAVEPOINT"
+      << "SELECT" << "SHOW" << "START" << "TABLE" << "VALUES" << "WITH";
+
+  QString keyword = statements[statement].keyword;
+  return !keyword.isEmpty() && !alone.contains(keyword);
+}
+
+bool ScriptRunner::isCancelable() {
+  QMutexLocker locker(&cancelMutex);
+  return !canceler.isNull();
+}
+
+QSqlError ScriptRunner::lastError() {
+  return m_error;
+}
+
+void ScriptRunner::run() {
+  m_error = QSqlError();
+
+  // a worker connection, unless the script belongs to a transaction
+  QSqlDatabase connection = db;
+  if (pool) {
+    connection = pool->checkout(&m_error);
+    if (!connection.isValid()) {
+      emit statementsDone(0, statements.size(), Skipped, -1, -1, "");
+      Logger::instance->logError(m_error.text());
+      emit error();
+      emit complete();
+      return;
+    }
+  }
+
+  bool timeout = wrapper && m_timeout > 0
+      && wrapper->setStatementTimeout(&connection, m_timeout);
+
+  QSharedPointer<QueryCanceler> c(wrapper ? wrapper->canceler(&connection)
+                                          : NULL);
+  {
+    QMutexLocker locker(&cancelMutex);
+    canceler = c;
+  }
+
+  runStatements(connection);
+
+  {
+    QMutexLocker locker(&cancelMutex);
+    canceler.clear();
+  }
+  if (c) {
+    c->release();
+  }
+
+  if (timeout) {
+    wrapper->setStatementTimeout(&connection, 0);
+  }
+
+  if (pool) {
+    pool->checkin(connection);
+  }
+
+  if (m_error.type() == QSqlError::NoError) {
+    emit success();
+  } else {
+    Logger::instance->logError(m_error.text());
+    emit error();
+  }
+  emit complete();
+}
+
+/**
+ * Called from the worker thread.
+ */
+void ScriptRunner::runStatements(QSqlDatabase &connection) {
+  bool transactions = batchSize > 0 && pool
+      && connection.driver()->hasFeature(QSqlDriver::Transactions);
+  // a failed group is replayed : nothing of it must have been applied, which
+  // is false inside a transaction
+  bool groups = grouping && pool && wrapper
+      && wrapper->acceptsMultipleStatements();
+
+  bool inBatch = false;
+  int batchStart = 0;
+  int replayEnd = 0;
+  QElapsedTimer timer;
+
+  int i = 0;
+  while (i < statements.size() && !isInterruptionRequested()) {
+    if (transactions && !inBatch) {
+      inBatch = connection.transaction();
+      batchStart = i;
+    }
+
+    if (statements[i].keyword == "BEGIN" || statements[i].keyword == "START") {
+      groups = false;
+    }
+
+    int batchEnd = inBatch ? qMin(batchStart + batchSize, statements.size())
+                           : statements.size();
+    int count = groups && i >= replayEnd ? groupSize(i, batchEnd) : 1;
+
+    int rows = -1;
+    QString error;
+    timer.start();
+    bool ok = execute(connection, i, count, rows, error);
+    int msecs = (int) timer.elapsed();
+
+    if (ok) {
+      emit statementsDone(i, count, Succeeded, rows, msecs, "");
+      i += count;
+    } else if (count > 1 && !inBatch) {
+      // nothing was applied, the statements are run again one by one
+      replayEnd = i + count;
+      continue;
+    } else {
+      emit statementsDone(i, count, Failed, -1, msecs, error);
+      setError(i, error);
+
+      if (inBatch) {
+        connection.rollback();
+        inBatch = false;
+        if (i > batchStart) {
+          emit statementsDone(batchStart, i - batchStart, RolledBack, -1, -1,
+                              "");
+        }
+      }
+
+      i += count;
+      if (errorPolicy == StopOnError) {
+        break;
+      }
+      continue;
+    }
+
+    if (inBatch && i >= batchEnd) {
+      inBatch = false;
+      if (!commitBatch(connection, batchStart, i - batchStart)
+          && errorPolicy == StopOnError) {
+        break;
+      }
+    }
+  }
+
+  // the batch of a canceled script is dropped
+  if (inBatch) {
+    if (isInterruptionRequested()) {
+      connection.rollback();
+      emit statementsDone(batchStart, i - batchStart, RolledBack, -1, -1, "");
+    } else {
+      commitBatch(connection, batchStart, i - batchStart);
+    }
+  }
+
+  if (i < statements.size()) {
+    emit statementsDone(i, statements.size() - i, Skipped, -1, -1, "");
+  }
+}
+
+/**
+ * @param count
+ *    statements per transaction, 0 to let each statement commit on its own
+ */
+void ScriptRunner::setBatchSize(int count) {
+  batchSize = qMax(0, count);
+}
+
+/**
+ * Keeps the first error as the one of the script.
+ */
+void ScriptRunner::setError(int statement, QString error) {
+  if (m_error.type() != QSqlError::NoError) {
+    return;
+  }
+
+  m_error = QSqlError(tr("Line %1: %2").arg(statements[statement].line)
+                      .arg(error), error, QSqlError::StatementError);
+}
+
+void ScriptRunner::setErrorPolicy(ErrorPolicy policy) {
+  errorPolicy = policy;
+}
+
+/**
+ * Whether statements can be sent together, when the wrapper accepts it.
+ */
+void ScriptRunner::setGrouping(bool enabled) {
+  grouping = enabled;
+}
+
+/**
+ * Splits the script and lists its statements in the model. Called from the
+ * GUI thread, while the runner is stopped.
+ *
+ * @param pool
+ *    pool of the connection, the script then runs on a worker connection. NULL
+ *    to run it on db itself, e.g. inside a transaction.
+ */
+void ScriptRunner::setScript(QString script, QSqlDatabase db,
+                             ConnectionPool *pool) {
+  this->db = db;
+  this->pool = pool;
+  m_script = script;
+  statements = SqlSplitter(db.driverName()).split(script);
+  executed = 0;
+  failed = 0;
+
+  m_model->setRowCount(0);
+  m_model->setRowCount(statements.size());
+  m_model->setHorizontalHeaderLabels(QStringList()
+      << tr("Line") << tr("Statement") << tr("State") << tr("Rows")
+      << tr("Time"));
+
+  for (int i=0; i<statements.size(); i++) {
+    const SqlStatement &s = statements[i];
+
+    QStandardItem *line = new QStandardItem(QString::number(s.line));
+    line->setData(s.position, Qt::UserRole);
+    line->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    m_model->setItem(i, LineColumn, line);
+
+    QStandardItem *text = new QStandardItem(
+          s.text.left(PreviewLength).simplified());
+    text->setToolTip(s.text.left(PreviewLength * 10));
+    m_model->setItem(i, StatementColumn, text);
+
+    m_model->setItem(i, StateColumn, new QStandardItem(tr("Pending")));
+
+    for (int c=RowsColumn; c<ColumnCount; c++) {
+      QStandardItem *item = new QStandardItem();
+      item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+      m_model->setItem(i, c, item);
+    }
+  }
+}
+
+/**
+ * Server-side limit of each statement, 0 for none.
+ */
+void ScriptRunner::setTimeout(int msecs) {
+  m_timeout = qMax(0, msecs);
+}
+
+/**
+ * The wrapper of the connection : cancellation, timeout and grouping of the
+ * statements. NULL if there is none.
+ */
+void ScriptRunner::setWrapper(SqlWrapper *wrapper) {
+  this->wrapper = wrapper;
+}
+
+/**
+ * Also cancels the running statement on the server.
+ */
+void ScriptRunner::stop() {
+  requestInterruption();
+
+  QMutexLocker locker(&cancelMutex);
+  QueryCanceler::cancelLater(canceler);
+}
+
+/**
+ * Shows the result of statements. Runs in the GUI thread.
+ *
+ * @param msecs
+ *    duration of the whole call, -1 to keep the one shown
+ */
+void ScriptRunner::updateStatements(int first, int count, int state, int rows,
+                                    int msecs, QString error) {
+  QString stateText;
+  switch (state) {
+  case Pending:     stateText = tr("Pending");      break;
+  case Succeeded:   stateText = tr("Succeeded");    break;
+  case Failed:      stateText = tr("Failed");       break;
+  case RolledBack:  stateText = tr("Rolled back");  break;
+  case Skipped:     stateText = tr("Skipped");      break;
+  }
+
+  for (int r=first; r<first + count && r<m_model->rowCount(); r++) {
+    QStandardItem *item = m_model->item(r, StateColumn);
+    item->setText(stateText);
+    item->setToolTip(error);
+    item->setForeground(state == Failed ? QBrush(Qt::red) : QBrush());
+
+    if (state == Succeeded || state == Failed) {
+      m_model->item(r, RowsColumn)->setText(rows < 0 ? ""
+                                                     : QString::number(rows));
+    }
+
+    if (msecs < 0) {
+      continue;
+    }
+
+    // statements sent together share their duration
+    QString time;
+    if (count == 1) {
+      time = tr("%1 ms").arg(msecs);
+    } else if (r == first) {
+      time = tr("%1 ms (%2 statements)").arg(msecs).arg(count);
+    }
+    m_model->item(r, TimeColumn)->setText(time);
+  }
+
+  if (state == Succeeded || state == Failed) {
+    executed += count;
+  }
+  if (state == Failed) {
+    failed++;
+  }
+
+  emit progress(executed, statements.size());
+}
@@ -0,0 +1,127 @@
+#ifndef SCRIPTRUNNER_H
+#define SCRIPTRUNNER_H
+
+#include "dataprovider.h"
+#include "db/connectionpool.h"
+#include "plugins/sqlwrapper.h"
+#include "tools/sqlsplitter.h"
+
+#include <QMutex>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QStandardItemModel>
+
+/**
+ * Runs the statements of a script one after the other, on a worker
+ * connection.
+ *
+ * Its model holds one row per statement : its line, state, affected rows and
+ * duration, filled as the statements run.
+ *
+ * With a batch size, statements run in transactions committed every batchSize
+ * statements. An error rolls the whole batch back.
+ *
+ * When the wrapper accepts several statements in one call, consecutive
+ * statements that return no rows are sent together, up to MaxGroupSize of
+ * them. Outside of a batch, a group runs in an implicit transaction : if it
+ * fails, nothing was applied and its statements are run again one by one, so
+ * that the failing one is known. Statements are never grouped inside the
+ * editor's transaction, nor after a BEGIN or START TRANSACTION of the script.
+ */
+class ScriptRunner : public DataProvider {
+Q_OBJECT
+public:
+  enum Column {
+    LineColumn,
+    StatementColumn,
+    StateColumn,
+    RowsColumn,
+    TimeColumn,
+    ColumnCount
+  };
+
+  enum ErrorPolicy {
+    StopOnError,
+    ContinueOnError
+  };
+
+  enum StatementState {
+    Pending,
+    Succeeded,
+    Failed,
+    RolledBack,
+    Skipped
+  };
+
+  explicit ScriptRunner(QObject *parent = 0);
+  ~ScriptRunner();
+
+  QSqlDatabase database() { return db; };
+  int errorCount() { return failed; };
+  int executedCount() { return executed; };
+  bool isCancelable();
+  bool isReadOnly() { return true; };
+  QSqlError lastError();
+  QAbstractItemModel* model() { return m_model; };
+  QString query() { return m_script; };
+  int statementCount() { return statements.size(); };
+
+  void cancel();
+  void setBatchSize(int count);
+  void setErrorPolicy(ErrorPolicy policy);
+  void setGrouping(bool enabled);
+  void setScript(QString script, QSqlDatabase db, ConnectionPool *pool = 0);
+  void setTimeout(int msecs);
+  void setWrapper(SqlWrapper *wrapper);
+
+  static const int MaxGroupSize = 64;
+  static const int PreviewLength = 200;
+
+signals:
+  /**
+   * Emitted in the GUI thread each time statements are done.
+   */
+  void progress(int done, int total);
+  void statementsDone(int first, int count, int state, int rows, int msecs,
+                      QString error);
+
+public slots:
+  void stop();
+
+protected:
+  void run();
+
+private:
+  bool commitBatch(QSqlDatabase &connection, int first, int count);
+  bool execute(QSqlDatabase &connection, int first, int count, int &rows,
+               QString &error);
+  int groupSize(int first, int last);
+  bool isGroupable(int statement);
+  void runStatements(QSqlDatabase &connection);
+  void setError(int statement, QString error);
+
+  QSqlDatabase db;
+  QSqlError m_error;
+  QPointer<ConnectionPool> pool;
+  QStandardItemModel *m_model;
+  QString m_script;
+  QList<SqlStatement> statements;
+
+  int batchSize;
+  ErrorPolicy errorPolicy;
+  bool grouping;
+  int m_timeout;
+  SqlWrapper *wrapper;
+
+  QMutex cancelMutex;
+  QSharedPointer<QueryCanceler> canceler;
+
+  int executed;
+  int failed;
+
+private slots:
+  void updateStatements(int first, int count, int state, int rows, int msecs,
+                        QString error);
+};
+
+#endif // SCRIPTRUNNER_H
@@ -2,8 +2,11 @@
 
 #include "tools/logger.h"
 
-TableDataProvider::TableDataProvider(QString table, QSqlDatabase *db, QObject *parent) {
-  this->table = table;
+#include <QSqlDriver>
+
+TableDataProvider::TableDataProvider(QString table, QSqlDatabase *db,
+                                     QObject *parent) {
+  this->m_table = table;
   this->db = db;
 
   m_model = new QSqlTableModel(this, *db);
@@ -12,12 +15,39 @@ TableDataProvider::TableDataProvider(QString table, QSqlDatabase *db, QObject *p
   setParent(parent);
 }
 
+TableDataProvider::~TableDataProvider() {
+  wait();
+}
+
 QSqlError TableDataProvider::lastError() {
   return m_model->lastError();
 }
 
+QString TableDataProvider::query() {
+  QString select = db->driver()->sqlStatement(QSqlDriver::SelectStatement,
+                                              m_table, db->record(m_table),
+                                              false);
+  if (!filter.isEmpty()) {
+    select.append(" WHERE ").append(filter);
+  }
+
+  return select;
+}
+
+/**
+ * The model only runs in the GUI thread, which owns the connection's handle :
+ * the select is queued there. Call select() instead.
+ */
 void TableDataProvider::run() {
-  m_model->setTable(table);
+  QMetaObject::invokeMethod(this, "select", Qt::QueuedConnection);
+}
+
+/**
+ * Reads the rows, from the GUI thread. QSqlTableModel fetches them by blocks
+ * as they are shown.
+ */
+void TableDataProvider::select() {
+  m_model->setTable(m_table);
   m_model->setFilter(filter);
   if (m_model->select()) {
     emit complete();
@@ -27,7 +57,9 @@ void TableDataProvider::run() {
   }
 }
 
+/**
+ * Applies on the next run.
+ */
 void TableDataProvider::setFilter(QString filter) {
   this->filter = filter;
-  start();
 }
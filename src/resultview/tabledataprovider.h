@@ -5,19 +5,29 @@
 
 #include <QSqlTableModel>
 
+/**
+ * Rows of a table, editable. The model and its connection stay in the GUI
+ * thread, where the edits are submitted : the table is read by select(), not
+ * by a worker thread, and doesn't use the connection pool.
+ */
 class TableDataProvider : public DataProvider {
 Q_OBJECT
 public:
-  explicit TableDataProvider(QString table, QSqlDatabase *db, QObject *parent = 0);
+  TableDataProvider(QString table, QSqlDatabase *db, QObject *parent = 0);
+  ~TableDataProvider();
 
+  QSqlDatabase database() { return *db; };
   bool isReadOnly() { return false; };
   QSqlError lastError();
   QSqlQueryModel* model() { return m_model; };
+  QString query();
+  QString table() { return m_table; };
   void setFilter(QString filter);
 
 signals:
 
 public slots:
+  void select();
 
 protected:
   void run();
@@ -26,7 +36,7 @@ private:
   QSqlDatabase* db;
   QString filter = "";
   QSqlTableModel* m_model;
-  QString table;
+  QString m_table;
 
 };
 
@@ -2,176 +2,262 @@
 
 #include "config.h"
 
+#include <QAtomicInt>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QMutexLocker>
+#include <QTextBlock>
+#include <QThreadPool>
+
+/**
+ * Tokens of a snapshot of a document, one line per block.
+ */
+struct SqlDocumentTokens {
+  QAtomicInt canceled;
+  /** Index of the first token of each line, then the token count. */
+  QVector<int> lines;
+  QMutex mutex;
+  /** Notified once tokenized, NULL once it doesn't wait for it anymore. */
+  SqlHighlighter *receiver;
+  /** State at the end of each line. */
+  QVector<int> states;
+  /** Punctuation is left out. */
+  QVector<SqlToken> tokens;
+};
+
+class SqlTokenizeTask : public QRunnable {
+public:
+  SqlTokenizeTask(QSharedPointer<SqlDocumentTokens> document,
+                  QSharedPointer<SqlLexer> lexer, QString text) {
+    this->document = document;
+    this->lexer = lexer;
+    this->text = text;
+  }
+
+  void run() {
+    QVector<SqlToken> line;
+    int state = SqlLexer::Normal;
+    int begin = 0;
+    forever {
+      if (document->states.size() % 1024 == 0 && document->canceled.load()) {
+        return;
+      }
+
+      int end = text.indexOf('\n', begin);
+      if (end < 0) {
+        end = text.size();
+      }
+
+      state = lexer->tokenize(QString::fromRawData(text.constData() + begin,
+                                                   end - begin),
+                              state, line);
+      document->lines << document->tokens.size();
+      document->states << state;
+      foreach (const SqlToken &t, line) {
+        if (t.type != SqlToken::Punctuation) {
+          document->tokens << t;
+        }
+      }
+
+      if (end == text.size()) {
+        break;
+      }
+      begin = end + 1;
+    }
+    document->lines << document->tokens.size();
+
+    QMutexLocker locker(&document->mutex);
+    if (document->receiver) {
+      QMetaObject::invokeMethod(document->receiver, "documentTokenized",
+                                Qt::QueuedConnection);
+    }
+  }
+
+private:
+  QSharedPointer<SqlDocumentTokens> document;
+  QSharedPointer<SqlLexer> lexer;
+  QString text;
+};
 
-QVector<SqlHighlighter::HighlightRule>
-                        SqlHighlighter::highlightingRules;
 QStringList             SqlHighlighter::basicSqlKeywords;
-QRegExp                 SqlHighlighter::beginBlockMarkers[2];
-QTextCharFormat         SqlHighlighter::blockFormats[2];
-QRegExp                 SqlHighlighter::endBlockMarkers[2];
+QSharedPointer<SqlLexer> SqlHighlighter::lexer;
 QStringList             SqlHighlighter::sqlFunctions;
 QStringList             SqlHighlighter::sqlTypes;
 
-/*
- * Blockstates :
- *   0 : nothing special
- *   1 : string
- *   2 : comment
- */
-
 SqlHighlighter::SqlHighlighter(QTextEdit *parent)
   : QSyntaxHighlighter(parent) {
+  bulk = false;
+  documentTokensEnd = 0;
+  documentTokensReady = false;
+  editor = parent;
+  pendingBlock = -1;
+  pendingVisibleBegin = -1;
+  pendingVisibleEnd = -1;
+  pendingTimer.setInterval(0);
+  connect(&pendingTimer, SIGNAL(timeout()), this, SLOT(highlightPending()));
+
+  // sees the changes before QSyntaxHighlighter highlights them
+  QTextDocument *doc = document();
+  setDocument(NULL);
+  connect(doc, SIGNAL(contentsChange(int,int,int)),
+          this, SLOT(documentChanged(int,int,int)));
+  setDocument(doc);
+
   QMap<QString,QColor> colors = Config::shColor;
-  QMap<QString,QTextCharFormat> formats = Config::shFormat;
-  HighlightRule rule;
-
-  // basic SQL syntax
-  foreach (const QString &pattern, basicSqlKeywords) {
-    rule.format = formats["sql_basics"];
-    rule.format.setForeground( colors["sql_basics"] );
-    rule.pattern = QRegExp( "\\b" + pattern.toLower() + "\\b" );
-    highlightingRules.append( rule );
-    rule.pattern = QRegExp( "\\b" + pattern.toUpper() + "\\b" );
-    highlightingRules.append( rule );
-  }
-
-  // SQL functions
-  foreach (const QString &pattern, sqlFunctions) {
-    rule.format = formats["sql_functions"];
-    rule.format.setForeground( colors["sql_functions"] );
-    rule.pattern = QRegExp( "\\b" + pattern.toLower() + "\\b" );
-    highlightingRules.append( rule );
-    rule.pattern = QRegExp( "\\b" + pattern.toUpper() + "\\b" );
-    highlightingRules.append( rule );
-  }
-
-  // SQL types
-  foreach(const QString &pattern, sqlTypes) {
-    rule.format = formats["sql_types"];
-    rule.format.setForeground( colors["sql_types"] );
-    rule.pattern = QRegExp( "\\b" + pattern.toLower() + "\\b" );
-    highlightingRules.append( rule );
-    rule.pattern = QRegExp( "\\b" + pattern.toUpper() + "\\b" );
-    highlightingRules.append( rule );
-  }
-
-  // numbers
-  rule.format = formats["numbers"];
-  rule.format.setForeground( colors["numbers"] );
-  rule.pattern = QRegExp( "\\b\\d+\\.?\\d*\\b" );
-  highlightingRules << rule;
-
-  /*
-   * Blocks
-   */
-  blockFormats[0] = formats["strings"];
-  blockFormats[0].setForeground( colors["strings"] );
-
-  blockFormats[1] = formats["comments"];
-  blockFormats[1].setForeground( colors["comments"] );
-
-  beginBlockMarkers[0] = QRegExp( "(\"|'|`)" );
-  beginBlockMarkers[1] = QRegExp( "--" );
-
-  endBlockMarkers[0] = QRegExp( "(\"|'|`)" );
-  endBlockMarkers[1] = QRegExp( "\n" );
+  QMap<QString,QTextCharFormat> f = Config::shFormat;
+
+  formats[SqlToken::Keyword] = f["sql_basics"];
+  formats[SqlToken::Keyword].setForeground(colors["sql_basics"]);
+  formats[SqlToken::Function] = f["sql_functions"];
+  formats[SqlToken::Function].setForeground(colors["sql_functions"]);
+  formats[SqlToken::DataType] = f["sql_types"];
+  formats[SqlToken::DataType].setForeground(colors["sql_types"]);
+  formats[SqlToken::Number] = f["numbers"];
+  formats[SqlToken::Number].setForeground(colors["numbers"]);
+  formats[SqlToken::String] = f["strings"];
+  formats[SqlToken::String].setForeground(colors["strings"]);
+  formats[SqlToken::Comment] = f["comments"];
+  formats[SqlToken::Comment].setForeground(colors["comments"]);
+  formats[SqlToken::Table] = f["ctxt_table"];
+  formats[SqlToken::Table].setForeground(colors["ctxt_table"]);
+  formats[SqlToken::Table].setUnderlineStyle(QTextCharFormat::SingleUnderline);
+  formats[SqlToken::Field] = f["ctxt_field"];
+  formats[SqlToken::Field].setForeground(colors["ctxt_field"]);
 }
 
-void SqlHighlighter::highlightBlock(const QString &block) {
-  if (block.isEmpty() || block.isNull()) {
-    return;
+SqlHighlighter::~SqlHighlighter() {
+  if (documentTokens) {
+    QMutexLocker locker(&documentTokens->mutex);
+    documentTokens->receiver = NULL;
+    documentTokens->canceled.store(1);
   }
+}
 
-  // keywords
-  foreach (const HighlightRule &rule, highlightingRules) {
-    QRegExp expression(rule.pattern);
-    int index = expression.indexIn(block);
-    while (index >= 0) {
-      int length = expression.matchedLength();
-      setFormat(index, length, rule.format);
-      index = expression.indexIn(block, index + length);
+void SqlHighlighter::applyTokens(const QString &block, const SqlToken *tokens,
+                                 int count) {
+  for (int i=0; i<count; i++) {
+    const SqlToken &t = tokens[i];
+    SqlToken::Type type = t.type;
+    if (type == SqlToken::Identifier && context) {
+      type = context->classify(block.midRef(t.position, t.length));
     }
-  }
-
-  // context
-  foreach (const HighlightRule &rule, contextRules) {
-    QRegExp expression(rule.pattern);
-    int index = expression.indexIn(block);
-    while (index >= 0) {
-      int length = expression.matchedLength();
-      setFormat(index, length, rule.format);
-      index = expression.indexIn(block, index + length);
+    if (type != SqlToken::Identifier && type != SqlToken::Punctuation) {
+      setFormat(t.position, t.length, formats[type]);
     }
   }
+}
 
-  /*
-   * Handling blocks (comments, strings, etc.)
-   */
-  setCurrentBlockState(0);
+/**
+ * Begins a background highlighting if the change is large, or invalidates
+ * the document tokens from the changed block.
+ */
+void SqlHighlighter::documentChanged(int from, int removed, int added) {
+  Q_UNUSED(removed);
+
+  if (added >= LargeChange) {
+    bulk = true;
+    QTimer::singleShot(0, this, SLOT(tokenizeDocument()));
+  } else if (documentTokens) {
+    documentTokensEnd = qMin(documentTokensEnd,
+                             document()->findBlock(from).blockNumber());
+  }
+}
 
-  int startIndex = 0;
+/**
+ * Sets the state of all the blocks from the document tokens, so that
+ * highlighting a block never goes on with the next ones, then highlights them.
+ */
+void SqlHighlighter::documentTokenized() {
+  if (!documentTokens) {
+    return;
+  }
 
-  /*
-   * Each block category (comments, strings, etc.) will be analysed.
-   */
-  for (int s = 0; s < 2; s++) {
-    if (previousBlockState() != s + 1) {
-      startIndex = block.indexOf(beginBlockMarkers[s]);
-    }
+  documentTokensReady = true;
+  const QVector<int> &states = documentTokens->states;
+  QTextBlock b = document()->begin();
+  for (int i=0; b.isValid() && i<documentTokensEnd && i<states.size(); i++) {
+    b.setUserState(states[i]);
+    b = b.next();
+  }
 
-    // if startIndex < 0, it means all blocks have been proceeded
-    while (startIndex >= 0) {
-      // strings have a special case :)
-      if (s == 0) {
-        endBlockMarkers[0] = QRegExp(block.at(startIndex));
-      }
+  highlightVisible();
+}
 
-      int endIndex = block.indexOf(endBlockMarkers[s], startIndex + 1);
-      int length;
+void SqlHighlighter::highlightBlock(const QString &block) {
+  int n = currentBlock().blockNumber();
+  if (documentTokensReady && n < documentTokensEnd
+      && n + 1 < documentTokens->lines.size()) {
+    const QVector<int> &lines = documentTokens->lines;
+    setCurrentBlockState(documentTokens->states[n]);
+    applyTokens(block, documentTokens->tokens.constData() + lines[n],
+                lines[n + 1] - lines[n]);
+    return;
+  }
 
-      // does the block end anywhere ?
-      if (endIndex == -1) {
-        setCurrentBlockState(s + 1);
-        length = block.length() - startIndex;
-      } else {
-        length = endIndex - startIndex + beginBlockMarkers[s].matchedLength();
-      }
+  // highlighted once tokenized in the background
+  if (bulk || !lexer) {
+    setCurrentBlockState(SqlLexer::Normal);
+    return;
+  }
 
-      // applying syntax format
-      setFormat(startIndex, length, blockFormats[s]);
+  // keeps the lexer if the keywords are reloaded meanwhile
+  QSharedPointer<SqlLexer> l = lexer;
+  setCurrentBlockState(l->tokenize(block, previousBlockState(), tokens));
+  applyTokens(block, tokens.constData(), tokens.size());
+}
 
-      startIndex = block.indexOf(beginBlockMarkers[s], startIndex + length);
+/**
+ * Highlights again the blocks left by highlightVisible(), until IdleSlice ms
+ * have elapsed. The document tokens are released at the end.
+ */
+void SqlHighlighter::highlightPending() {
+  QElapsedTimer timer;
+  timer.start();
+
+  QTextBlock b = document()->findBlockByNumber(pendingBlock);
+  while (b.isValid() && timer.elapsed() < IdleSlice) {
+    if (b.blockNumber() < pendingVisibleBegin
+        || b.blockNumber() > pendingVisibleEnd) {
+      rehighlightBlock(b);
     }
+    b = b.next();
   }
-}
 
-void SqlHighlighter::reloadColors() {
+  if (b.isValid()) {
+    pendingBlock = b.blockNumber();
+  } else {
+    pendingBlock = -1;
+    pendingTimer.stop();
+    if (documentTokensReady) {
+      documentTokens.clear();
+      documentTokensReady = false;
+    }
+  }
 }
 
-void SqlHighlighter::reloadContext(QStringList tables,
-                                   QMultiMap<QString, QString>fields) {
-  contextRules.clear();
-  HighlightRule r;
-  foreach (QString t, tables) {
-    r.pattern = QRegExp( "\\b" + t + "\\b" );
-    r.format = Config::shFormat["ctxt_table"];
-    r.format.setForeground( Config::shColor["ctxt_table"] );
-    r.format.setUnderlineStyle(QTextCharFormat::SingleUnderline);
-    contextRules << r;
+/**
+ * Highlights the visible blocks again at once, and the other ones when the
+ * event loop is idle.
+ */
+void SqlHighlighter::highlightVisible() {
+  QTextBlock first = editor->cursorForPosition(QPoint(0, 0)).block();
+  QTextBlock last = editor->cursorForPosition(
+        QPoint(editor->viewport()->width(), editor->viewport()->height()))
+      .block();
+  for (QTextBlock b = first; b.isValid(); b = b.next()) {
+    rehighlightBlock(b);
+    if (b == last) {
+      break;
+    }
   }
 
-  QStringList l = fields.values();
-  l.removeDuplicates();
-
-  foreach (QString f, l) {
-    r.pattern = QRegExp( "\\b" + f + "\\b" );
-    r.format = Config::shFormat["ctxt_field"];
-    r.format.setForeground( Config::shColor["ctxt_field"] );
-    contextRules << r;
-  }
+  pendingVisibleBegin = first.blockNumber();
+  pendingVisibleEnd = last.blockNumber();
+  pendingBlock = 0;
+  pendingTimer.start();
+}
 
-  rehighlight();
+void SqlHighlighter::reloadColors() {
 }
 
 bool SqlHighlighter::reloadKeywords() {
@@ -212,10 +298,25 @@ bool SqlHighlighter::reloadKeywords() {
     file.close();
   }
 
+  lexer = QSharedPointer<SqlLexer>(
+      new SqlLexer(basicSqlKeywords, sqlFunctions, sqlTypes));
+
   reloadColors();
   return true;
 }
 
+/**
+ * Highlights the tables and the columns of the context. The visible blocks
+ * are highlighted again at once, the other ones when the event loop is idle.
+ */
+void SqlHighlighter::setContext(QSharedPointer<const SqlContext> context) {
+  if (context == this->context) {
+    return;
+  }
+  this->context = context;
+  highlightVisible();
+}
+
 QStringList SqlHighlighter::sqlFunctionList() {
   return sqlFunctions;
 }
@@ -227,3 +328,32 @@ QStringList SqlHighlighter::sqlKeywordList() {
 QStringList SqlHighlighter::sqlTypeList() {
   return sqlTypes;
 }
+
+/**
+ * Tokenizes a snapshot of the document in the background. Until then, the
+ * blocks of the large change stay plain.
+ */
+void SqlHighlighter::tokenizeDocument() {
+  if (!bulk) {
+    return;
+  }
+  bulk = false;
+
+  if (documentTokens) {
+    QMutexLocker locker(&documentTokens->mutex);
+    documentTokens->receiver = NULL;
+    documentTokens->canceled.store(1);
+  }
+  documentTokens.clear();
+  documentTokensReady = false;
+
+  if (!lexer) {
+    return;
+  }
+
+  documentTokens = QSharedPointer<SqlDocumentTokens>(new SqlDocumentTokens());
+  documentTokens->receiver = this;
+  documentTokensEnd = document()->blockCount();
+  QThreadPool::globalInstance()->start(
+        new SqlTokenizeTask(documentTokens, lexer, document()->toPlainText()));
+}
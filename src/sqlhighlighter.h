@@ -1,44 +1,79 @@
 #ifndef SQLHIGHLIGHTER_H
 #define SQLHIGHLIGHTER_H
 
+#include "tools/sqlcontext.h"
+#include "tools/sqllexer.h"
+
+#include <QSharedPointer>
 #include <QSyntaxHighlighter>
+#include <QTimer>
 #include <QtWidgets/QTextEdit>
 
+struct SqlDocumentTokens;
+
 /**
  * Syntax highlighting
+ *
+ * The blocks are tokenized by a SqlLexer shared by all the editors, rebuilt
+ * by reloadKeywords(). The state of a block is the SqlLexer::State at its
+ * end. The identifiers are then looked up in the SqlContext of the connection.
+ *
+ * When the context changes, the visible blocks are highlighted again at once
+ * and the other ones by slices of IdleSlice ms, when the event loop is idle.
+ *
+ * A change of LargeChange characters or more, e.g. a large file being opened,
+ * isn't highlighted while it is laid out : the whole document is tokenized on
+ * the global QThreadPool, then highlighted as for a context change.
  */
 class SqlHighlighter : public QSyntaxHighlighter {
 Q_OBJECT
 public:
   SqlHighlighter(QTextEdit*);
+  ~SqlHighlighter();
 
-  void reloadContext(QStringList tables, QMultiMap<QString, QString> fields);
+  void setContext(QSharedPointer<const SqlContext> context);
 
   static void reloadColors();
   static bool reloadKeywords();
+  static QSharedPointer<SqlLexer> sqlLexer() { return lexer; };
   static QStringList sqlKeywordList();
   static QStringList sqlFunctionList();
   static QStringList sqlTypeList();
 
+  static const int IdleSlice = 20;
+  static const int LargeChange = 1024 * 1024;
+
+private slots:
+  void documentChanged(int from, int removed, int added);
+  void documentTokenized();
+  void highlightPending();
+  void tokenizeDocument();
+
 private:
-  /**
-    * This struct 
-    */
-  struct HighlightRule {
-    QRegExp pattern;
-    QTextCharFormat format;
-  };
+  void applyTokens(const QString &block, const SqlToken *tokens, int count);
   void highlightBlock(const QString&);
+  void highlightVisible();
 
-  QVector<HighlightRule>        contextRules;
+  /** A large change is being laid out. */
+  bool                          bulk;
+  QSharedPointer<const SqlContext> context;
+  QSharedPointer<SqlDocumentTokens> documentTokens;
+  /** The document tokens are valid for the blocks before this one. */
+  int                           documentTokensEnd;
+  bool                          documentTokensReady;
+  QTextEdit                    *editor;
+  QTextCharFormat               formats[SqlToken::TypeCount];
+  /** Blocks left to highlight again, by number. */
+  int                           pendingBlock;
+  int                           pendingVisibleBegin;
+  int                           pendingVisibleEnd;
+  QTimer                        pendingTimer;
+  QVector<SqlToken>             tokens;
 
   static QStringList            basicSqlKeywords;
-  static QRegExp                beginBlockMarkers[2];
-  static QTextCharFormat        blockFormats[2];
-  static QRegExp                endBlockMarkers[2];
+  static QSharedPointer<SqlLexer> lexer;
   static QStringList            sqlFunctions;
   static QStringList            sqlTypes;
-  static QVector<HighlightRule> highlightingRules;
 };
 
 #endif // SQLHIGHLIGHTER_H
@@ -20,22 +20,37 @@ SOURCES += main.cpp \
     config.cpp \
     widgets/querytextedit.cpp \
     wizards/exportwizard.cpp \
+    wizards/importwizard.cpp \
     widgets/dbtreeview.cpp \
+    widgets/queryqueueview.cpp \
     plugins/plugindialog.cpp \
     plugins/pluginmanager.cpp \
+    plugins/exportjob.cpp \
+    plugins/importjob.cpp \
+    plugins/partitionedexport.cpp \
+    plugins/querycanceler.cpp \
     iconmanager.cpp \
     dialogs/searchdialog.cpp \
     widgets/colorbutton.cpp \
     tabwidget/schemawidget.cpp \
     dialogs/blobdialog.cpp \
     resultview/resultviewtable.cpp \
+    tools/compressiondevice.cpp \
+    tools/csvtokenizer.cpp \
     tools/logger.cpp \
+    tools/sqlcompletion.cpp \
+    tools/sqlcontext.cpp \
+    tools/sqllexer.cpp \
+    tools/sqlsplitter.cpp \
+    plugins/exportengines/arrow/arrowexportengine.cpp \
     plugins/exportengines/csv/csvexportengine.cpp \
     plugins/exportengines/csv/csvwizardpage.cpp \
     plugins/exportengines/html/htmlexportengine.cpp \
     plugins/exportengines/html/htmlwizardpage.cpp \
     plugins/exportengines/plaintext/plaintextexportengine.cpp \
     plugins/exportengines/plaintext/plaintextwizardpage.cpp \
+    plugins/importengines/csv/csvimportengine.cpp \
+    plugins/importengines/csv/csvimportpage.cpp \
     plugins/wrappers/db2i/db2iwrapper.cpp \
     plugins/wrappers/mysql/mysqlwrapper.cpp \
     plugins/wrappers/psql/psqlconfig.cpp \
@@ -44,9 +59,18 @@ SOURCES += main.cpp \
     resultview/dataprovider.cpp \
     resultview/tabledataprovider.cpp \
     resultview/querydataprovider.cpp \
+    resultview/queryresultmodel.cpp \
+    resultview/pagemodel.cpp \
     resultview/paginationwidget.cpp \
     resultview/sqlitemdelegate.cpp \
-    db/connection.cpp
+    resultview/scriptrunner.cpp \
+    db/catalogmodel.cpp \
+    db/connection.cpp \
+    db/connectionpool.cpp \
+    db/contextservice.cpp \
+    db/metadatacache.cpp \
+    db/metadataloader.cpp \
+    db/queryscheduler.cpp
 HEADERS += mainwindow.h \
     dbmanager.h \
     tabwidget/tablewidget.h \
@@ -61,7 +85,9 @@ HEADERS += mainwindow.h \
     config.h \
     widgets/querytextedit.h \
     wizards/exportwizard.h \
+    wizards/importwizard.h \
     widgets/dbtreeview.h \
+    widgets/queryqueueview.h \
     plugins/sqlwrapper.h \
     plugins/plugindialog.h \
     plugins/plugin.h \
@@ -70,17 +96,31 @@ HEADERS += mainwindow.h \
     dialogs/searchdialog.h \
     widgets/colorbutton.h \
     plugins/exportengine.h \
+    plugins/exportjob.h \
+    plugins/importengine.h \
+    plugins/importjob.h \
+    plugins/partitionedexport.h \
+    plugins/querycanceler.h \
     db_enum.h \
     tabwidget/schemawidget.h \
     dialogs/blobdialog.h \
     resultview/resultviewtable.h \
+    tools/compressiondevice.h \
+    tools/csvtokenizer.h \
     tools/logger.h \
+    tools/sqlcompletion.h \
+    tools/sqlcontext.h \
+    tools/sqllexer.h \
+    tools/sqlsplitter.h \
+    plugins/exportengines/arrow/arrowexportengine.h \
     plugins/exportengines/csv/csvexportengine.h \
     plugins/exportengines/csv/csvwizardpage.h \
     plugins/exportengines/html/htmlexportengine.h \
     plugins/exportengines/html/htmlwizardpage.h \
     plugins/exportengines/plaintext/plaintextexportengine.h \
     plugins/exportengines/plaintext/plaintextwizardpage.h \
+    plugins/importengines/csv/csvimportengine.h \
+    plugins/importengines/csv/csvimportpage.h \
     plugins/wrappers/db2i/db2iwrapper.h \
     plugins/wrappers/mysql/mysqlwrapper.h \
     plugins/wrappers/psql/psqlconfig.h \
@@ -89,9 +129,18 @@ HEADERS += mainwindow.h \
     resultview/dataprovider.h \
     resultview/tabledataprovider.h \
     resultview/querydataprovider.h \
+    resultview/queryresultmodel.h \
+    resultview/pagemodel.h \
     resultview/paginationwidget.h \
     resultview/sqlitemdelegate.h \
-    db/connection.h
+    resultview/scriptrunner.h \
+    db/catalogmodel.h \
+    db/connection.h \
+    db/connectionpool.h \
+    db/contextservice.h \
+    db/metadatacache.h \
+    db/metadataloader.h \
+    db/queryscheduler.h
 FORMS += mainwindow.ui \
     dialogs/dbdialog.ui \
     tabwidget/queryeditorwidget.ui \
@@ -103,6 +152,9 @@ FORMS += mainwindow.ui \
     wizards/ndw_secondpage.ui \
     wizards/ew_firstpage.ui \
     wizards/ew_exportpage.ui \
+    wizards/iw_firstpage.ui \
+    wizards/iw_importpage.ui \
+    wizards/iw_mappingpage.ui \
     plugins/plugindialog.ui \
     dialogs/searchdialog.ui \
     tabwidget/schemawidget.ui \
@@ -110,10 +162,37 @@ FORMS += mainwindow.ui \
     plugins/exportengines/csv/csvwizardpage.ui \
     plugins/exportengines/html/htmlwizardpage.ui \
     plugins/exportengines/plaintext/plaintextwizardpage.ui \
+    plugins/importengines/csv/csvimportpage.ui \
     plugins/wrappers/psql/psqlconfig.ui
 RESOURCES += icons.qrc \
     syntax.qrc
 
+# ##
+# Compression of the exports : zlib is required, zstd is optional
+# (qmake CONFIG+=zstd)
+LIBS += -lz
+zstd {
+    DEFINES += HAVE_ZSTD
+    LIBS += -lzstd
+}
+
+# ##
+# Server-side cancellation of the queries, both optional :
+# - libpq (qmake CONFIG+=libpq) sends PQcancel() through the QPSQL handle,
+#   instead of pg_cancel_backend() on another connection. It also allows the
+#   imports through COPY FROM STDIN
+# - sqlite3 (qmake CONFIG+=sqlite3) allows sqlite3_interrupt(). Qt's SQLite
+#   plugin must then be built against the system library (-system-sqlite)
+libpq {
+    DEFINES += HAVE_LIBPQ
+    LIBS += -lpq
+    unix:INCLUDEPATH += /usr/include/postgresql
+}
+sqlite3 {
+    DEFINES += HAVE_SQLITE3
+    LIBS += -lsqlite3
+}
+
 # ##
 # Common
 trs.files = ../tr/fr_FR.qm
@@ -1,5 +1,7 @@
 #include "../config.h"
 #include "../dbmanager.h"
+#include "../db/contextservice.h"
+#include "../db/queryscheduler.h"
 #include "../iconmanager.h"
 #include "../mainwindow.h"
 #include "../tools/logger.h"
@@ -9,17 +11,22 @@
 #include <QDateTime>
 #include <QDebug>
 #include <QFileDialog>
+#include <QHeaderView>
 #include <QSqlQuery>
-#include <QSqlRecord>
 
 QueryEditorWidget::QueryEditorWidget(QWidget *parent)
   : AbstractTabWidget(parent) {
   setupUi(this);
   setupWidgets();
 
-  dataProvider = new QueryDataProvider(this);
-  tableView->setDataProvider(dataProvider);
+  inTransaction = false;
+  pendingRun = NoRun;
+  taskId = -1;
 
+  setupDataProvider();
+  setupScriptRunner();
+  activeProvider = dataProvider;
+  scriptOffset = 0;
   setupConnections();
 
   // setAutoDelete(false);
@@ -27,6 +34,33 @@ QueryEditorWidget::QueryEditorWidget(QWidget *parent)
   // watcher     = new QFileSystemWatcher(this);
 }
 
+/**
+ * Replaces a provider that can't be stopped at once : it is left to finish on
+ * its own, its worker connection goes back to the pool once the server is
+ * done with the statement.
+ */
+void QueryEditorWidget::abandon(DataProvider *provider) {
+  bool script = provider == scriptRunner;
+
+  provider->stop();
+  disconnect(provider, 0, this, 0);
+  provider->setParent(0);
+  connect(provider, SIGNAL(finished()), provider, SLOT(deleteLater()));
+  if (provider->isFinished()) {
+    provider->deleteLater();
+  }
+
+  if (script) {
+    setupScriptRunner();
+  } else {
+    setupDataProvider();
+  }
+
+  if (activeProvider == provider) {
+    activeProvider = script ? (DataProvider*) scriptRunner : dataProvider;
+  }
+}
+
 AbstractTabWidget::Actions QueryEditorWidget::availableActions() {
   Actions ret = baseActions;
   if (!isSaved()) {
@@ -44,18 +78,42 @@ AbstractTabWidget::Actions QueryEditorWidget::availableActions() {
   return ret;
 }
 
+/**
+ * Cancels the query on the server. When the DBMS doesn't allow it, the query
+ * is detached so that the editor is available again : it keeps running on the
+ * server, and may still commit.
+ */
+void QueryEditorWidget::cancelQuery() {
+  cancelButton->setEnabled(false);
+
+  if (activeProvider->isRunning() && !activeProvider->isCancelable()
+      && !inTransaction) {
+    abandon(activeProvider);
+    runButton->setEnabled(true);
+    scriptButton->setEnabled(true);
+    statusBar->showMessage(tr("Query detached, it is still running on the "
+                              "server"));
+    return;
+  }
+
+  statusBar->showMessage(tr("Canceling..."));
+  QueryScheduler::instance->cancel(taskId);
+}
+
 void QueryEditorWidget::checkDbOpen() {
   DbManager::instance->lastUsedDbIndex = dbChooser->currentIndex();
 
   QSqlDatabase *db = currentDb();
   if (db == NULL) {
     runButton->setEnabled(false);
+    scriptButton->setEnabled(false);
     return;
   }
 
   updateTransactionButtons(db);
 
   runButton->setEnabled(db->isOpen());
+  scriptButton->setEnabled(db->isOpen());
 
   reloadContext(db);
 }
@@ -74,6 +132,7 @@ void QueryEditorWidget::closeEvent(QCloseEvent *event) {
 
 void QueryEditorWidget::commit() {
   if (currentDb()->commit()) {
+    inTransaction = false;
     commitButton->hide();
     rollbackButton->hide();
     transactionButton->show();
@@ -123,6 +182,16 @@ int QueryEditorWidget::confirmCloseAll() {
   return ret;
 }
 
+/**
+ * A new context was loaded for the connection.
+ */
+void QueryEditorWidget::contextChanged(QString connection) {
+  QSqlDatabase *db = currentDb();
+  if (db && ContextService::key(db) == connection) {
+    reloadContext(db);
+  }
+}
+
 void QueryEditorWidget::copy() {
   editor->copy();
 }
@@ -166,6 +235,7 @@ bool QueryEditorWidget::isSaved() {
 void QueryEditorWidget::keyPressEvent(QKeyEvent *event) {
   if (event->key() == Qt::Key_Escape) {
     tableContainer->hide();
+    scriptContainer->hide();
     resultButton->setChecked(false);
   } else {
     QWidget::keyPressEvent(event);
@@ -216,26 +286,26 @@ void QueryEditorWidget::refresh() {
 }
 
 void QueryEditorWidget::reload() {
-  dataProvider->start();
+  QString query = dataProvider->query();
+  if (!stopQuery(ReloadRun) || !queryConnection) {
+    return;
+  }
+
+  runButton->setEnabled(false);
+  statusBar->showMessage(tr("Running..."));
+  runQuery(query);
   // tableView->updateView();
 }
 
+/**
+ * The context is loaded in the background, see contextChanged().
+ */
 void QueryEditorWidget::reloadContext(QSqlDatabase *db) {
   if (!db->isOpen() || db->driverName().startsWith("QOCI")) {
     return;
   }
 
-  QMultiMap<QString, QString> fields;
-  QSqlRecord r;
-  QStringList tables = db->tables();
-  foreach (QString t, tables) {
-    r = db->record(t);
-    for (int i=0; i<r.count(); i++) {
-      fields.insert(t, r.fieldName(i));
-    }
-  }
-
-  editor->reloadContext(tables, fields);
+  editor->reloadContext(ContextService::instance->context(db));
 }
 
 void QueryEditorWidget::reloadFile() {
@@ -272,19 +342,35 @@ void QueryEditorWidget::reloadFile() {
 
 void QueryEditorWidget::queryError() {
   statusBar->showMessage(tr("Unable to run query"));
+}
+
+void QueryEditorWidget::queryComplete() {
   runButton->setEnabled(true);
+  scriptButton->setEnabled(true);
+  cancelButton->setEnabled(false);
+
+  if (dataProvider->lastError().type() != QSqlError::NoError) {
+    return;
+  }
+
+  QString logMsg = tr("Query executed with success (%1 lines returned)")
+      .arg(dataProvider->rowCount());
+  statusBar->showMessage(logMsg);
 }
 
+/**
+ * Called as soon as the first rows are available. The query may still be
+ * fetching.
+ */
 void QueryEditorWidget::querySuccess() {
   tableContainer->setVisible(true);
   resultButton->setEnabled(true);
   resultButton->setChecked(true);
-
-  QString logMsg = tr("Query executed with success (%1 lines returned)")
-      .arg(dataProvider->model()->rowCount());
-  statusBar->showMessage(logMsg);
-
+  // in continuous mode the provider waits for the view, another query may
+  // be started meanwhile
   runButton->setEnabled(true);
+  scriptButton->setEnabled(true);
+
   emit success();
 }
 
@@ -311,6 +397,7 @@ QString QueryEditorWidget::queryText() {
 
 void QueryEditorWidget::rollback() {
   if (currentDb()->rollback()) {
+    inTransaction = false;
     commitButton->hide();
     rollbackButton->hide();
     transactionButton->show();
@@ -334,6 +421,105 @@ void QueryEditorWidget::run() {
 }
 */
 
+/**
+ * Queues a query on the connection of the last run.
+ */
+void QueryEditorWidget::runQuery(QString query) {
+  // the transaction is bound to the connection's own handle
+  QSqlDatabase *db = queryConnection->db();
+  dataProvider->setQuery(query, *db,
+                         inTransaction ? NULL : queryConnection->pool());
+  dataProvider->setTimeout(queryConnection->statementTimeout());
+  dataProvider->setWrapper(DbManager::instance->wrapper(db));
+
+  cancelButton->setEnabled(true);
+  activeProvider = dataProvider;
+  taskId = QueryScheduler::instance->submit(dataProvider, query);
+}
+
+/**
+ * Resumes the run deferred by stopQuery().
+ */
+void QueryEditorWidget::runPending() {
+  PendingRun run = pendingRun;
+  if (run == NoRun) {
+    return;
+  }
+
+  QList<DataProvider*> providers;
+  providers << dataProvider << scriptRunner;
+  foreach (DataProvider *p, providers) {
+    disconnect(p, SIGNAL(finished()), this, SLOT(runPending()));
+    // finished() was emitted : the thread is only cleaning up
+    p->wait();
+  }
+
+  pendingRun = NoRun;
+  switch (run) {
+  case QueryRun:
+    start();
+    break;
+  case ReloadRun:
+    reload();
+    break;
+  case ScriptRun:
+    runScript();
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * Runs the statements of the selection, or of the whole editor, one after the
+ * other.
+ */
+void QueryEditorWidget::runScript() {
+  QTextCursor tc = editor->textCursor();
+  QString script = tc.selectedText().replace(QChar::ParagraphSeparator, '\n');
+  scriptOffset = tc.selectionStart();
+  if (script.trimmed().isEmpty()) {
+    script = editor->toPlainText();
+    scriptOffset = 0;
+  }
+
+  if (!stopQuery(ScriptRun)) {
+    return;
+  }
+
+  queryConnection = DbManager::instance->connections()
+      [dbChooser->currentIndex()];
+  QSqlDatabase *db = queryConnection->db();
+
+  // the transaction is bound to the connection's own handle
+  scriptRunner->setScript(script, *db,
+                          inTransaction ? NULL : queryConnection->pool());
+  if (scriptRunner->statementCount() == 0) {
+    statusBar->showMessage(tr("No statement to run"));
+    return;
+  }
+
+  scriptRunner->setBatchSize(inTransaction ? 0 : batchSpinBox->value());
+  scriptRunner->setErrorPolicy(
+        (ScriptRunner::ErrorPolicy) errorPolicyComboBox->currentIndex());
+  scriptRunner->setGrouping(groupCheckBox->isChecked());
+  scriptRunner->setTimeout(queryConnection->statementTimeout());
+  scriptRunner->setWrapper(DbManager::instance->wrapper(db));
+
+  resultButton->setChecked(false);
+  tableContainer->setVisible(false);
+  scriptContainer->setVisible(true);
+  runButton->setEnabled(false);
+  scriptButton->setEnabled(false);
+  cancelButton->setEnabled(true);
+  updateScriptProgress(0, scriptRunner->statementCount());
+
+  activeProvider = scriptRunner;
+  taskId = QueryScheduler::instance->submit(
+        scriptRunner, tr("Script (%1 statements)")
+                      .arg(scriptRunner->statementCount()));
+}
+
 /**
  * @returns false in case of error
  */
@@ -389,6 +575,19 @@ void QueryEditorWidget::saveAs(QString name) {
   save();
 }
 
+void QueryEditorWidget::scriptComplete() {
+  runButton->setEnabled(true);
+  scriptButton->setEnabled(true);
+  cancelButton->setEnabled(false);
+
+  QString msg = tr("Script executed : %1 of %2 statements, %3 errors")
+      .arg(scriptRunner->executedCount())
+      .arg(scriptRunner->statementCount())
+      .arg(scriptRunner->errorCount());
+  scriptLabel->setText(msg);
+  statusBar->showMessage(msg);
+}
+
 void QueryEditorWidget::selectAll() {
   editor->selectAll();
 }
@@ -409,9 +608,15 @@ void QueryEditorWidget::setFilePath(QString path) {
 void QueryEditorWidget::setupConnections() {
   connect(dbChooser, SIGNAL(currentIndexChanged(int)),
           this, SLOT(checkDbOpen()));
+  connect(ContextService::instance, SIGNAL(contextChanged(QString)),
+          this, SLOT(contextChanged(QString)));
   connect(pagination, SIGNAL(reload()), this, SLOT(reload()));
 
   connect(runButton, SIGNAL(clicked()), this, SLOT(start()));
+  connect(cancelButton, SIGNAL(clicked()), this, SLOT(cancelQuery()));
+  connect(scriptButton, SIGNAL(clicked()), this, SLOT(runScript()));
+  connect(scriptView, SIGNAL(doubleClicked(QModelIndex)),
+          this, SLOT(showStatement(QModelIndex)));
 
   connect(editor->document(), SIGNAL(modificationChanged(bool)),
           this, SIGNAL(modificationChanged(bool)));
@@ -422,13 +627,34 @@ void QueryEditorWidget::setupConnections() {
   connect(rollbackButton, SIGNAL(clicked()), this, SLOT(rollback()));
   connect(transactionButton, SIGNAL(clicked()), this, SLOT(startTransaction()));
 
+  // connect(watcher, SIGNAL(fileChanged(QString)),
+  //         this, SLOT(onFileChanged(QString)));
+}
+
+void QueryEditorWidget::setupDataProvider() {
+  dataProvider = new QueryDataProvider(this);
+  tableView->setDataProvider(dataProvider);
+
   connect(dataProvider, SIGNAL(error()),
           this, SLOT(queryError()));
   connect(dataProvider, SIGNAL(success()),
           this, SLOT(querySuccess()));
+  connect(dataProvider, SIGNAL(complete()),
+          this, SLOT(queryComplete()));
+  connect(dataProvider, SIGNAL(rowsFetched(int)),
+          this, SLOT(updateFetchedRows(int)));
+}
 
-  // connect(watcher, SIGNAL(fileChanged(QString)),
-  //         this, SLOT(onFileChanged(QString)));
+void QueryEditorWidget::setupScriptRunner() {
+  scriptRunner = new ScriptRunner(this);
+  scriptView->setModel(scriptRunner->model());
+  scriptView->horizontalHeader()->setStretchLastSection(false);
+  scriptView->horizontalHeader()->setSectionResizeMode(
+        ScriptRunner::StatementColumn, QHeaderView::Stretch);
+
+  connect(scriptRunner, SIGNAL(complete()), this, SLOT(scriptComplete()));
+  connect(scriptRunner, SIGNAL(progress(int,int)),
+          this, SLOT(updateScriptProgress(int,int)));
 }
 
 void QueryEditorWidget::setupWidgets() {
@@ -455,6 +681,8 @@ void QueryEditorWidget::setupWidgets() {
   dbChooser->setCurrentIndex(DbManager::instance->lastUsedDbIndex);
 
   runButton->setIcon(IconManager::get("player_play"));
+  scriptButton->setIcon(IconManager::get("media-seek-forward"));
+  cancelButton->setIcon(IconManager::get("stop"));
 
   cursorPositionLabel = new QLabel(this);
 
@@ -465,6 +693,20 @@ void QueryEditorWidget::setupWidgets() {
   refresh();
 }
 
+/**
+ * Moves the cursor to a statement of the last script.
+ */
+void QueryEditorWidget::showStatement(const QModelIndex &index) {
+  int position = index.sibling(index.row(), ScriptRunner::LineColumn)
+      .data(Qt::UserRole).toInt() + scriptOffset;
+
+  QTextCursor tc = editor->textCursor();
+  tc.setPosition(qMin(position, editor->document()->characterCount() - 1));
+  editor->setTextCursor(tc);
+  editor->ensureCursorVisible();
+  editor->setFocus();
+}
+
 void QueryEditorWidget::showEvent(QShowEvent *event) {
   editor->setFocus();
 }
@@ -472,18 +714,26 @@ void QueryEditorWidget::showEvent(QShowEvent *event) {
 void QueryEditorWidget::start() {
   resultButton->setChecked(false);
   tableContainer->setVisible(false);
+  scriptContainer->setVisible(false);
   resultButton->setEnabled(false);
   runButton->setEnabled(false);
+  scriptButton->setEnabled(false);
 
   statusBar->showMessage(tr("Running..."));
 
-  dataProvider->setQuery(queryText(), *currentDb());
-  dataProvider->start();
+  if (!stopQuery(QueryRun)) {
+    return;
+  }
+
+  queryConnection = DbManager::instance->connections()
+      [dbChooser->currentIndex()];
+  runQuery(queryText());
   // tabView->reload();
 }
 
 void QueryEditorWidget::startTransaction() {
   if (currentDb()->transaction()) {
+    inTransaction = true;
     commitButton->show();
     rollbackButton->show();
     transactionButton->hide();
@@ -491,6 +741,44 @@ void QueryEditorWidget::startTransaction() {
   }
 }
 
+/**
+ * Stops the running query before another run. Inside a transaction, it uses
+ * the connection's own handle : the run is resumed by runPending() once the
+ * query has ended.
+ *
+ * @return false if the run has to wait
+ */
+bool QueryEditorWidget::stopQuery(PendingRun run) {
+  pendingRun = NoRun;
+
+  QList<DataProvider*> providers;
+  providers << dataProvider << scriptRunner;
+
+  foreach (DataProvider *p, providers) {
+    if (!p->isRunning()) {
+      continue;
+    }
+
+    if (!inTransaction) {
+      abandon(p);
+      continue;
+    }
+
+    p->stop();
+    connect(p, SIGNAL(finished()), this, SLOT(runPending()),
+            Qt::UniqueConnection);
+    if (p->isRunning()) {
+      pendingRun = run;
+    }
+  }
+
+  if (pendingRun != NoRun) {
+    statusBar->showMessage(tr("Waiting for the previous query to stop..."));
+    return false;
+  }
+  return true;
+}
+
 QString QueryEditorWidget::title() {
   QString t;
   if(!filePath.isEmpty())
@@ -509,6 +797,20 @@ void QueryEditorWidget::undo() {
   editor->undo();
 }
 
+void QueryEditorWidget::updateFetchedRows(int count) {
+  if (dataProvider->isRunning()) {
+    statusBar->showMessage(tr("Fetching... (%1 lines)").arg(count));
+  }
+}
+
+void QueryEditorWidget::updateScriptProgress(int done, int total) {
+  QString msg = tr("Running script... (%1/%2)").arg(done).arg(total);
+  scriptLabel->setText(msg);
+  if (scriptRunner->isRunning()) {
+    statusBar->showMessage(msg);
+  }
+}
+
 void QueryEditorWidget::updateTransactionButtons(QSqlDatabase *db) {
   commitButton->setIcon(IconManager::get("transaction-commit"));
   commitButton->hide();
@@ -2,10 +2,13 @@
 #define QUERYEDITORWIDGET_H
 
 #include "abstracttabwidget.h"
+#include "db/connection.h"
 #include "resultview/querydataprovider.h"
+#include "resultview/scriptrunner.h"
 
 #include "ui_queryeditorwidget.h"
 
+#include <QPointer>
 #include <QSqlError>
 #include <QSqlResult>
 #include <QSqlQuery>
@@ -47,6 +50,17 @@ signals:
   void fileChanged(QString);
 
 private:
+  /**
+   * Run deferred until the previous query has ended.
+   */
+  enum PendingRun {
+    NoRun,
+    QueryRun,
+    ReloadRun,
+    ScriptRun
+  };
+
+  void abandon(DataProvider *provider);
   void closeEvent(QCloseEvent *event);
   QSqlDatabase* currentDb();
   bool confirmClose();
@@ -54,32 +68,52 @@ private:
   QString queryText();
   void reloadContext(QSqlDatabase* db);
   void reloadFile();
+  void runQuery(QString query);
   void setFilePath(QString);
   void setupConnections();
+  void setupDataProvider();
+  void setupScriptRunner();
   void setupWidgets();
   void showEvent(QShowEvent *event);
+  bool stopQuery(PendingRun run);
   void updateTransactionButtons(QSqlDatabase* db);
 
+  DataProvider*         activeProvider;
   Actions               baseActions;
   QLabel* cursorPositionLabel;
   QueryDataProvider* dataProvider;
   QString               filePath;
+  bool                  inTransaction;
   int                   oldCount;
   int                   page;
+  PendingRun            pendingRun;
+  QPointer<Connection>  queryConnection;
   QToolButton*          resultButton;
+  int                   scriptOffset;
+  ScriptRunner*         scriptRunner;
   QStatusBar           *statusBar;
+  int                   taskId;
   // QFileSystemWatcher   *watcher;
 
 private slots:
+  void cancelQuery();
   void checkDbOpen();
   void commit();
+  void contextChanged(QString connection);
   void onFileChanged(QString path);
+  void queryComplete();
   void queryError();
   void querySuccess();
   void rollback();
+  void runPending();
+  void runScript();
+  void scriptComplete();
+  void showStatement(const QModelIndex &index);
   void start();
   void startTransaction();
   void updateCursorPosition();
+  void updateFetchedRows(int count);
+  void updateScriptProgress(int done, int total);
 };
 
 #endif // QUERYEDITORWIDGET_H
@@ -69,7 +69,8 @@ void TableWidget::refreshStructure() {
 }
 
 void TableWidget::reload() {
-  dataProvider->start();
+  // not a thread task, the model stays in the GUI thread
+  dataProvider->select();
 }
 
 void TableWidget::rollback() {
@@ -131,4 +132,5 @@ QString TableWidget::table() {
 
 void TableWidget::updateFilter() {
   dataProvider->setFilter(filterEdit->text());
+  reload();
 }
@@ -0,0 +1,266 @@
+#include "compressiondevice.h"
+
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/**
+ * Compresses the queued chunks into the target device.
+ */
+class CompressionThread : public QThread {
+public:
+  CompressionThread(QIODevice *target, CompressionDevice::Format format,
+                    int level) {
+    this->target = target;
+    this->format = format;
+    this->level = level;
+    failed = false;
+    finishing = false;
+  }
+
+  bool hasFailed() {
+    QMutexLocker locker(&mutex);
+    return failed;
+  }
+
+  /**
+   * Stops the thread once every queued chunk is written.
+   */
+  void finish() {
+    QMutexLocker locker(&mutex);
+    finishing = true;
+    queued.wakeAll();
+  }
+
+  void push(const QByteArray &chunk) {
+    QMutexLocker locker(&mutex);
+    while (chunks.size() >= CompressionDevice::MaxPendingChunks && !failed) {
+      dequeued.wait(&mutex);
+    }
+    chunks.enqueue(chunk);
+    queued.wakeAll();
+  }
+
+protected:
+  void run() {
+    bool ok = format == CompressionDevice::Gzip ? runGzip() : runZstd();
+
+    if (!ok) {
+      QMutexLocker locker(&mutex);
+      failed = true;
+      chunks.clear();
+      dequeued.wakeAll();
+    }
+  }
+
+private:
+  /**
+   * @return false when the thread must stop
+   */
+  bool next(QByteArray &chunk) {
+    QMutexLocker locker(&mutex);
+    while (chunks.isEmpty() && !finishing) {
+      queued.wait(&mutex);
+    }
+    if (chunks.isEmpty()) {
+      return false;
+    }
+
+    chunk = chunks.dequeue();
+    dequeued.wakeAll();
+    return true;
+  }
+
+  bool runGzip() {
+    z_stream z;
+    z.zalloc = Z_NULL;
+    z.zfree = Z_NULL;
+    z.opaque = Z_NULL;
+    // 15 + 16 : gzip header instead of the zlib one
+    if (deflateInit2(&z, level < 0 ? Z_DEFAULT_COMPRESSION : qBound(1, level, 9),
+                     Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      return false;
+    }
+
+    QByteArray out(CompressionDevice::ChunkSize, '\0');
+    QByteArray chunk;
+    bool ok = true;
+    bool more = true;
+    while (ok && more) {
+      more = next(chunk);
+
+      z.next_in = (Bytef*) chunk.data();
+      z.avail_in = more ? chunk.size() : 0;
+      int flush = more ? Z_NO_FLUSH : Z_FINISH;
+      int ret;
+      do {
+        z.next_out = (Bytef*) out.data();
+        z.avail_out = out.size();
+        ret = deflate(&z, flush);
+        int size = out.size() - z.avail_out;
+        if (ret == Z_STREAM_ERROR || target->write(out.constData(), size) != size) {
+          ok = false;
+          break;
+        }
+      } while (z.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+    }
+
+    deflateEnd(&z);
+    return ok;
+  }
+
+  bool runZstd() {
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *ctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel,
+                           level < 0 ? 3 : qBound(1, level, 19));
+
+    QByteArray out(ZSTD_CStreamOutSize(), '\0');
+    QByteArray chunk;
+    bool ok = true;
+    bool more = true;
+    while (ok && more) {
+      more = next(chunk);
+
+      ZSTD_inBuffer in = { chunk.constData(), (size_t) (more ? chunk.size() : 0), 0 };
+      ZSTD_EndDirective mode = more ? ZSTD_e_continue : ZSTD_e_end;
+      size_t remaining;
+      do {
+        ZSTD_outBuffer o = { out.data(), (size_t) out.size(), 0 };
+        remaining = ZSTD_compressStream2(ctx, &o, &in, mode);
+        if (ZSTD_isError(remaining)
+            || target->write(out.constData(), o.pos) != (qint64) o.pos) {
+          ok = false;
+          break;
+        }
+      } while (mode == ZSTD_e_end ? remaining != 0 : in.pos < in.size);
+    }
+
+    ZSTD_freeCCtx(ctx);
+    return ok;
+#else
+    return false;
+#endif
+  }
+
+  QQueue<QByteArray> chunks;
+  QWaitCondition dequeued;
+  bool failed;
+  bool finishing;
+  CompressionDevice::Format format;
+  int level;
+  QMutex mutex;
+  QWaitCondition queued;
+  QIODevice *target;
+};
+
+/**
+ * @param level
+ *    compression level, -1 for the format's default
+ */
+CompressionDevice::CompressionDevice(QIODevice *target, Format format,
+                                     int level, QObject *parent)
+  : QIODevice(parent) {
+  this->target = target;
+  this->format = format;
+  this->level = level;
+  failed = false;
+  thread = NULL;
+}
+
+CompressionDevice::~CompressionDevice() {
+  close();
+}
+
+/**
+ * Compresses the remaining data and waits for the compression thread.
+ */
+void CompressionDevice::close() {
+  if (!isOpen()) {
+    return;
+  }
+
+  if (thread) {
+    if (!chunk.isEmpty()) {
+      thread->push(chunk);
+      chunk.clear();
+    }
+    thread->finish();
+    thread->wait();
+
+    if (thread->hasFailed()) {
+      failed = true;
+      setErrorString(tr("Unable to compress the data"));
+    }
+
+    delete thread;
+    thread = NULL;
+  }
+
+  QIODevice::close();
+}
+
+bool CompressionDevice::isSupported(Format format) {
+#ifdef HAVE_ZSTD
+  return true;
+#else
+  return format != Zstd;
+#endif
+}
+
+bool CompressionDevice::open(OpenMode mode) {
+  if ((mode & ReadOnly) || !isSupported(format) || format == NoCompression) {
+    return false;
+  }
+
+  thread = new CompressionThread(target, format, level);
+  thread->start();
+  chunk.reserve(ChunkSize);
+
+  return QIODevice::open(mode);
+}
+
+qint64 CompressionDevice::readData(char *data, qint64 maxSize) {
+  Q_UNUSED(data);
+  Q_UNUSED(maxSize);
+  return -1;
+}
+
+/**
+ * @return the file name suffix for the format, e.g. ".gz"
+ */
+QString CompressionDevice::suffix(Format format) {
+  switch (format) {
+  case Gzip:
+    return ".gz";
+
+  case Zstd:
+    return ".zst";
+
+  default:
+    return "";
+  }
+}
+
+qint64 CompressionDevice::writeData(const char *data, qint64 size) {
+  if (thread->hasFailed()) {
+    failed = true;
+    return -1;
+  }
+
+  chunk.append(data, size);
+  if (chunk.size() >= ChunkSize) {
+    thread->push(chunk);
+    chunk = QByteArray();
+    chunk.reserve(ChunkSize);
+  }
+
+  return size;
+}
@@ -0,0 +1,54 @@
+#ifndef COMPRESSIONDEVICE_H
+#define COMPRESSIONDEVICE_H
+
+#include <QByteArray>
+#include <QIODevice>
+
+class CompressionThread;
+
+/**
+ * Write-only device compressing what is written to it into another device.
+ *
+ * Data is gathered in chunks of ChunkSize bytes, which are compressed and
+ * written by a separate thread : formatting the rows and compressing them run
+ * in parallel. At most MaxPendingChunks chunks wait for the compression
+ * thread, writes block beyond that.
+ */
+class CompressionDevice : public QIODevice {
+Q_OBJECT
+public:
+  enum Format {
+    NoCompression,
+    Gzip,
+    Zstd
+  };
+
+  CompressionDevice(QIODevice *target, Format format, int level = -1,
+                    QObject *parent = 0);
+  ~CompressionDevice();
+
+  void close();
+  bool hasFailed() { return failed; };
+  bool isSequential() const { return true; };
+  bool open(OpenMode mode);
+
+  static bool isSupported(Format format);
+  static QString suffix(Format format);
+
+  static const int ChunkSize = 1024 * 1024;
+  static const int MaxPendingChunks = 4;
+
+protected:
+  qint64 readData(char *data, qint64 maxSize);
+  qint64 writeData(const char *data, qint64 size);
+
+private:
+  QByteArray chunk;
+  bool failed;
+  Format format;
+  int level;
+  QIODevice *target;
+  CompressionThread *thread;
+};
+
+#endif // COMPRESSIONDEVICE_H
@@ -0,0 +1,415 @@
+#include "csvtokenizer.h"
+
+#include <QRunnable>
+#include <QThread>
+#include <QtAlgorithms>
+
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define CSV_SSE2 __attribute__((target("sse2")))
+#define CSV_AVX2 __attribute__((target("avx2")))
+#elif defined(_M_X64)
+#define CSV_SSE2
+#endif
+
+#ifdef CSV_SSE2
+#include <immintrin.h>
+#endif
+
+static qint64 countScalar(const char *p, const char *end, char c) {
+  qint64 n = 0;
+  for (; p < end; p++) {
+    n += *p == c;
+  }
+  return n;
+}
+
+/**
+ * First occurrence of a or b, end if there is none.
+ */
+static const char* find2Scalar(const char *p, const char *end, char a, char b) {
+  for (; p < end; p++) {
+    if (*p == a || *p == b) {
+      return p;
+    }
+  }
+  return end;
+}
+
+#ifdef CSV_SSE2
+CSV_SSE2
+static qint64 countSse2(const char *p, const char *end, char c) {
+  const __m128i vc = _mm_set1_epi8(c);
+  qint64 n = 0;
+  for (; end - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    n += qPopulationCount((quint32) _mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)));
+  }
+  return n + countScalar(p, end, c);
+}
+
+CSV_SSE2
+static const char* find2Sse2(const char *p, const char *end, char a, char b) {
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  for (; end - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    quint32 mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va),
+                                                  _mm_cmpeq_epi8(v, vb)));
+    if (mask) {
+      return p + qCountTrailingZeroBits(mask);
+    }
+  }
+  return find2Scalar(p, end, a, b);
+}
+#endif
+
+#ifdef CSV_AVX2
+CSV_AVX2
+static qint64 countAvx2(const char *p, const char *end, char c) {
+  const __m256i vc = _mm256_set1_epi8(c);
+  qint64 n = 0;
+  for (; end - p >= 32; p += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) p);
+    n += qPopulationCount(
+          (quint32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vc)));
+  }
+  return n + countScalar(p, end, c);
+}
+
+CSV_AVX2
+static const char* find2Avx2(const char *p, const char *end, char a, char b) {
+  const __m256i va = _mm256_set1_epi8(a);
+  const __m256i vb = _mm256_set1_epi8(b);
+  for (; end - p >= 32; p += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) p);
+    quint32 mask = _mm256_movemask_epi8(
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+    if (mask) {
+      return p + qCountTrailingZeroBits(mask);
+    }
+  }
+  return find2Scalar(p, end, a, b);
+}
+#endif
+
+/**
+ * Counts the quotes of a part of the data, or tokenizes a slice, on the pool
+ * of the tokenizer.
+ */
+class CsvSliceTask : public QRunnable {
+public:
+  CsvSliceTask(const CsvTokenizer *tokenizer, const char *data,
+               qint64 begin, qint64 end, CsvTokenizer::Records *records,
+               qint64 *quotes) {
+    this->tokenizer = tokenizer;
+    this->data = data;
+    this->begin = begin;
+    this->end = end;
+    this->records = records;
+    this->quotes = quotes;
+  }
+
+  void run() {
+    if (records) {
+      tokenizer->tokenizeSlice(data, begin, end, records);
+    } else {
+      *quotes = tokenizer->count(data + begin, data + end, tokenizer->quote);
+    }
+  }
+
+private:
+  const CsvTokenizer *tokenizer;
+  const char *data;
+  qint64 begin;
+  qint64 end;
+  CsvTokenizer::Records *records;
+  qint64 *quotes;
+};
+
+/**
+ * @param quote
+ *    0 if the fields are never quoted
+ * @param threads
+ *    threads tokenizing large data, -1 for one per core
+ */
+CsvTokenizer::CsvTokenizer(char separator, char quote, int threads) {
+  this->separator = separator;
+  this->quote = quote;
+  this->threads = threads > 0 ? threads : QThread::idealThreadCount();
+  this->threads = qMax(1, this->threads);
+
+  pool = new QThreadPool();
+  pool->setMaxThreadCount(this->threads);
+
+  switch (instructions()) {
+#ifdef CSV_AVX2
+  case Avx2:
+    count = countAvx2;
+    find2 = find2Avx2;
+    break;
+#endif
+#ifdef CSV_SSE2
+  case Sse2:
+    count = countSse2;
+    find2 = find2Sse2;
+    break;
+#endif
+  default:
+    count = countScalar;
+    find2 = find2Scalar;
+  }
+}
+
+CsvTokenizer::~CsvTokenizer() {
+  delete pool;
+}
+
+/**
+ * Length of the complete records : up to the last line break outside quotes.
+ *
+ * @param inQuotes
+ *    the data ends inside a quoted field
+ */
+qint64 CsvTokenizer::completeLength(const char *data, qint64 size,
+                                    bool inQuotes) const {
+  for (qint64 i=size-1; i>=0; i--) {
+    if (quote && data[i] == quote) {
+      inQuotes = !inQuotes;
+    } else if (data[i] == '\n' && !inQuotes) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * The instructions used to search the data : the widest supported by the
+ * processor.
+ */
+CsvTokenizer::Instructions CsvTokenizer::instructions() {
+#if defined(CSV_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return Sse2;
+  }
+#elif defined(CSV_SSE2)
+  return Sse2;
+#endif
+  return Scalar;
+}
+
+/**
+ * Position following the first line break outside quotes, end if there is
+ * none.
+ *
+ * @param inQuotes
+ *    p is inside a quoted field
+ */
+const char* CsvTokenizer::nextBoundary(const char *p, const char *end,
+                                       bool inQuotes) const {
+  if (!quote) {
+    p = (const char*) memchr(p, '\n', end - p);
+    return p ? p + 1 : end;
+  }
+
+  forever {
+    p = find2(p, end, quote, '\n');
+    if (p == end) {
+      return end;
+    }
+    if (*p == quote) {
+      inQuotes = !inQuotes;
+    } else if (!inQuotes) {
+      return p + 1;
+    }
+    p++;
+  }
+}
+
+/**
+ * Tokenizes data beginning with a record, in parallel when it is large enough.
+ *
+ * @param final
+ *    the data ends the input : its last record may lack a line break
+ * @param slices
+ *    records of each slice, in order
+ *
+ * @return length of the data tokenized : up to the end of its last complete
+ *    record, or all of it if final. 0 if it holds no complete record.
+ */
+qint64 CsvTokenizer::tokenize(const char *data, qint64 size, bool final,
+                              QVector<Records> &slices) {
+  int parts = (int) qBound((qint64) 1, size / MinSliceSize, (qint64) threads);
+
+  // quotes of each part, for the quoting state at its beginning
+  QVector<qint64> quotes(parts, 0);
+  if (quote && (parts > 1 || !final)) {
+    for (int i=0; i<parts; i++) {
+      pool->start(new CsvSliceTask(this, data, i * size / parts,
+                                   (i + 1) * size / parts, NULL, &quotes[i]));
+    }
+    pool->waitForDone();
+  }
+
+  qint64 length = size;
+  if (!final) {
+    qint64 total = 0;
+    foreach (qint64 q, quotes) {
+      total += q;
+    }
+    length = completeLength(data, size, total % 2 == 1);
+    if (length == 0) {
+      slices.clear();
+      return 0;
+    }
+  }
+
+  // each slice begins at the first record of a part
+  QVector<qint64> starts;
+  starts << 0;
+  bool inQuotes = false;
+  for (int i=1; i<parts; i++) {
+    inQuotes ^= quotes[i - 1] % 2 == 1;
+    qint64 part = i * size / parts;
+    if (part >= length) {
+      break;
+    }
+    qint64 start = nextBoundary(data + part, data + length, inQuotes) - data;
+    if (start >= length) {
+      break;
+    }
+    if (start > starts.last()) {
+      starts << start;
+    }
+  }
+  starts << length;
+
+  slices.resize(starts.size() - 1);
+  if (slices.size() == 1) {
+    tokenizeSlice(data, 0, length, &slices[0]);
+  } else {
+    for (int i=0; i<slices.size(); i++) {
+      pool->start(new CsvSliceTask(this, data, starts[i], starts[i + 1],
+                                   &slices[i], NULL));
+    }
+    pool->waitForDone();
+  }
+
+  return length;
+}
+
+/**
+ * Splits [begin, end) into records. It begins with a record, and ends after a
+ * line break or at the end of the data.
+ *
+ * As when the file is read as a stream, a quote is only special at the
+ * beginning of a field, and the '\r' of a CRLF line break is dropped. A blank
+ * line is a record with a single empty field.
+ */
+void CsvTokenizer::tokenizeSlice(const char *data, qint64 begin, qint64 end,
+                                 Records *out) const {
+  out->ends.clear();
+  out->fields.clear();
+  out->fields.reserve((int) ((end - begin) / 16));
+  out->unterminated = false;
+
+  const char *p = data + begin;
+  const char *last = data + end;
+
+  while (p < last) {
+    forever {
+      Field f;
+      f.flags = 0;
+      const char *start = p;
+
+      if (quote && p < last && *p == quote) {
+        f.flags = Quoted;
+        p++;
+        forever {
+          p = (const char*) memchr(p, quote, last - p);
+          if (!p) {
+            out->unterminated = true;
+            p = last;
+            break;
+          }
+          p++;
+          if (p < last && *p == quote) {
+            f.flags |= Escaped;
+            p++;
+          } else {
+            break;
+          }
+        }
+
+        // characters following the closing quote are kept
+        const char *next = find2(p, last, separator, '\n');
+        if (next - p > 1 || (next - p == 1 && *p != '\r')) {
+          f.flags |= Escaped;
+        }
+        p = next;
+      } else {
+        p = find2(p, last, separator, '\n');
+      }
+
+      f.offset = start - data;
+      f.size = (int) (p - start);
+      if ((p == last || *p == '\n') && f.size > 0 && p[-1] == '\r'
+          && !out->unterminated) {
+        f.size--;
+      }
+      out->fields << f;
+
+      if (p < last && *p == separator) {
+        p++;
+      } else {
+        break;
+      }
+    }
+
+    out->ends << out->fields.size();
+    // the line break
+    p++;
+  }
+}
+
+/**
+ * Text of a field, decoded from UTF-8. An empty field is NULL, unless it is
+ * quoted.
+ */
+QString CsvTokenizer::value(const char *data, const Field &field) const {
+  const char *p = data + field.offset;
+
+  if (!(field.flags & Quoted)) {
+    return field.size > 0 ? QString::fromUtf8(p, field.size) : QString();
+  }
+
+  QString text;
+  if (!(field.flags & Escaped)) {
+    text = QString::fromUtf8(p + 1, qMax(0, field.size - 2));
+  } else {
+    QByteArray raw;
+    raw.reserve(field.size);
+    bool inQuotes = true;
+    for (int i=1; i<field.size; i++) {
+      if (inQuotes && p[i] == quote) {
+        if (i + 1 < field.size && p[i + 1] == quote) {
+          raw += quote;
+          i++;
+        } else {
+          inQuotes = false;
+        }
+      } else if (inQuotes || p[i] != '\r') {
+        raw += p[i];
+      }
+    }
+    text = QString::fromUtf8(raw);
+  }
+
+  return text.isNull() ? QString("") : text;
+}
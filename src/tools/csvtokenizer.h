@@ -0,0 +1,82 @@
+#ifndef CSVTOKENIZER_H
+#define CSVTOKENIZER_H
+
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+/**
+ * Splits CSV data into records and fields, without copying it : a field is a
+ * span of the data, e.g. of a memory-mapped file.
+ *
+ * Separators, quotes and line breaks are searched 32 bytes at a time with
+ * AVX2, 16 with SSE2, or one at a time when neither is available. The choice
+ * is made once, at run time.
+ *
+ * Large data is tokenized in parallel. It is cut into slices beginning at a
+ * record : a line break starts a record if an even number of quotes precedes
+ * it, so quotes must only enclose fields, as in RFC 4180.
+ */
+class CsvTokenizer {
+public:
+  enum Instructions {
+    Scalar,
+    Sse2,
+    Avx2
+  };
+
+  enum FieldFlag {
+    /** The field is enclosed in quotes, which are part of its span. */
+    Quoted    = 0x01,
+    /** Doubled quotes or characters after the closing quote, see value(). */
+    Escaped   = 0x02
+  };
+
+  struct Field {
+    /** From the beginning of the data. */
+    qint64 offset;
+    int size;
+    int flags;
+  };
+
+  /**
+   * The records of a slice. ends[i] is the index of the field following the
+   * last field of the record i.
+   */
+  struct Records {
+    QVector<int> ends;
+    QVector<Field> fields;
+    /** The data ends inside a quoted field. */
+    bool unterminated;
+  };
+
+  CsvTokenizer(char separator, char quote, int threads = -1);
+  ~CsvTokenizer();
+
+  qint64 tokenize(const char *data, qint64 size, bool final,
+                  QVector<Records> &slices);
+  QString value(const char *data, const Field &field) const;
+
+  static Instructions instructions();
+
+  /** Below it, the data is tokenized by a single thread. */
+  static const int MinSliceSize = 256 * 1024;
+
+private:
+  qint64 completeLength(const char *data, qint64 size, bool inQuotes) const;
+  const char* nextBoundary(const char *p, const char *end,
+                           bool inQuotes) const;
+  void tokenizeSlice(const char *data, qint64 begin, qint64 end,
+                     Records *out) const;
+
+  qint64 (*count)(const char *p, const char *end, char c);
+  const char* (*find2)(const char *p, const char *end, char a, char b);
+  QThreadPool *pool;
+  char quote;
+  char separator;
+  int threads;
+
+  friend class CsvSliceTask;
+};
+
+#endif // CSVTOKENIZER_H
@@ -0,0 +1,192 @@
+#include "sqlcompletion.h"
+
+#include <QtAlgorithms>
+
+static bool isName(const SqlToken &t) {
+  return t.type == SqlToken::Identifier || t.type == SqlToken::Table
+      || t.type == SqlToken::Field || t.type == SqlToken::DataType
+      || t.type == SqlToken::Function;
+}
+
+static bool isPunctuation(const QString &text, const SqlToken &t, QChar c) {
+  return t.type == SqlToken::Punctuation && text.at(t.position) == c;
+}
+
+void SqlCompletionIndex::add(QString name, SqlToken::Type type) {
+  Entry e;
+  e.key = name.toLower();
+  e.name = name;
+  e.type = type;
+  entries << e;
+}
+
+/**
+ * Names beginning with the prefix, ignoring the case, then the fuzzy matches
+ * among the first MaxFuzzyScan names if there are less than max.
+ */
+QStringList SqlCompletionIndex::complete(QString prefix, int max) const {
+  QString p = prefix.toLower();
+  QStringList ret;
+
+  for (int i=lowerBound(p); i<entries.size() && ret.size()<max; i++) {
+    if (!entries[i].key.startsWith(p)) {
+      break;
+    }
+    ret << entries[i].name;
+  }
+
+  if (ret.size() >= max || p.size() < 2) {
+    return ret;
+  }
+
+  // only the names beginning with the same character, the first ones
+  int begin = lowerBound(p.left(1));
+  int end = qMin(lowerBound(QString(QChar(p[0].unicode() + 1))),
+                 begin + MaxFuzzyScan);
+  for (int i=begin; i<end && ret.size()<max; i++) {
+    if (!entries[i].key.startsWith(p) && matches(entries[i].key, p, true)) {
+      ret << entries[i].name;
+    }
+  }
+
+  return ret;
+}
+
+bool SqlCompletionIndex::lessThan(const Entry &a, const Entry &b) {
+  return a.key < b.key || (a.key == b.key && a.type < b.type);
+}
+
+int SqlCompletionIndex::lowerBound(const QString &key) const {
+  Entry e;
+  e.key = key;
+  e.type = (SqlToken::Type) 0;
+  return qLowerBound(entries.begin(), entries.end(), e, lessThan)
+      - entries.begin();
+}
+
+/**
+ * @param key
+ *    lower case name
+ * @param pattern
+ *    lower case
+ * @param fuzzy
+ *    the pattern may skip characters of the name, but not the first one
+ */
+bool SqlCompletionIndex::matches(const QString &key, const QString &pattern,
+                                 bool fuzzy) {
+  if (key.startsWith(pattern)) {
+    return true;
+  }
+  if (!fuzzy || pattern.isEmpty() || key.isEmpty() || key[0] != pattern[0]) {
+    return false;
+  }
+
+  int k = 1;
+  for (int i=1; i<pattern.size(); i++) {
+    while (k < key.size() && key[k] != pattern[i]) {
+      k++;
+    }
+    if (k == key.size()) {
+      return false;
+    }
+    k++;
+  }
+  return true;
+}
+
+/**
+ * Sorts the names once they are all added. A name given several times, e.g.
+ * a column of several tables, is kept once.
+ */
+void SqlCompletionIndex::sort() {
+  qSort(entries.begin(), entries.end(), lessThan);
+
+  int j = 0;
+  for (int i=0; i<entries.size(); i++) {
+    if (j == 0 || entries[i].key != entries[j - 1].key) {
+      entries[j++] = entries[i];
+    }
+  }
+  entries.resize(j);
+}
+
+/**
+ * @param tokens
+ *    tokens of the text, e.g. of the lines around the cursor
+ * @param cursor
+ *    position in the text : only the statement around it is read
+ */
+void SqlScope::parse(const QString &text, const QVector<SqlToken> &tokens,
+                     int cursor) {
+  aliases.clear();
+  m_tables.clear();
+
+  QVector<SqlToken> words;
+  foreach (const SqlToken &t, tokens) {
+    if (isPunctuation(text, t, ';')) {
+      if (t.position >= cursor) {
+        break;
+      }
+      words.clear();
+    } else if (t.type != SqlToken::Comment) {
+      words << t;
+    }
+  }
+
+  bool expectTable = false;
+  bool inFrom = false;
+  int n = words.size();
+  for (int i=0; i<n; i++) {
+    const SqlToken &t = words[i];
+    QString word = text.mid(t.position, t.length);
+
+    if (t.type == SqlToken::Keyword) {
+      QString k = word.toUpper();
+      expectTable = k == "FROM" || k == "JOIN" || k == "UPDATE" || k == "INTO";
+      if (expectTable) {
+        inFrom = k == "FROM" || k == "JOIN";
+      } else if (k != "AS" && k != "INNER" && k != "OUTER" && k != "LEFT"
+                 && k != "RIGHT" && k != "FULL" && k != "CROSS"
+                 && k != "NATURAL") {
+        inFrom = false;
+      }
+      continue;
+    }
+
+    if (isPunctuation(text, t, ',')) {
+      expectTable = inFrom;
+      continue;
+    }
+
+    if (!expectTable || !isName(t)) {
+      expectTable = false;
+      continue;
+    }
+
+    // schema.table
+    QString name = word;
+    while (i + 2 < n && isPunctuation(text, words[i + 1], '.')
+           && isName(words[i + 2])) {
+      name += "." + text.mid(words[i + 2].position, words[i + 2].length);
+      i += 2;
+    }
+
+    int j = i + 1;
+    if (j < n && words[j].type == SqlToken::Keyword
+        && text.mid(words[j].position, words[j].length).toUpper() == "AS") {
+      j++;
+    }
+    if (j < n && isName(words[j])) {
+      aliases.insert(text.mid(words[j].position, words[j].length).toLower(),
+                     name);
+      i = j;
+    }
+
+    m_tables << name;
+    aliases.insert(name.toLower(), name);
+    if (!aliases.contains(name.section('.', -1).toLower())) {
+      aliases.insert(name.section('.', -1).toLower(), name);
+    }
+    expectTable = false;
+  }
+}
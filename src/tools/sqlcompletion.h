@@ -0,0 +1,67 @@
+#ifndef SQLCOMPLETION_H
+#define SQLCOMPLETION_H
+
+#include "sqllexer.h"
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Names offered by the completion, sorted without case for a binary search
+ * of the prefix.
+ *
+ * When the prefix matches few names, the names beginning with the same
+ * character and containing the other ones in order are added, e.g. "cstnm"
+ * for "customer_name". At most MaxFuzzyScan names are read for them, so that
+ * a large schema doesn't slow down the typing.
+ */
+class SqlCompletionIndex {
+public:
+  static const int MaxFuzzyScan = 5000;
+
+  void add(QString name, SqlToken::Type type);
+  QStringList complete(QString prefix, int max) const;
+  bool isEmpty() const { return entries.isEmpty(); };
+  void sort();
+
+  static bool matches(const QString &key, const QString &pattern, bool fuzzy);
+
+private:
+  struct Entry {
+    /** Lower case name. */
+    QString key;
+    QString name;
+    SqlToken::Type type;
+  };
+
+  int lowerBound(const QString &key) const;
+
+  static bool lessThan(const Entry &a, const Entry &b);
+
+  QVector<Entry> entries;
+};
+
+/**
+ * Tables of a statement and their aliases, read from its FROM and JOIN
+ * clauses, and from UPDATE and INSERT INTO.
+ */
+class SqlScope {
+public:
+  void parse(const QString &text, const QVector<SqlToken> &tokens,
+             int cursor);
+  /**
+   * Table named by an alias or by its own name, empty if there is none.
+   */
+  QString table(QString alias) const {
+    return aliases.value(alias.toLower());
+  };
+  QStringList tables() const { return m_tables; };
+
+private:
+  /** Lower case alias, table. */
+  QHash<QString, QString> aliases;
+  QStringList m_tables;
+};
+
+#endif // SQLCOMPLETION_H
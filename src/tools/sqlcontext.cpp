@@ -0,0 +1,53 @@
+#include "sqlcontext.h"
+
+/**
+ * @param tables
+ *    names of the tables, possibly prefixed with their schema
+ */
+SqlContext::SqlContext(QStringList tables,
+                       QMultiMap<QString, QString> fields) {
+  m_tables = tables;
+  m_fields = fields;
+
+  names.reserve(tables.size() + fields.size());
+  foreach (QString f, fields) {
+    names.insert(f.toLower(), SqlToken::Field);
+  }
+
+  // a word is a single part of schema.table
+  foreach (QString t, tables) {
+    names.insert(t.toLower(), SqlToken::Table);
+    names.insert(t.section('.', -1).toLower(), SqlToken::Table);
+    m_completion.add(t, SqlToken::Table);
+
+    // in the order of the table
+    QStringList c = fields.values(t);
+    for (int i=0; i<c.size()/2; i++) {
+      c.swap(i, c.size() - 1 - i);
+    }
+    columnsByTable.insert(t.toLower(), c);
+    if (!columnsByTable.contains(t.section('.', -1).toLower())) {
+      columnsByTable.insert(t.section('.', -1).toLower(), c);
+    }
+  }
+
+  foreach (QString f, fields) {
+    m_completion.add(f, SqlToken::Field);
+  }
+  m_completion.sort();
+}
+
+/**
+ * @return Table, Field, or Identifier if the word is unknown
+ */
+SqlToken::Type SqlContext::classify(const QStringRef &word) const {
+  return names.value(word.toString().toLower(), SqlToken::Identifier);
+}
+
+/**
+ * @param table
+ *    name of the table, with or without its schema, ignoring the case
+ */
+QStringList SqlContext::columns(QString table) const {
+  return columnsByTable.value(table.toLower());
+}
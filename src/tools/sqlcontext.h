@@ -0,0 +1,44 @@
+#ifndef SQLCONTEXT_H
+#define SQLCONTEXT_H
+
+#include "sqlcompletion.h"
+#include "sqllexer.h"
+
+#include <QHash>
+#include <QMultiMap>
+#include <QStringList>
+
+/**
+ * Tables and columns of a connection, as known by its editors.
+ *
+ * The names are indexed in a hash, ignoring the case, so that the highlighting
+ * classifies a word in constant time whatever the size of the schema. A
+ * context is immutable once built : the editors of a connection share one,
+ * see ContextService, and it may be read from other threads.
+ *
+ * The completion index of the names is built with the context, i.e. on the
+ * thread loading it.
+ */
+class SqlContext {
+public:
+  SqlContext(QStringList tables, QMultiMap<QString, QString> fields);
+
+  SqlToken::Type classify(const QStringRef &word) const;
+  QStringList columns(QString table) const;
+  const SqlCompletionIndex &completion() const { return m_completion; };
+  /** Columns of each table. */
+  QMultiMap<QString, QString> fields() const { return m_fields; };
+  QStringList tables() const { return m_tables; };
+
+private:
+  /** Columns of each table, by lower case name, with and without schema. */
+  QHash<QString, QStringList> columnsByTable;
+  /** Lower case names, tables take precedence over the columns. */
+  QHash<QString, SqlToken::Type> names;
+
+  SqlCompletionIndex m_completion;
+  QMultiMap<QString, QString> m_fields;
+  QStringList m_tables;
+};
+
+#endif // SQLCONTEXT_H
@@ -0,0 +1,224 @@
+#include "sqllexer.h"
+
+/**
+ * Symbol of a character in the trie, ignoring the case. -1 if no keyword
+ * contains it.
+ */
+static int symbol(ushort c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  }
+  if (c >= 'a' && c <= 'z') {
+    return c - 'a';
+  }
+  if (c >= '0' && c <= '9') {
+    return 26 + c - '0';
+  }
+  if (c == '_') {
+    return 36;
+  }
+  return -1;
+}
+
+static bool isWordChar(QChar c) {
+  ushort u = c.unicode();
+  if (u < 128) {
+    return symbol(u) >= 0 || u == '$';
+  }
+  return c.isLetterOrNumber();
+}
+
+static bool isDigit(QChar c) {
+  return c.unicode() >= '0' && c.unicode() <= '9';
+}
+
+/**
+ * Later lists take precedence for the words found in several of them.
+ */
+SqlLexer::SqlLexer(QStringList keywords, QStringList functions,
+                   QStringList types) {
+  // the root
+  next.fill(0, SymbolCount);
+  this->types << SqlToken::Identifier;
+
+  foreach (QString w, keywords) {
+    add(w, SqlToken::Keyword);
+  }
+  foreach (QString w, functions) {
+    add(w, SqlToken::Function);
+  }
+  foreach (QString w, types) {
+    add(w, SqlToken::DataType);
+  }
+}
+
+/**
+ * Words which can't be a single token, e.g. END-EXEC, are ignored.
+ */
+void SqlLexer::add(QString word, SqlToken::Type type) {
+  int node = 0;
+  foreach (QChar c, word.trimmed()) {
+    int s = symbol(c.unicode());
+    if (s < 0) {
+      return;
+    }
+
+    if (next[node * SymbolCount + s] == 0) {
+      if (types.size() > 0xffff) {
+        return;
+      }
+      next[node * SymbolCount + s] = types.size();
+      next.resize(next.size() + SymbolCount);
+      types << SqlToken::Identifier;
+    }
+    node = next[node * SymbolCount + s];
+  }
+
+  if (node > 0) {
+    types[node] = type;
+  }
+}
+
+SqlToken::Type SqlLexer::classify(const QString &word) const {
+  int node = 0;
+  foreach (QChar c, word) {
+    int s = symbol(c.unicode());
+    node = s < 0 ? 0 : next[node * SymbolCount + s];
+    if (node == 0) {
+      return SqlToken::Identifier;
+    }
+  }
+  return (SqlToken::Type) types[node];
+}
+
+/**
+ * @return position following the comment, n if it doesn't end on the line
+ */
+int SqlLexer::skipComment(const QChar *s, int i, int n, int *state) const {
+  for (; i + 1 < n; i++) {
+    if (s[i] == '*' && s[i + 1] == '/') {
+      *state = Normal;
+      return i + 2;
+    }
+  }
+  *state = InBlockComment;
+  return n;
+}
+
+/**
+ * A doubled quote doesn't end the string.
+ *
+ * @return position following the closing quote, n if it isn't on the line
+ */
+int SqlLexer::skipQuoted(const QChar *s, int i, int n, int *state) const {
+  QChar quote = *state == InSingleQuotes ? '\''
+                                         : *state == InDoubleQuotes ? '"' : '`';
+  for (; i < n; i++) {
+    if (s[i] == quote) {
+      if (i + 1 < n && s[i + 1] == quote) {
+        i++;
+      } else {
+        *state = Normal;
+        return i + 1;
+      }
+    }
+  }
+  return n;
+}
+
+/**
+ * @param state
+ *    state at the end of the previous line, Normal for the first one
+ *
+ * @return state at the end of the line
+ */
+int SqlLexer::tokenize(const QString &text, int state,
+                       QVector<SqlToken> &tokens) const {
+  tokens.resize(0);
+
+  const QChar *s = text.constData();
+  int n = text.size();
+  int i = 0;
+  SqlToken t;
+
+  // the end of a string or of a comment
+  if (state == InBlockComment) {
+    i = skipComment(s, 0, n, &state);
+    t.type = SqlToken::Comment;
+  } else if (state == InSingleQuotes || state == InDoubleQuotes
+             || state == InBackticks) {
+    i = skipQuoted(s, 0, n, &state);
+    t.type = SqlToken::String;
+  } else {
+    state = Normal;
+  }
+  if (i > 0) {
+    t.position = 0;
+    t.length = i;
+    tokens << t;
+  }
+
+  while (i < n) {
+    QChar c = s[i];
+    t.position = i;
+
+    if (c.isSpace()) {
+      i++;
+      continue;
+    }
+
+    if (c == '\'' || c == '"' || c == '`') {
+      state = c == '\'' ? InSingleQuotes
+                        : c == '"' ? InDoubleQuotes : InBackticks;
+      i = skipQuoted(s, i + 1, n, &state);
+      t.type = SqlToken::String;
+    } else if (c == '-' && i + 1 < n && s[i + 1] == '-') {
+      i = n;
+      t.type = SqlToken::Comment;
+    } else if (c == '/' && i + 1 < n && s[i + 1] == '*') {
+      i = skipComment(s, i + 2, n, &state);
+      t.type = SqlToken::Comment;
+    } else if (isDigit(c) || (c == '.' && i + 1 < n && isDigit(s[i + 1]))) {
+      while (i < n && isDigit(s[i])) {
+        i++;
+      }
+      if (i < n && s[i] == '.') {
+        i++;
+        while (i < n && isDigit(s[i])) {
+          i++;
+        }
+      }
+      // exponent
+      if (i + 1 < n && (s[i] == 'e' || s[i] == 'E')
+          && (isDigit(s[i + 1]) || ((s[i + 1] == '+' || s[i + 1] == '-')
+                                    && i + 2 < n && isDigit(s[i + 2])))) {
+        i += 2;
+        while (i < n && isDigit(s[i])) {
+          i++;
+        }
+      }
+      t.type = SqlToken::Number;
+    } else if (isWordChar(c) && c != '$') {
+      // the trie is walked while the word is read
+      int node = 0;
+      for (; i < n && isWordChar(s[i]); i++) {
+        if (node >= 0) {
+          int sym = symbol(s[i].unicode());
+          node = sym < 0 ? -1 : next[node * SymbolCount + sym];
+          if (node == 0) {
+            node = -1;
+          }
+        }
+      }
+      t.type = node > 0 ? (SqlToken::Type) types[node] : SqlToken::Identifier;
+    } else {
+      i++;
+      t.type = SqlToken::Punctuation;
+    }
+
+    t.length = i - t.position;
+    tokens << t;
+  }
+
+  return state;
+}
@@ -0,0 +1,72 @@
+#ifndef SQLLEXER_H
+#define SQLLEXER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct SqlToken {
+  enum Type {
+    Identifier,
+    Keyword,
+    Function,
+    DataType,
+    Number,
+    /** Also the identifiers quoted with " or `. */
+    String,
+    Comment,
+    /** Any other character but spaces, e.g. '.' or '('. */
+    Punctuation,
+    /** Identifiers known by a SqlContext, never set by the lexer. */
+    Table,
+    Field,
+    TypeCount
+  };
+
+  int position;
+  int length;
+  Type type;
+};
+
+/**
+ * Splits a line of SQL into tokens in a single pass, for the highlighting.
+ *
+ * Words are looked up in a trie of the keywords, functions and types while
+ * they are read, ignoring the case. Strings, quoted identifiers and block
+ * comments may span several lines : the state at the end of a line is passed
+ * when tokenizing the next one.
+ *
+ * A lexer is immutable once built, it may be shared by several editors and
+ * threads.
+ */
+class SqlLexer {
+public:
+  enum State {
+    Normal          = 0,
+    InSingleQuotes  = 1,
+    InBlockComment  = 2,
+    InDoubleQuotes  = 3,
+    InBackticks     = 4
+  };
+
+  SqlLexer(QStringList keywords, QStringList functions, QStringList types);
+
+  SqlToken::Type classify(const QString &word) const;
+  int tokenize(const QString &text, int state,
+               QVector<SqlToken> &tokens) const;
+
+private:
+  void add(QString word, SqlToken::Type type);
+  int skipComment(const QChar *s, int i, int n, int *state) const;
+  int skipQuoted(const QChar *s, int i, int n, int *state) const;
+
+  /** Children of each node, by symbol. 0 if there is none. */
+  QVector<quint16> next;
+  /** Type of the word ending at each node, Identifier if none does. */
+  QVector<uchar> types;
+
+  /** A-Z, 0-9 and _ */
+  static const int SymbolCount = 37;
+};
+
+#endif // SQLLEXER_H
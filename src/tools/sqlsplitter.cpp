@@ -0,0 +1,275 @@
+#include "sqlsplitter.h"
+
+static bool isWordChar(QChar c) {
+  return c.isLetterOrNumber() || c == '_' || c == '$';
+}
+
+SqlSplitter::SqlSplitter(QString driverName) {
+  bool mysql = driverName.startsWith("QMYSQL");
+  bool psql = driverName == "QPSQL";
+  bool sqlite = driverName.startsWith("QSQLITE");
+
+  backslashEscapes = mysql;
+  backticks = mysql || sqlite;
+  brackets = sqlite || driverName == "QODBC" || driverName == "QTDS";
+  dollarQuotes = psql;
+  hashComments = mysql;
+  nestedComments = psql;
+}
+
+/**
+ * @return position following the comment starting at i
+ */
+int SqlSplitter::skipBlockComment(const QString &script, int i, int &line) {
+  int depth = 0;
+  int n = script.size();
+  while (i < n) {
+    if (script[i] == '/' && i + 1 < n && script[i + 1] == '*') {
+      if (depth == 0 || nestedComments) {
+        depth++;
+      }
+      i += 2;
+    } else if (script[i] == '*' && i + 1 < n && script[i + 1] == '/') {
+      depth--;
+      i += 2;
+      if (depth == 0) {
+        return i;
+      }
+    } else {
+      if (script[i] == '\n') {
+        line++;
+      }
+      i++;
+    }
+  }
+
+  return n;
+}
+
+/**
+ * $tag$ ... $tag$, the tag may be empty.
+ *
+ * @return position following the string starting at i, or i if there is no
+ *    dollar quote there
+ */
+int SqlSplitter::skipDollarQuote(const QString &script, int i, int &line) {
+  int n = script.size();
+
+  // $1 is a parameter, a$b an identifier
+  if (i > 0 && isWordChar(script[i - 1])) {
+    return i;
+  }
+
+  int end = i + 1;
+  if (end < n && (script[end].isLetter() || script[end] == '_')) {
+    while (end < n && (script[end].isLetterOrNumber() || script[end] == '_')) {
+      end++;
+    }
+  }
+
+  if (end >= n || script[end] != '$') {
+    return i;
+  }
+
+  QString tag = script.mid(i, end - i + 1);
+  int close = script.indexOf(tag, end + 1);
+  if (close < 0) {
+    close = n;
+  } else {
+    close += tag.size();
+  }
+
+  line += script.midRef(i, close - i).count('\n');
+  return close;
+}
+
+/**
+ * A string or a quoted identifier. The closing character is escaped by
+ * doubling it.
+ *
+ * @return position following the closing character
+ */
+int SqlSplitter::skipQuoted(const QString &script, int i, QChar close,
+                            bool escapes, int &line) {
+  int n = script.size();
+  i++;
+  while (i < n) {
+    QChar c = script[i];
+    if (c == '\n') {
+      line++;
+    }
+
+    if (escapes && c == '\\') {
+      if (i + 1 < n && script[i + 1] == '\n') {
+        line++;
+      }
+      i += 2;
+    } else if (c == close) {
+      if (i + 1 < n && script[i + 1] == close) {
+        i += 2;
+      } else {
+        return i + 1;
+      }
+    } else {
+      i++;
+    }
+  }
+
+  return n;
+}
+
+QList<SqlStatement> SqlSplitter::split(QString script) {
+  QList<SqlStatement> statements;
+  QString delimiter = ";";
+
+  int n = script.size();
+  int line = 1;
+
+  SqlStatement current;
+  current.position = -1;
+  // BEGIN ... END nesting of a trigger or procedure body
+  bool compound = false;
+  int depth = 0;
+  int words = 0;
+
+  int i = 0;
+  while (i < n) {
+    QChar c = script[i];
+
+    if (c.isSpace()) {
+      if (c == '\n') {
+        line++;
+      }
+      i++;
+      continue;
+    }
+
+    // DELIMITER command of the MySQL client, between two statements
+    if (current.position < 0 && (c == 'd' || c == 'D')
+        && word(script, i).toUpper() == "DELIMITER") {
+      int end = script.indexOf('\n', i);
+      if (end < 0) {
+        end = n;
+      }
+      QString d = script.mid(i + 9, end - i - 9).trimmed();
+      if (!d.isEmpty()) {
+        delimiter = d;
+      }
+      i = end;
+      continue;
+    }
+
+    if (script.midRef(i, delimiter.size()) == delimiter
+        && (depth == 0 || delimiter != ";")) {
+      if (current.position >= 0) {
+        current.text = script.mid(current.position, i - current.position)
+            .trimmed();
+        statements << current;
+      }
+
+      current = SqlStatement();
+      current.position = -1;
+      compound = false;
+      depth = 0;
+      words = 0;
+      i += delimiter.size();
+      continue;
+    }
+
+    // comments before a statement are not part of it
+    int next = i;
+    if (c == '-' && i + 1 < n && script[i + 1] == '-') {
+      next = script.indexOf('\n', i);
+      if (next < 0) {
+        next = n;
+      }
+    } else if (c == '#' && hashComments) {
+      next = script.indexOf('\n', i);
+      if (next < 0) {
+        next = n;
+      }
+    } else if (c == '/' && i + 1 < n && script[i + 1] == '*') {
+      // MySQL's /*! ... */ are executed
+      if (!(hashComments && i + 2 < n && script[i + 2] == '!')) {
+        next = skipBlockComment(script, i, line);
+      }
+    }
+
+    if (next != i) {
+      i = next;
+      continue;
+    }
+
+    if (current.position < 0) {
+      current.position = i;
+      current.line = line;
+    }
+
+    if (c == '\'') {
+      // E'...' strings of PostgreSQL accept backslash escapes
+      bool escapes = backslashEscapes
+          || (dollarQuotes && i > 0 && (script[i - 1] == 'E'
+                                        || script[i - 1] == 'e')
+              && (i < 2 || !isWordChar(script[i - 2])));
+      i = skipQuoted(script, i, '\'', escapes, line);
+    } else if (c == '"') {
+      i = skipQuoted(script, i, '"', false, line);
+    } else if (c == '`' && backticks) {
+      i = skipQuoted(script, i, '`', false, line);
+    } else if (c == '[' && brackets) {
+      i = skipQuoted(script, i, ']', false, line);
+    } else if (c == '$' && dollarQuotes
+               && (next = skipDollarQuote(script, i, line)) != i) {
+      i = next;
+    } else if (c.isLetter() || c == '_') {
+      QString w = word(script, i).toUpper();
+      if (words++ == 0) {
+        current.keyword = w;
+      }
+
+      if (current.keyword == "CREATE" && words < 8
+          && (w == "TRIGGER" || w == "PROCEDURE" || w == "FUNCTION"
+              || w == "EVENT")) {
+        compound = true;
+      } else if (compound && (w == "BEGIN" || w == "CASE")) {
+        depth++;
+      } else if (compound && w == "END" && depth > 0) {
+        // END IF, END LOOP... close blocks that were not counted
+        int after = i + w.size();
+        while (after < n && script[after].isSpace()) {
+          after++;
+        }
+        QString closed = word(script, after).toUpper();
+        if (closed != "IF" && closed != "LOOP" && closed != "WHILE"
+            && closed != "REPEAT" && closed != "FOR") {
+          depth--;
+        }
+      }
+
+      i += w.size();
+    } else {
+      i++;
+    }
+  }
+
+  if (current.position >= 0) {
+    current.text = script.mid(current.position).trimmed();
+    if (!current.text.isEmpty()) {
+      statements << current;
+    }
+  }
+
+  return statements;
+}
+
+/**
+ * The word starting at i, empty if there is none.
+ */
+QString SqlSplitter::word(const QString &script, int i) {
+  int end = i;
+  while (end < script.size() && isWordChar(script[end])) {
+    end++;
+  }
+
+  return script.mid(i, end - i);
+}
@@ -0,0 +1,50 @@
+#ifndef SQLSPLITTER_H
+#define SQLSPLITTER_H
+
+#include <QList>
+#include <QString>
+
+struct SqlStatement {
+  /** First word, in upper case, e.g. INSERT. Empty if there is none. */
+  QString keyword;
+  /** Line of the first character, from 1. */
+  int line;
+  /** Position of the first character in the script. */
+  int position;
+  QString text;
+};
+
+/**
+ * Splits a script into statements.
+ *
+ * Delimiters are ignored inside strings, quoted identifiers and comments, and
+ * inside PostgreSQL's dollar-quoted strings. The DELIMITER command of the
+ * MySQL client changes the delimiter for the rest of the script; it is not a
+ * statement itself. With the default delimiter, the BEGIN ... END body of a
+ * CREATE TRIGGER or CREATE PROCEDURE is kept in one statement.
+ *
+ * The rules depending on the DBMS, e.g. backslash escapes in MySQL strings,
+ * are chosen from the Qt driver name.
+ */
+class SqlSplitter {
+public:
+  SqlSplitter(QString driverName = QString());
+
+  QList<SqlStatement> split(QString script);
+
+private:
+  int skipBlockComment(const QString &script, int i, int &line);
+  int skipDollarQuote(const QString &script, int i, int &line);
+  int skipQuoted(const QString &script, int i, QChar close, bool escapes,
+                 int &line);
+  QString word(const QString &script, int i);
+
+  bool backslashEscapes;
+  bool backticks;
+  bool brackets;
+  bool dollarQuotes;
+  bool hashComments;
+  bool nestedComments;
+};
+
+#endif // SQLSPLITTER_H
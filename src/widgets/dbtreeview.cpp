@@ -1,6 +1,7 @@
 #include "dbtreeview.h"
 
 #include "../dbmanager.h"
+#include "../iconmanager.h"
 #include "../mainwindow.h"
 
 DbTreeView::DbTreeView(QWidget *parent)
@@ -13,8 +14,7 @@ DbTreeView::DbTreeView(QWidget *parent)
 
   header()->setSectionResizeMode(0, QHeaderView::Stretch);
 
-  connect(this, SIGNAL(expanded(QModelIndex)),
-          this, SLOT(onItemExpanded(QModelIndex)));
+  importWizard = new ImportWizard(this);
 
   setupActions();
 }
@@ -42,6 +42,7 @@ void DbTreeView::contextMenuEvent(QContextMenuEvent *event)
 {
   addDbAct->setVisible(false);
   editDbAct->setVisible(false);
+  importAct->setVisible(false);
   removeDbAct->setVisible(false);
   toggleAct->setVisible(false);
   refreshAct->setEnabled(false);
@@ -65,8 +66,11 @@ void DbTreeView::contextMenuEvent(QContextMenuEvent *event)
       case DbManager::FieldItem:
         break;
 
-      case DbManager::SysTableItem:
       case DbManager::TableItem:
+        importAct->setVisible(true);
+        break;
+
+      case DbManager::SysTableItem:
       case DbManager::ViewItem:
         /// @todo table action
         break;
@@ -120,6 +124,24 @@ void DbTreeView::editCurrent() {
   }
 }
 
+/**
+ * Imports a file into the selected table.
+ */
+void DbTreeView::importCurrent() {
+  if (selectedIndexes().size() != 1) {
+    return;
+  }
+
+  QModelIndex index = selectedIndexes()[0];
+  QString table = index.data(Qt::ToolTipRole).toString();
+  if (table.startsWith("public.")) {
+    table = table.mid(7);
+  }
+
+  importWizard->setTable(parentConnection(index)->db(), table);
+  importWizard->exec();
+}
+
 bool DbTreeView::isDbSelected() {
   if (selectedIndexes().size() == 1) {
     return parentConnection(selectedIndexes()[0]);
@@ -182,12 +204,6 @@ void DbTreeView::mousePressEvent(QMouseEvent *event) {
   }
 }
 
-void DbTreeView::onItemExpanded(const QModelIndex &index) {
-  if (index.data(Qt::UserRole).canConvert(QVariant::Int)) {
-    DbManager::instance->refreshModelIndex(index);
-  }
-}
-
 /**
  * Prise en charge de la modification du modèle
  */
@@ -255,6 +271,11 @@ void DbTreeView::setupActions()
   editDbAct->setText(tr("Edit"));
   connect(editDbAct, SIGNAL(triggered()), this, SLOT(editCurrent()));
 
+  importAct = new QAction(this);
+  importAct->setText(tr("Import..."));
+  importAct->setIcon(IconManager::get("document-open"));
+  connect(importAct, SIGNAL(triggered()), this, SLOT(importCurrent()));
+
   refreshAct = new QAction(this);
   refreshAct->setText(tr("Refresh"));
   refreshAct->setShortcut(QKeySequence(Qt::ShiftModifier + Qt::Key_F5));
@@ -274,6 +295,7 @@ void DbTreeView::setupActions()
   contextMenu->addAction(addDbAct);
   contextMenu->addAction(editDbAct);
   contextMenu->addAction(removeDbAct);
+  contextMenu->addAction(importAct);
 }
 
 void DbTreeView::toggleCurrentDb() {
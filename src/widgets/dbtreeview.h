@@ -3,6 +3,7 @@
 
 #include "db/connection.h"
 #include "dialogs/dbdialog.h"
+#include "wizards/importwizard.h"
 #include "wizards/newdbwizard.h"
 
 #include <QtWidgets/QTreeView>
@@ -25,6 +26,7 @@ public slots:
   void connectCurrent();
   void disconnectCurrent();
   void editCurrent();
+  void importCurrent();
   void refreshCurrent();
 
 private:
@@ -39,6 +41,8 @@ private:
   QMenu *contextMenu;
   QAction *addDbAct;
   QAction *editDbAct;
+  QAction *importAct;
+  ImportWizard *importWizard;
   QAction *openTableAct;
   QAbstractItemModel *model;
   QAction *refreshAct;
@@ -47,7 +51,6 @@ private:
 
 private slots:
   void addDatabase();
-  void onItemExpanded(const QModelIndex &index);
   void on_model_dataChanged(const QModelIndex & topLeft,
                             const QModelIndex & bottomRight);
   void removeCurrent();
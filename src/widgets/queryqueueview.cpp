@@ -0,0 +1,50 @@
+#include "queryqueueview.h"
+
+#include "../db/queryscheduler.h"
+#include "../iconmanager.h"
+
+#include <QContextMenuEvent>
+#include <QHeaderView>
+
+QueryQueueView::QueryQueueView(QWidget *parent)
+  : QTableView(parent) {
+  setModel(QueryScheduler::instance);
+  setSelectionBehavior(QAbstractItemView::SelectRows);
+  setSelectionMode(QAbstractItemView::SingleSelection);
+  setAlternatingRowColors(true);
+  setWordWrap(false);
+  verticalHeader()->hide();
+  horizontalHeader()->setSectionResizeMode(QueryScheduler::QueryColumn,
+                                           QHeaderView::Stretch);
+
+  cancelAct = new QAction(this);
+  cancelAct->setText(tr("Cancel"));
+  cancelAct->setIcon(IconManager::get("stop"));
+  connect(cancelAct, SIGNAL(triggered()), this, SLOT(cancelCurrent()));
+
+  clearAct = new QAction(this);
+  clearAct->setText(tr("Clear finished"));
+  clearAct->setIcon(IconManager::get("edit-clear"));
+  connect(clearAct, SIGNAL(triggered()),
+          QueryScheduler::instance, SLOT(clearFinished()));
+
+  contextMenu = new QMenu(this);
+  contextMenu->addAction(cancelAct);
+  contextMenu->addAction(clearAct);
+}
+
+void QueryQueueView::cancelCurrent() {
+  QModelIndexList rows = selectionModel()->selectedRows();
+  if (rows.size() != 1) {
+    return;
+  }
+
+  QueryScheduler::instance->cancel(
+        QueryScheduler::instance->taskId(rows[0].row()));
+}
+
+void QueryQueueView::contextMenuEvent(QContextMenuEvent *event) {
+  cancelAct->setEnabled(selectionModel()->selectedRows().size() == 1);
+  contextMenu->popup(event->globalPos());
+  event->accept();
+}
@@ -0,0 +1,28 @@
+#ifndef QUERYQUEUEVIEW_H
+#define QUERYQUEUEVIEW_H
+
+#include <QAction>
+#include <QMenu>
+#include <QtWidgets/QTableView>
+
+/**
+ * Queries of the QueryScheduler : pending, running and finished, with their
+ * waiting and running times.
+ */
+class QueryQueueView : public QTableView {
+Q_OBJECT
+public:
+  QueryQueueView(QWidget *parent = 0);
+
+public slots:
+  void cancelCurrent();
+
+private:
+  void contextMenuEvent(QContextMenuEvent *event);
+
+  QAction *cancelAct;
+  QAction *clearAct;
+  QMenu *contextMenu;
+};
+
+#endif // QUERYQUEUEVIEW_H
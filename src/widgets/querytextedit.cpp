@@ -8,12 +8,20 @@
 
 #include <QKeyEvent>
 #include <QScrollBar>
+#include <QTextBlock>
 #include <QTextDocumentFragment>
 
+SqlCompletionIndex QueryTextEdit::keywordIndex;
+
+static bool isWordChar(QChar c) {
+  return c.isLetterOrNumber() || c == '_' || c == '$';
+}
+
 QueryTextEdit::QueryTextEdit(QWidget *parent)
     : QTextEdit(parent)
 {
   syntax = new SqlHighlighter(this);
+  completionLength = 0;
 
   connect(MainWindow::instance, SIGNAL(indentationChanged()),
           this, SLOT(updateTabSize()));
@@ -32,6 +40,80 @@ void QueryTextEdit::cleanTables()
 
 }
 
+/**
+ * Names completing the prefix, ignoring the case : the columns of the tables
+ * of the statement first, then the other tables and columns of the context,
+ * then the keywords.
+ *
+ * @param qualifier
+ *    words before the prefix, e.g. an alias : only the columns of its table,
+ *    or the tables of a schema, are given
+ */
+QStringList QueryTextEdit::completions(QString prefix, QString qualifier) const
+{
+  QString p = prefix.toLower();
+  SqlScope scope = scopeUnderCursor();
+  QStringList items;
+
+  if (!qualifier.isEmpty()) {
+    if (!context) {
+      return items;
+    }
+
+    QString table = scope.table(qualifier);
+    QStringList columns = context->columns(table.isEmpty() ? qualifier : table);
+    // prefix matches first
+    foreach (QString c, columns) {
+      if (c.toLower().startsWith(p)) {
+        items << c;
+      }
+    }
+    foreach (QString c, columns) {
+      if (!c.toLower().startsWith(p)
+          && SqlCompletionIndex::matches(c.toLower(), p, true)) {
+        items << c;
+      }
+    }
+
+    // tables of a schema
+    if (items.isEmpty()) {
+      QString q = qualifier.toLower() + ".";
+      foreach (QString t, context->completion().complete(q + prefix,
+                                                         MaxCompletions)) {
+        if (t.toLower().startsWith(q)) {
+          items << t.mid(q.size());
+        }
+      }
+    }
+    return items.mid(0, MaxCompletions);
+  }
+
+  if (context) {
+    foreach (QString t, scope.tables()) {
+      foreach (QString c, context->columns(t)) {
+        if (c.toLower().startsWith(p)) {
+          items << c;
+        }
+      }
+    }
+    items << context->completion().complete(prefix, MaxCompletions);
+  }
+  items << keywordIndex.complete(prefix, MaxCompletions);
+
+  QStringList ret;
+  QSet<QString> seen;
+  foreach (QString i, items) {
+    if (ret.size() == MaxCompletions) {
+      break;
+    }
+    if (!seen.contains(i.toLower())) {
+      seen.insert(i.toLower());
+      ret << i;
+    }
+  }
+  return ret;
+}
+
 void QueryTextEdit::focusInEvent(QFocusEvent *e)
 {
   completer->setWidget(this);
@@ -119,7 +201,8 @@ void QueryTextEdit::keyPressEvent(QKeyEvent *event) {
     QTextEdit::keyPressEvent(event);
   }
 
-  QString completionPrefix = textUnderCursor();
+  QString qualifier;
+  QString completionPrefix = wordBeforeCursor(&qualifier);
   if (event->key() == Qt::Key_Backspace && completer->popup()->isHidden()) {
     completer->popup()->hide();
     event->accept();
@@ -135,33 +218,39 @@ void QueryTextEdit::keyPressEvent(QKeyEvent *event) {
 
   bool hasModifier = (event->modifiers() != Qt::NoModifier);
 
+  // the columns are shown right after "alias."
+  bool qualified = !qualifier.isEmpty();
+
   // if lastChar is not a letter, the popup will not be shown
   QChar lastChar;
   if(!completionPrefix.isEmpty())
     lastChar = completionPrefix.right(1).at(0);
+  else if (qualified)
+    lastChar = '.';
 
-//  bool followsTable = false;
-//  if (lastChar == '.') {
-//    QString table = completionPrefix.left(completionPrefix.length()-1);
-//    followsTable = tables.contains(table);
-//  }
-
-  bool allowedChar = lastChar.isLetterOrNumber() || lastChar == '_';
+  bool allowedChar = isWordChar(lastChar) || lastChar == '.';
 
   if (!isShortcut && (!allowedChar ||
                      hasModifier ||
                      event->text().isEmpty() ||
-                     completionPrefix.length() < Config::compCharCount)) {
+                     (!qualified &&
+                      completionPrefix.length() < Config::compCharCount))) {
     completer->popup()->hide();
     return;
   }
 
-  if (completionPrefix != completer->completionPrefix()) {
-    completer->setCompletionPrefix(completionPrefix);
-    completer->popup()->setCurrentIndex(
-        completer->completionModel()->index(0,0));
+  // the model only holds the few matches, it is not filtered again
+  QStringList items = completions(completionPrefix, qualifier);
+  if (items.isEmpty()) {
+    completer->popup()->hide();
+    return;
   }
 
+  completionLength = completionPrefix.length();
+  completerContextModel->setStringList(items);
+  completer->popup()->setCurrentIndex(
+      completer->completionModel()->index(0,0));
+
   QRect cr = cursorRect();
   cr.setWidth(completer->popup()->sizeHintForColumn(0) +
               completer->popup()->verticalScrollBar()->width());
@@ -175,9 +264,9 @@ void QueryTextEdit::insertCompletion(QString text)
     return;
 
   QTextCursor tc = textCursor();
-  tc.select(QTextCursor::WordUnderCursor);
-  tc.removeSelectedText();
-  tc.insertHtml(text);
+  tc.movePosition(QTextCursor::Left, QTextCursor::KeepAnchor,
+                  completionLength);
+  tc.insertText(text);
 }
 
 void QueryTextEdit::insertFromMimeData(const QMimeData *source) {
@@ -187,37 +276,40 @@ void QueryTextEdit::insertFromMimeData(const QMimeData *source) {
 void QueryTextEdit::reloadCompleter()
 {
   SqlHighlighter::reloadKeywords();
+
+  keywordIndex = SqlCompletionIndex();
+  foreach (QString k, SqlHighlighter::sqlKeywordList()) {
+    keywordIndex.add(k, SqlToken::Keyword);
+  }
+  foreach (QString f, SqlHighlighter::sqlFunctionList()) {
+    keywordIndex.add(f, SqlToken::Function);
+  }
+  foreach (QString t, SqlHighlighter::sqlTypeList()) {
+    keywordIndex.add(t, SqlToken::DataType);
+  }
+  keywordIndex.sort();
 }
 
-void QueryTextEdit::reloadContext(QStringList tables,
-                                  QMultiMap<QString, QString> fields)
+/**
+ * @param context
+ *    tables and columns of the connection, shared by its editors. Null if
+ *    there is none.
+ */
+void QueryTextEdit::reloadContext(QSharedPointer<const SqlContext> context)
 {
   if(!Config::editorSemantic)
     return;
 
-  this->tables = tables;
-
   // The syntax highlighting must reload the context too
-  syntax->reloadContext(tables, fields);
-
-  // collects all items to show
-  QStringList items = tables;
-  items << fields.values();
+  syntax->setContext(context);
 
-  items << SqlHighlighter::sqlFunctionList();
-  items << SqlHighlighter::sqlKeywordList();
-  items << SqlHighlighter::sqlTypeList();
-
-  // cleaning and sorting
-  items.removeDuplicates();
-
-  QMap<QString, QString> m;
-  foreach(QString i, items)
-    m.insert(i.toLower(), i);
-
-  items = m.values();
-  completerContextModel->setStringList(items);
-  completer->setModel(completerContextModel);
+  // the completion reads its index when a key is pressed
+  this->context = context;
+  if (context) {
+    tables = context->tables();
+  } else {
+    tables.clear();
+  }
 }
 
 /**
@@ -246,13 +338,70 @@ void QueryTextEdit::scanTables()
   }
 }
 
+/**
+ * Tables of the statement under the cursor. At most ScopeLines lines are
+ * tokenized on each side of the cursor, up to the lines ending the statement.
+ */
+SqlScope QueryTextEdit::scopeUnderCursor() const
+{
+  SqlScope scope;
+  QSharedPointer<SqlLexer> lexer = SqlHighlighter::sqlLexer();
+  if (!lexer) {
+    return scope;
+  }
+
+  QTextCursor tc = textCursor();
+  QTextBlock first = tc.block();
+  for (int i=0; i<ScopeLines && first.previous().isValid()
+       && !first.text().contains(';'); i++) {
+    first = first.previous();
+  }
+  QTextBlock last = tc.block();
+  for (int i=0; i<ScopeLines && last.next().isValid()
+       && !last.text().contains(';'); i++) {
+    last = last.next();
+  }
+
+  // the highlighter state of the previous line, e.g. inside a comment
+  int state = first.previous().isValid() ? first.previous().userState()
+                                         : SqlLexer::Normal;
+  if (state < 0) {
+    state = SqlLexer::Normal;
+  }
+
+  QString text;
+  QVector<SqlToken> tokens;
+  QVector<SqlToken> line;
+  int cursor = 0;
+  for (QTextBlock b = first; b.isValid(); b = b.next()) {
+    int offset = text.size();
+    if (b == tc.block()) {
+      cursor = offset + tc.positionInBlock();
+    }
+
+    state = lexer->tokenize(b.text(), state, line);
+    foreach (SqlToken t, line) {
+      t.position += offset;
+      tokens << t;
+    }
+    text += b.text() + '\n';
+
+    if (b == last) {
+      break;
+    }
+  }
+
+  scope.parse(text, tokens, cursor);
+  return scope;
+}
+
 void QueryTextEdit::setupCompleter()
 {
   completer = new QCompleter(this);
   completer->setCaseSensitivity(Qt::CaseInsensitive);
   completer->setWrapAround(false);
   completer->setWidget(this);
-  completer->setCompletionMode(QCompleter::PopupCompletion);
+  completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
 
   connect(completer, SIGNAL(activated(QString)),
           this, SLOT(insertCompletion(QString)));
@@ -264,7 +413,7 @@ void QueryTextEdit::setupCompleter()
   completerContextModel = new QStringListModel(items, this);
   completer->setModel(completerContextModel);
 
-  reloadContext(QStringList(), QMultiMap<QString, QString>());
+  reloadContext(QSharedPointer<const SqlContext>());
 }
 
 void QueryTextEdit::tabIndent() {
@@ -338,6 +487,39 @@ QString QueryTextEdit::textUnderCursor() const
   return tc.selectedText();
 }
 
+/**
+ * The part of the word before the cursor.
+ *
+ * @param qualifier
+ *    set to the words and dots preceding it without the last dot, e.g.
+ *    "schema.t" for "schema.t.na", empty if there is none
+ */
+QString QueryTextEdit::wordBeforeCursor(QString *qualifier) const
+{
+  QTextCursor tc = textCursor();
+  QString line = tc.block().text().left(tc.positionInBlock());
+
+  int end = line.size();
+  while (end > 0 && isWordChar(line[end - 1])) {
+    end--;
+  }
+
+  int start = end;
+  while (start > 0 && line[start - 1] == '.') {
+    int i = start - 1;
+    while (i > 0 && isWordChar(line[i - 1])) {
+      i--;
+    }
+    if (i == start - 1) {
+      break;
+    }
+    start = i;
+  }
+
+  *qualifier = start < end ? line.mid(start, end - 1 - start) : QString();
+  return line.mid(end);
+}
+
 void QueryTextEdit::updateTabSize() {
   QFontMetrics metrics(font());
   setTabStopWidth(Config::editorTabSize * metrics.width(' '));
@@ -2,6 +2,7 @@
 #define QUERYTEXTEDIT_H
 
 #include "../sqlhighlighter.h"
+#include "../tools/sqlcompletion.h"
 
 #include <QCompleter>
 #include <QStringListModel>
@@ -11,24 +12,35 @@ Q_OBJECT
 public:
   QueryTextEdit(QWidget *parent=0);
 
-  void reloadContext(QStringList tables, QMultiMap<QString, QString> fields);
+  void reloadContext(QSharedPointer<const SqlContext> context);
   static void reloadCompleter();
 
+  static const int MaxCompletions = 100;
+  static const int ScopeLines = 100;
+
 protected:
   void insertFromMimeData(const QMimeData *source);
 
 private:
+  QStringList completions(QString prefix, QString qualifier) const;
   void focusInEvent(QFocusEvent *e);
   void keyPressEvent(QKeyEvent *e);
+  SqlScope scopeUnderCursor() const;
   void setupCompleter();
   QString textUnderCursor() const;
+  QString wordBeforeCursor(QString *qualifier) const;
 
   QCompleter *completer;
 
   QStringListModel *completerContextModel;
+  /** Characters replaced by the completion. */
+  int completionLength;
+  QSharedPointer<const SqlContext> context;
   QStringList tables;
   SqlHighlighter *syntax;
 
+  static SqlCompletionIndex keywordIndex;
+
 private slots:
   void cleanTables();
   void insertCompletion(QString text);
@@ -1,5 +1,7 @@
 #include "exportwizard.h"
 
+#include "../db/queryscheduler.h"
+#include "../dbmanager.h"
 #include "../iconmanager.h"
 #include "../plugins/exportengine.h"
 #include "../plugins/pluginmanager.h"
@@ -8,6 +10,9 @@
 #include <QDirModel>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QSqlField>
+#include <QSqlRecord>
+#include <QTimer>
 
 ExportWizard::ExportWizard(QWidget *parent)
   : QWizard(parent) {
@@ -15,6 +20,8 @@ ExportWizard::ExportWizard(QWidget *parent)
 
   setWindowIcon(IconManager::get("filesaveas"));
 
+  m_hasRows = false;
+
   setPage(0, new EwFirstPage(this));
   setPage(2, new EwExportPage(this));
 }
@@ -35,6 +42,58 @@ void ExportWizard::setModel(QAbstractItemModel *model) {
   this->model = model;
 }
 
+/**
+ * The export reads the rows again with this query, on a clone of db.
+ */
+void ExportWizard::setQuery(QString query, QSqlDatabase db) {
+  m_query = query;
+  m_database = db;
+  m_hasRows = false;
+  m_rows.clear();
+}
+
+/**
+ * The export writes these rows instead of running the query again, e.g. when
+ * it modified data. Call it after setQuery() and setTable().
+ */
+void ExportWizard::setRows(QSqlRecord columns, QList<QSqlRecord> rows) {
+  m_columns = columns;
+  m_rows = rows;
+  m_hasRows = true;
+  m_partitionKey = "";
+}
+
+/**
+ * A table with a single integer primary key can be exported in several parts.
+ */
+void ExportWizard::setTable(QString table) {
+  m_partitionKey = "";
+  if (table.isEmpty()) {
+    return;
+  }
+
+  foreach (Connection *c, DbManager::instance->connections()) {
+    if (c->db()->connectionName() != m_database.connectionName()) {
+      continue;
+    }
+
+    QStringList keys;
+    foreach (SqlColumn col, DbManager::instance->table(c->db(), table).columns) {
+      if (col.primaryKey) {
+        keys << col.name;
+      }
+    }
+
+    if (keys.size() == 1) {
+      QVariant::Type type = m_database.record(table).field(keys[0]).type();
+      if (type == QVariant::Int || type == QVariant::UInt
+          || type == QVariant::LongLong || type == QVariant::ULongLong) {
+        m_partitionKey = keys[0];
+      }
+    }
+  }
+}
+
 /**
  * First page
  */
@@ -51,7 +110,19 @@ EwFirstPage::EwFirstPage(QWizard *parent)
    * initialisePage. */
 
   registerField("path*", pathLineEdit);
+  registerField("parts", partsSpinBox);
+  registerField("concatenate", concatenateCheckBox);
+  registerField("compression", compressionComboBox);
+  registerField("compressionlevel", compressionLevelSpinBox);
   connect(browseButton, SIGNAL(clicked()), this, SLOT(browse()));
+  connect(partsSpinBox, SIGNAL(valueChanged(int)),
+          this, SLOT(partsChanged(int)));
+  connect(compressionComboBox, SIGNAL(currentIndexChanged(int)),
+          this, SLOT(compressionChanged(int)));
+
+  if (!CompressionDevice::isSupported(CompressionDevice::Zstd)) {
+    compressionComboBox->removeItem(CompressionDevice::Zstd);
+  }
 
   pathLineEdit->setCompleter(new QCompleter(
       new QDirModel(QStringList("*"),
@@ -98,6 +169,14 @@ void EwFirstPage::changeEngine() {
       pathLineEdit->setText(path);
     }
   }
+
+  updatePartsOptions();
+}
+
+void EwFirstPage::compressionChanged(int format) {
+  compressionLevelSpinBox->setEnabled(format != CompressionDevice::NoCompression);
+  compressionLevelSpinBox->setMaximum(format == CompressionDevice::Zstd ? 19 : 9);
+  updatePartsOptions();
 }
 
 void EwFirstPage::initializePage() {
@@ -133,6 +212,13 @@ void EwFirstPage::initializePage() {
 
     connect(btn, SIGNAL(clicked()), this, SLOT(changeEngine()));
   }
+
+  bool partitionable = !((ExportWizard*) wizard())->partitionKey().isEmpty();
+  if (!partitionable) {
+    partsSpinBox->setValue(1);
+  }
+  partsSpinBox->setEnabled(partitionable);
+  updatePartsOptions();
 }
 
 int EwFirstPage::nextId() const {
@@ -148,6 +234,29 @@ int EwFirstPage::nextId() const {
   return 2;
 }
 
+void EwFirstPage::partsChanged(int) {
+  updatePartsOptions();
+}
+
+/**
+ * Only row based and uncompressed formats can be concatenated.
+ */
+void EwFirstPage::updatePartsOptions() {
+  bool concatenable = false;
+  foreach (QRadioButton *r, formatMap.keys()) {
+    if (r->isChecked()) {
+      concatenable = formatMap[r]->canConcatenate();
+    }
+  }
+
+  concatenable &= compressionComboBox->currentIndex()
+      == CompressionDevice::NoCompression;
+  concatenateCheckBox->setEnabled(concatenable && partsSpinBox->value() > 1);
+  if (!concatenable) {
+    concatenateCheckBox->setChecked(false);
+  }
+}
+
 bool EwFirstPage::validatePage() {
   foreach (QRadioButton *r, formatMap.keys()) {
     if (r->isChecked()) {
@@ -166,8 +275,16 @@ EwExportPage::EwExportPage(QWizard *parent)
   : QWizardPage(parent) {
   setupUi(this);
 
+  job = NULL;
+  partitioned = NULL;
+
   dial = new QProgressDialog(this);
   dial->setWindowTitle(tr("Export running..."));
+  dial->setMaximum(0);
+}
+
+EwExportPage::~EwExportPage() {
+  cleanupPage();
 }
 
 void EwExportPage::checkProgress() {
@@ -176,31 +293,95 @@ void EwExportPage::checkProgress() {
   }
 }
 
+void EwExportPage::cleanupPage() {
+  if (job) {
+    job->cancel();
+  }
+  if (partitioned) {
+    partitioned->cancel();
+  }
+}
+
+bool EwExportPage::isComplete() const {
+  return finished;
+}
+
 void EwExportPage::initializePage() {
   finished = false;
-  dial->setMaximum(((ExportWizard*) wizard())->model->rowCount()-1);
-  connect(this, SIGNAL(progress(int)), dial, SLOT(setValue(int)));
+
+  ExportWizard *w = (ExportWizard*) wizard();
+
+  dial->reset();
+  dial->setLabelText(tr("Exporting..."));
   QTimer::singleShot(1000, this, SLOT(checkProgress()));
-  run();
+
+  CompressionDevice::Format compression =
+      (CompressionDevice::Format) field("compression").toInt();
+  // 0 is the "default level" special value
+  int level = field("compressionlevel").toInt();
+  if (level == 0) {
+    level = -1;
+  }
+
+  if (field("parts").toInt() > 1 && !w->partitionKey().isEmpty()) {
+    partitioned = new PartitionedExport(w->engine(), w->query(),
+                                        w->partitionKey(), w->database(),
+                                        field("path").toString(),
+                                        field("parts").toInt(),
+                                        field("concatenate").toBool());
+    partitioned->setCompression(compression, level);
+    connect(partitioned, SIGNAL(progress(int)),
+            this, SLOT(updateProgress(int)));
+    connect(partitioned, SIGNAL(finished(bool)),
+            this, SLOT(jobFinished(bool)));
+    connect(partitioned, SIGNAL(finished(bool)),
+            partitioned, SLOT(deleteLater()));
+    connect(dial, SIGNAL(canceled()), partitioned, SLOT(cancel()));
+
+    partitioned->start();
+    return;
+  }
+
+  QString path = field("path").toString();
+  QString suffix = CompressionDevice::suffix(compression);
+  if (!path.endsWith(suffix)) {
+    path.append(suffix);
+  }
+
+  job = new ExportJob(w->engine()->createWriter(), w->query(), w->database(),
+                      path);
+  job->setCompression(compression, level);
+  if (w->hasRows()) {
+    job->setRows(w->columns(), w->rows());
+  }
+  connect(job, SIGNAL(progress(int)), this, SLOT(updateProgress(int)));
+  connect(job, SIGNAL(finished(bool)), this, SLOT(jobFinished(bool)));
+  connect(job, SIGNAL(finished(bool)), job, SLOT(deleteLater()));
+  connect(dial, SIGNAL(canceled()), job, SLOT(cancel()));
+
+  QueryScheduler::instance->submit(job, w->database(),
+                                   tr("Export : %1").arg(w->query()));
 }
 
-void EwExportPage::run() {
-  QFile f(field("path").toString());
-  if (!f.open(QFile::WriteOnly)) {
+void EwExportPage::jobFinished(bool ok) {
+  finished = true;
+  dial->hide();
+
+  bool canceled = job ? job->isCanceled() : partitioned->isCanceled();
+  QString error = job ? job->errorString() : partitioned->errorString();
+  if (!ok && !canceled) {
     QMessageBox::critical(this,
-                          tr("Openning error"),
-                          tr("Unable to open the file %1.")
-                            .arg(field("path").toString()),
+                          tr("Export error"),
+                          error,
                           QMessageBox::Ok);
-    return;
   }
 
-  ExportEngine *engine = ((ExportWizard*) wizard())->engine();
-  connect(PluginManager::pluginObject(engine->plid()), SIGNAL(progress(int)),
-          dial, SLOT(setValue(int)));
-  engine->process(&f);
+  job = NULL;
+  partitioned = NULL;
 
-  f.close();
-  finished = true;
   emit completeChanged();
 }
+
+void EwExportPage::updateProgress(int rows) {
+  dial->setLabelText(tr("%1 rows exported").arg(rows));
+}
@@ -2,11 +2,13 @@
 #define EXPORTWIZARD_H
 
 #include "../plugins/exportengine.h"
+#include "../plugins/exportjob.h"
+#include "../plugins/partitionedexport.h"
 
 #include "ui_ew_firstpage.h"
 #include "ui_ew_exportpage.h"
 
-#include <QRunnable>
+#include <QSqlDatabase>
 #include <QSqlQueryModel>
 #include <QtWidgets/QRadioButton>
 #include <QtWidgets/QProgressDialog>
@@ -18,13 +20,28 @@ public:
 
   QAbstractItemModel *model;
 
+  QSqlRecord columns() { return m_columns; };
+  QSqlDatabase database() { return m_database; };
   ExportEngine *engine() { return m_engine; };
+  bool hasRows() { return m_hasRows; };
+  QString partitionKey() { return m_partitionKey; };
+  QString query() { return m_query; };
+  QList<QSqlRecord> rows() { return m_rows; };
   void setEngine(ExportEngine *e);
 
   void setModel(QAbstractItemModel* model);
+  void setQuery(QString query, QSqlDatabase db);
+  void setRows(QSqlRecord columns, QList<QSqlRecord> rows);
+  void setTable(QString table);
 
 private:
+  QSqlRecord m_columns;
+  QSqlDatabase m_database;
   ExportEngine *m_engine;
+  bool m_hasRows;
+  QString m_partitionKey;
+  QString m_query;
+  QList<QSqlRecord> m_rows;
 };
 
 
@@ -41,34 +58,38 @@ public slots:
   void browse();
 
 private:
+  void updatePartsOptions();
+
   static QString lastPath;
   QMap<QRadioButton*, ExportEngine*> formatMap;
   QGridLayout *formatLayout;
 
 private slots:
   void changeEngine();
+  void compressionChanged(int format);
+  void partsChanged(int parts);
 };
 
 
-class EwExportPage : public QWizardPage, Ui::EwExportPage, QRunnable {
+class EwExportPage : public QWizardPage, Ui::EwExportPage {
 Q_OBJECT
 public:
   EwExportPage(QWizard *parent =0);
-  //bool isComplete();
+  ~EwExportPage();
+  void cleanupPage();
+  bool isComplete() const;
   void initializePage();
 
-signals:
-  void progress(int);
-
-protected:
-  void run();
-
 private slots:
   void checkProgress();
+  void jobFinished(bool ok);
+  void updateProgress(int rows);
 
 private:
   QProgressDialog    *dial;
   bool                finished;
+  ExportJob          *job;
+  PartitionedExport  *partitioned;
 };
 
 #endif // EXPORTWIZARD_H
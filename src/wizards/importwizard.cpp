@@ -0,0 +1,376 @@
+#include "importwizard.h"
+
+#include "../db/queryscheduler.h"
+#include "../dbmanager.h"
+#include "../iconmanager.h"
+#include "../plugins/pluginmanager.h"
+
+#include <QCompleter>
+#include <QDirModel>
+#include <QFile>
+#include <QFileDialog>
+#include <QLocale>
+#include <QMessageBox>
+
+/**
+ * Position of a name in a list, ignoring the case.
+ */
+static int indexOf(QStringList names, QString name) {
+  for (int i=0; i<names.size(); i++) {
+    if (names[i].compare(name, Qt::CaseInsensitive) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+ImportWizard::ImportWizard(QWidget *parent)
+  : QWizard(parent) {
+  setWindowTitle(tr("Import"));
+
+  setWindowIcon(IconManager::get("document-open"));
+
+  m_database = NULL;
+  m_engine = NULL;
+
+  setPage(0, new IwFirstPage(this));
+  setPage(2, new IwMappingPage(this));
+  setPage(3, new IwImportPage(this));
+}
+
+void ImportWizard::setColumns(QStringList columns) {
+  m_columns = columns;
+}
+
+void ImportWizard::setEngine(ImportEngine *e) {
+  m_engine = e;
+  if (e->wizardPage()) {
+    if (page(1)) {
+      removePage(1);
+    }
+    e->setWizard(this);
+    setPage(1, e->wizardPage());
+  }
+}
+
+/**
+ * The rows are inserted on a clone of db.
+ */
+void ImportWizard::setTable(QSqlDatabase *db, QString table) {
+  m_database = db;
+  m_table = table;
+}
+
+/**
+ * First page
+ */
+QString IwFirstPage::lastPath;
+
+IwFirstPage::IwFirstPage(QWizard *parent)
+    : QWizardPage(parent) {
+  setupUi(this);
+
+  formatLayout = new QGridLayout(formatGroupBox);
+  formatGroupBox->setLayout(formatLayout);
+
+  registerField("path*", pathLineEdit);
+  registerField("transaction", transactionSpinBox);
+  registerField("native", nativeCheckBox);
+  connect(browseButton, SIGNAL(clicked()), this, SLOT(browse()));
+
+  pathLineEdit->setCompleter(new QCompleter(
+      new QDirModel(QStringList("*"),
+                    QDir::AllEntries | QDir::NoDotAndDotDot,
+                    QDir::Type, this),
+      this));
+
+  pathLineEdit->setText(lastPath);
+}
+
+void IwFirstPage::browse() {
+  QStringList filters;
+  foreach (ImportEngine *e, formatMap.values()) {
+    QStringList patterns;
+    foreach (QString ext, e->extensions()) {
+      patterns << "*." + ext;
+    }
+    filters << QString("%1 (%2)").arg(e->displayName(), patterns.join(" "));
+  }
+  filters << tr("All files (*)");
+
+  QString path = QFileDialog::getOpenFileName(this,
+                                              tr("Input file"),
+                                              QDir::homePath(),
+                                              filters.join(";;"));
+  if (path.isEmpty()) {
+    return;
+  }
+
+  lastPath = path;
+  pathLineEdit->setText(lastPath);
+}
+
+void IwFirstPage::initializePage() {
+  ImportWizard *w = (ImportWizard*) wizard();
+  tableLabel->setText(QString("%1 (%2)").arg(w->table())
+                      .arg(DbManager::dbTitle(w->database())));
+
+  foreach (QRadioButton *r, formatMap.keys()) {
+    r->disconnect();
+    formatLayout->removeWidget(r);
+    delete r;
+  }
+  formatMap.clear();
+
+  QList<ImportEngine*> engines = PluginManager::importEngines();
+  bool left = false;
+  int x = -1, y = 0;
+  foreach (ImportEngine *e, engines) {
+    e->setWizard(wizard());
+    QRadioButton *btn = new QRadioButton(e->displayName());
+    formatMap[btn] = e;
+    if (x == -1) {
+      btn->setChecked(true);
+    }
+    if (e->displayIconCode().length() > 0) {
+      btn->setIcon(IconManager::get(e->displayIconCode()));
+    }
+    if (left) {
+      y = 1;
+    } else {
+      x++;
+      y = 0;
+    }
+    left = !left;
+    formatLayout->addWidget(btn, x, y);
+  }
+}
+
+int IwFirstPage::nextId() const {
+  foreach (QRadioButton *r, formatMap.keys()) {
+    if (r->isChecked()) {
+      if (formatMap[r]->wizardPage()) {
+        return 1;
+      } else {
+        return 2;
+      }
+    }
+  }
+  return 2;
+}
+
+bool IwFirstPage::validatePage() {
+  if (!QFile::exists(pathLineEdit->text())) {
+    QMessageBox::warning(this,
+                         tr("Import"),
+                         tr("The file %1 doesn't exist.")
+                         .arg(pathLineEdit->text()));
+    return false;
+  }
+
+  foreach (QRadioButton *r, formatMap.keys()) {
+    if (r->isChecked()) {
+      ((ImportWizard*) wizard())->setEngine(formatMap[r]);
+      break;
+    }
+  }
+  return true;
+}
+
+
+/**
+ * Mapping page
+ */
+IwMappingPage::IwMappingPage(QWizard *parent)
+  : QWizardPage(parent) {
+  setupUi(this);
+
+  readable = false;
+}
+
+/**
+ * Reads the fields from the beginning of the file, and maps them to the
+ * columns of the same name. If none matches, they are mapped in order.
+ */
+void IwMappingPage::initializePage() {
+  ImportWizard *w = (ImportWizard*) wizard();
+
+  mappingTable->setRowCount(0);
+  combos.clear();
+  errorLabel->clear();
+
+  QStringList fields;
+  QFile f(field("path").toString());
+  ImportReader *reader = w->engine()->createReader();
+  readable = false;
+  if (!f.open(QFile::ReadOnly)) {
+    errorLabel->setText(tr("Unable to open the file %1.").arg(f.fileName()));
+  } else if (!reader->begin(&f)) {
+    errorLabel->setText(reader->errorString());
+  } else {
+    fields = reader->columns();
+    readable = true;
+  }
+  delete reader;
+
+  QStringList targets;
+  foreach (SqlColumn c,
+           DbManager::instance->table(w->database(), w->table()).columns) {
+    targets << c.name;
+  }
+
+  bool byName = false;
+  foreach (QString name, fields) {
+    byName |= indexOf(targets, name) >= 0;
+  }
+
+  mappingTable->setRowCount(fields.size());
+  for (int i=0; i<fields.size(); i++) {
+    QTableWidgetItem *item = new QTableWidgetItem(fields[i]);
+    item->setFlags(Qt::ItemIsEnabled);
+    mappingTable->setItem(i, 0, item);
+
+    QComboBox *combo = new QComboBox();
+    combo->addItem(tr("(skip)"));
+    combo->addItems(targets);
+    int target = byName ? indexOf(targets, fields[i])
+                        : (i < targets.size() ? i : -1);
+    combo->setCurrentIndex(target + 1);
+    connect(combo, SIGNAL(currentIndexChanged(int)),
+            this, SIGNAL(completeChanged()));
+    mappingTable->setCellWidget(i, 1, combo);
+    combos << combo;
+  }
+  mappingTable->resizeColumnToContents(0);
+}
+
+bool IwMappingPage::isComplete() const {
+  if (!readable) {
+    return false;
+  }
+
+  foreach (QComboBox *c, combos) {
+    if (c->currentIndex() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IwMappingPage::validatePage() {
+  QStringList columns;
+  foreach (QComboBox *c, combos) {
+    QString column = c->currentIndex() > 0 ? c->currentText() : "";
+    if (!column.isEmpty() && columns.contains(column)) {
+      QMessageBox::warning(this,
+                           tr("Import"),
+                           tr("The column %1 is filled by several fields.")
+                           .arg(column));
+      return false;
+    }
+    columns << column;
+  }
+
+  ((ImportWizard*) wizard())->setColumns(columns);
+  return true;
+}
+
+
+/**
+ * Import page
+ */
+IwImportPage::IwImportPage(QWizard *parent)
+  : QWizardPage(parent) {
+  setupUi(this);
+
+  elapsed = 0;
+  finished = false;
+  job = NULL;
+}
+
+IwImportPage::~IwImportPage() {
+  cleanupPage();
+}
+
+/**
+ * The canceled job deletes itself once finished, it doesn't report to the
+ * page anymore.
+ */
+void IwImportPage::cleanupPage() {
+  if (job) {
+    job->disconnect(this);
+    job->cancel();
+    job = NULL;
+  }
+}
+
+bool IwImportPage::isComplete() const {
+  return finished;
+}
+
+void IwImportPage::initializePage() {
+  finished = false;
+  elapsed = 0;
+
+  ImportWizard *w = (ImportWizard*) wizard();
+
+  progressBar->setMaximum(0);
+  rowsLabel->setText("0");
+  rateLabel->clear();
+  statusLabel->setText(tr("Importing..."));
+
+  job = new ImportJob(w->engine()->createReader(), field("path").toString(),
+                      *w->database(), w->table(), w->columns());
+  job->setTransactionSize(field("transaction").toInt());
+  if (field("native").toBool()) {
+    job->setWrapper(DbManager::instance->wrapper(w->database()));
+  }
+  connect(job, SIGNAL(progress(int,int)), this, SLOT(updateProgress(int,int)));
+  connect(job, SIGNAL(finished(bool)), this, SLOT(jobFinished(bool)));
+  connect(job, SIGNAL(finished(bool)), job, SLOT(deleteLater()));
+
+  QueryScheduler::instance->submit(job, *w->database(),
+                                   tr("Import : %1").arg(w->table()));
+}
+
+void IwImportPage::jobFinished(bool ok) {
+  ImportJob *job = qobject_cast<ImportJob*>(sender());
+  if (!job || job != this->job) {
+    return;
+  }
+
+  finished = true;
+  progressBar->setMaximum(1);
+  progressBar->setValue(ok ? 1 : 0);
+
+  QString seconds = QLocale().toString(elapsed / 1000.0, 'f', 1);
+  if (ok && job->isNative()) {
+    statusLabel->setText(tr("Loaded by the bulk loader of the server in %1 s.")
+                         .arg(seconds));
+  } else if (ok) {
+    statusLabel->setText(tr("Import complete in %1 s.").arg(seconds));
+  } else if (job->isCanceled()) {
+    statusLabel->setText(tr("Import canceled, %1 rows committed.")
+                         .arg(QLocale().toString(job->rowCount())));
+  } else {
+    statusLabel->setText(tr("Import failed, %1 rows committed.")
+                         .arg(QLocale().toString(job->rowCount())));
+    QMessageBox::critical(this,
+                          tr("Import error"),
+                          job->errorString(),
+                          QMessageBox::Ok);
+  }
+
+  this->job = NULL;
+
+  emit completeChanged();
+}
+
+void IwImportPage::updateProgress(int rows, int msecs) {
+  elapsed = msecs;
+  rowsLabel->setText(QLocale().toString(rows));
+  if (msecs > 0) {
+    qint64 rate = qRound64(rows * 1000.0 / msecs);
+    rateLabel->setText(tr("%1 rows/s").arg(QLocale().toString(rate)));
+  }
+}
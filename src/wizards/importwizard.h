@@ -0,0 +1,92 @@
+#ifndef IMPORTWIZARD_H
+#define IMPORTWIZARD_H
+
+#include "../plugins/importengine.h"
+#include "../plugins/importjob.h"
+
+#include "ui_iw_firstpage.h"
+#include "ui_iw_importpage.h"
+#include "ui_iw_mappingpage.h"
+
+#include <QComboBox>
+#include <QSqlDatabase>
+#include <QtWidgets/QRadioButton>
+
+class ImportWizard : public QWizard {
+Q_OBJECT
+public:
+  ImportWizard(QWidget *parent =0);
+
+  /**
+   * Target column of each field of the file, empty if the field is skipped.
+   */
+  QStringList columns() { return m_columns; };
+  QSqlDatabase *database() { return m_database; };
+  ImportEngine *engine() { return m_engine; };
+  void setColumns(QStringList columns);
+  void setEngine(ImportEngine *e);
+  void setTable(QSqlDatabase *db, QString table);
+  QString table() { return m_table; };
+
+private:
+  QStringList m_columns;
+  QSqlDatabase *m_database;
+  ImportEngine *m_engine;
+  QString m_table;
+};
+
+
+class IwFirstPage : public QWizardPage, Ui::IwFirstPage {
+Q_OBJECT
+public:
+  IwFirstPage(QWizard *parent=0);
+
+  void initializePage();
+  int nextId() const;
+  bool validatePage();
+
+public slots:
+  void browse();
+
+private:
+  static QString lastPath;
+  QMap<QRadioButton*, ImportEngine*> formatMap;
+  QGridLayout *formatLayout;
+};
+
+
+class IwMappingPage : public QWizardPage, Ui::IwMappingPage {
+Q_OBJECT
+public:
+  IwMappingPage(QWizard *parent =0);
+
+  void initializePage();
+  bool isComplete() const;
+  bool validatePage();
+
+private:
+  QList<QComboBox*> combos;
+  bool readable;
+};
+
+
+class IwImportPage : public QWizardPage, Ui::IwImportPage {
+Q_OBJECT
+public:
+  IwImportPage(QWizard *parent =0);
+  ~IwImportPage();
+  void cleanupPage();
+  bool isComplete() const;
+  void initializePage();
+
+private slots:
+  void jobFinished(bool ok);
+  void updateProgress(int rows, int msecs);
+
+private:
+  int         elapsed;
+  bool        finished;
+  ImportJob  *job;
+};
+
+#endif // IMPORTWIZARD_H